@@ -0,0 +1,570 @@
+/*
+    Boost Software License - Version 1.0 - August 17, 2003
+
+    Permission is hereby granted, free of charge, to any person or organization
+    obtaining a copy of the software and accompanying documentation covered by
+    this license (the "Software") to use, reproduce, display, distribute,
+    execute, and transmit the Software, and to prepare derivative works of the
+    Software, and to permit third-parties to whom the Software is furnished to
+    do so, all subject to the following:
+
+    The copyright notices in the Software and this entire statement, including
+    the above license grant, this restriction and the following disclaimer,
+    must be included in all copies of the Software, in whole or in part, and
+    all derivative works of the Software, unless such copies or derivative
+    works are solely in the form of machine-executable object code generated by
+    a source language processor.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+    SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+    FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+*/
+
+// measure the compiled serialization path (no serialization hooks)
+#define REFLECTOR_COMPILED_SERIALIZATION
+
+#include <reflection/api.hpp>
+#include <reflection/magic.hpp>
+
+#include <reflection/basic_templates.hpp>
+#include <reflection/basic_types.hpp>
+#include <reflection/buffer_io.hpp>
+#include <reflection/class.hpp>
+#include <reflection/clone.hpp>
+#include <reflection/compare.hpp>
+#include <reflection/hash.hpp>
+#include <reflection/json.hpp>
+#include <reflection/msgpack.hpp>
+#include <reflection/query.hpp>
+#include <reflection/soa_vector.hpp>
+#include <reflection/validate.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <vector>
+
+using namespace std;
+
+struct Position {
+    double latitude;
+    double longitude;
+
+    REFL_BEGIN("Position", 1)
+        REFL_FIELD(latitude)
+        REFL_FIELD(longitude)
+    REFL_END
+};
+
+struct Sample {
+    int64_t id;
+    string name;
+    string comment;
+    int32_t count;
+    uint32_t flags;
+    float ratio;
+    double value;
+    bool valid;
+    Position position;
+    vector<int32_t> history;
+
+    REFL_BEGIN("Sample", 1)
+        REFL_FIELD(id)
+        REFL_FIELD(name)
+        REFL_FIELD(comment)
+        REFL_FIELD(count)
+        REFL_FIELD(flags)
+        REFL_FIELD(ratio)
+        REFL_FIELD(value)
+        REFL_FIELD(valid)
+        REFL_FIELD(position)
+        REFL_FIELD(history)
+    REFL_END
+};
+
+// standard-layout, so every field gets a precomputed offset
+struct Particle {
+    float x, y, z;
+    float vx, vy, vz;
+    int32_t id;
+    uint32_t flags;
+
+    REFL_BEGIN("Particle", 1)
+        REFL_FIELD(x)
+        REFL_FIELD(y)
+        REFL_FIELD(z)
+        REFL_FIELD(vx)
+        REFL_FIELD(vy)
+        REFL_FIELD(vz)
+        REFL_FIELD(id)
+        REFL_FIELD(flags)
+    REFL_END
+};
+
+static vector<Sample> makeSamples(size_t count) {
+    vector<Sample> samples(count);
+
+    for (size_t i = 0; i < count; i++) {
+        Sample& s = samples[i];
+        s.id = 1000000007LL * (int64_t) i;
+        s.name = "sample #" + to_string(i);
+        s.comment = (i % 7 == 0) ? "needs \"escaping\"\n\tsometimes" : "a reasonably long plain comment without anything special in it";
+        s.count = (int32_t)(i * 37 % 100000) - 50000;
+        s.flags = (uint32_t)(i * 2654435761u);
+        s.ratio = (float) i / 3.0f;
+        s.value = 1.0 / (double)(i + 1);
+        s.valid = (i & 1) != 0;
+        s.position.latitude = 48.1486 + (double) i * 1e-6;
+        s.position.longitude = 17.1077 - (double) i * 1e-6;
+
+        for (int j = 0; j < 8; j++)
+            s.history.push_back((int32_t)(i * j));
+    }
+
+    return samples;
+}
+
+template <typename Func>
+static double seconds(Func func) {
+    auto begin = chrono::steady_clock::now();
+    func();
+    return chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+}
+
+static void report(const char* name, size_t bytes, double secs) {
+    printf("%-28s %10.1f MB/s   (%.1f MB in %.3f s)\n", name, (double) bytes / secs / 1e6, (double) bytes / 1e6, secs);
+}
+
+// for readers: a checksum of what was decoded keeps the work observable
+static void report(const char* name, size_t bytes, double secs, uint64_t checksum) {
+    printf("%-28s %10.1f MB/s   (%.1f MB in %.3f s, %016llx)\n", name, (double) bytes / secs / 1e6, (double) bytes / 1e6,
+            secs, (unsigned long long) checksum);
+}
+
+// timed calls must not sit inside assert(), which NDEBUG builds compile out
+static void check(bool ok) {
+    if (!ok)
+        abort();
+}
+
+static uint64_t checksum(const vector<Sample>& samples) {
+    uint64_t sum = 0;
+
+    for (const Sample& s : samples)
+        sum = sum * 31 + (uint64_t) s.id + (uint64_t) s.count + s.name.size() + s.history.size() + s.valid;
+
+    return sum;
+}
+
+static void benchSerialization(const vector<Sample>& samples, int rounds) {
+    serialization::BufferWriter binary;
+    serialization::JsonWriter json;
+    serialization::MsgPackWriter msgpack;
+
+    double binarySecs = seconds([&] {
+        for (int r = 0; r < rounds; r++) {
+            binary.clear();
+
+            for (const auto& s : samples)
+                check(reflection::reflectSerialize(s, &binary));
+        }
+    });
+
+    double jsonSecs = seconds([&] {
+        for (int r = 0; r < rounds; r++) {
+            json.clear();
+
+            for (const auto& s : samples)
+                check(reflection::reflectToJson(s, &json) && json.endLine(reflection::err));
+        }
+    });
+
+    double msgpackSecs = seconds([&] {
+        for (int r = 0; r < rounds; r++) {
+            msgpack.clear();
+
+            for (const auto& s : samples)
+                check(reflection::reflectToMsgPack(s, &msgpack));
+        }
+    });
+
+    report("binary serializer", binary.size() * rounds, binarySecs);
+    report("JSON writer", json.size() * rounds, jsonSecs);
+    report("MessagePack writer", msgpack.size() * rounds, msgpackSecs);
+
+    // parse back the last round as one JSON document per record
+    vector<Sample> parsed(samples.size());
+
+    double binaryReadSecs = seconds([&] {
+        for (int r = 0; r < rounds; r++) {
+            serialization::BufferReader rd(binary.data(), binary.size());
+
+            for (auto& s : parsed)
+                check(reflection::reflectDeserialize(s, &rd));
+        }
+    });
+
+    uint64_t binaryChecksum = checksum(parsed);
+
+    double jsonReadSecs = seconds([&] {
+        for (int r = 0; r < rounds; r++) {
+            serialization::JsonReader rd(json.data(), json.size());
+
+            for (auto& s : parsed)
+                check(reflection::reflectFromJson(s, &rd));
+        }
+    });
+
+    uint64_t jsonChecksum = checksum(parsed);
+
+    double msgpackReadSecs = seconds([&] {
+        for (int r = 0; r < rounds; r++) {
+            serialization::MsgPackReader rd(msgpack.data(), msgpack.size());
+
+            for (auto& s : parsed)
+                check(reflection::reflectFromMsgPack(s, &rd));
+        }
+    });
+
+    uint64_t msgpackChecksum = checksum(parsed);
+
+    report("binary deserializer", binary.size() * rounds, binaryReadSecs, binaryChecksum);
+    report("JSON reader", json.size() * rounds, jsonReadSecs, jsonChecksum);
+    report("MessagePack reader", msgpack.size() * rounds, msgpackReadSecs, msgpackChecksum);
+}
+
+// structural validation of untrusted input vs. actually deserializing it
+static void benchValidation(const vector<Sample>& samples, int rounds) {
+    serialization::BufferWriter binary;
+
+    for (const auto& s : samples)
+        check(reflection::reflectSerialize(s, &binary));
+
+    uint64_t numValid = 0;
+
+    double validateSecs = seconds([&] {
+        for (int r = 0; r < rounds; r++) {
+            serialization::BufferReader rd(binary.data(), binary.size());
+
+            while (rd.remaining() > 0 && reflection::reflectValidate<Sample>(rd))
+                numValid++;
+
+            check(rd.remaining() == 0);
+        }
+    });
+
+    vector<Sample> parsed(samples.size());
+
+    double deserializeSecs = seconds([&] {
+        for (int r = 0; r < rounds; r++) {
+            serialization::BufferReader rd(binary.data(), binary.size());
+
+            for (auto& s : parsed)
+                check(reflection::reflectDeserialize(s, &rd));
+        }
+    });
+
+    check(numValid == samples.size() * rounds);
+
+    report("reflectValidate", binary.size() * rounds, validateSecs, numValid);
+    report("reflectDeserialize", binary.size() * rounds, deserializeSecs, checksum(parsed));
+}
+
+static void benchHashing(const vector<Sample>& samples, int rounds) {
+    serialization::BufferWriter binary;
+    uint64_t viaBinary = 0, viaReflectHash = 0;
+
+    // what callers did before reflectHash: serialize each record, hash the bytes
+    double binarySecs = seconds([&] {
+        for (int r = 0; r < rounds; r++) {
+            for (const auto& s : samples) {
+                binary.clear();
+                check(reflection::reflectSerialize(s, &binary));
+                viaBinary += reflection::XXHash64::hash(binary.data(), binary.size(), 0);
+            }
+        }
+    });
+
+    double hashSecs = seconds([&] {
+        for (int r = 0; r < rounds; r++) {
+            for (const auto& s : samples)
+                viaReflectHash += reflection::reflectHash(s);
+        }
+    });
+
+    size_t numRecords = samples.size() * rounds;
+    printf("%-28s %10.1f M records/s   (%016llx)\n", "serialize + XXH64", (double) numRecords / binarySecs / 1e6,
+            (unsigned long long) viaBinary);
+    printf("%-28s %10.1f M records/s   (%016llx)\n", "reflectHash()", (double) numRecords / hashSecs / 1e6,
+            (unsigned long long) viaReflectHash);
+}
+
+static void benchComparison(const vector<Sample>& samples, int rounds) {
+    vector<Sample> copies(samples);
+    serialization::BufferWriter left, right;
+    size_t viaBinary = 0, viaReflectEquals = 0;
+
+    // what change detection did before reflectEquals: encode both, compare the bytes
+    double binarySecs = seconds([&] {
+        for (int r = 0; r < rounds; r++) {
+            for (size_t i = 0; i < samples.size(); i++) {
+                left.clear();
+                right.clear();
+                check(reflection::reflectSerialize(samples[i], &left) && reflection::reflectSerialize(copies[i], &right));
+                viaBinary += (left.size() == right.size() && memcmp(left.data(), right.data(), left.size()) == 0);
+            }
+        }
+    });
+
+    double equalsSecs = seconds([&] {
+        for (int r = 0; r < rounds; r++) {
+            for (size_t i = 0; i < samples.size(); i++)
+                viaReflectEquals += reflection::reflectEquals(samples[i], copies[i]);
+        }
+    });
+
+    size_t numRecords = samples.size() * rounds;
+    printf("%-28s %10.1f M records/s   (%zu equal)\n", "serialize both + memcmp", (double) numRecords / binarySecs / 1e6, viaBinary);
+    printf("%-28s %10.1f M records/s   (%zu equal)\n", "reflectEquals()", (double) numRecords / equalsSecs / 1e6, viaReflectEquals);
+}
+
+static void benchSnapshot(const vector<Sample>& samples, int rounds) {
+    vector<Sample> snapshots(samples.size());
+    serialization::BufferWriter writer;
+    size_t bytes = 0;
+
+    // snapshot as taken under a lock before reflectAssign: serialize the whole object
+    double binarySecs = seconds([&] {
+        for (int r = 0; r < rounds; r++) {
+            for (size_t i = 0; i < samples.size(); i++) {
+                writer.clear();
+                check(reflection::reflectSerialize(samples[i], &writer));
+                bytes += writer.size();
+            }
+        }
+    });
+
+    double assignSecs = seconds([&] {
+        for (int r = 0; r < rounds; r++) {
+            for (size_t i = 0; i < samples.size(); i++)
+                reflection::reflectAssign(snapshots[i], samples[i], reflection::FIELD_STATE);
+        }
+    });
+
+    check(reflection::reflectEquals(snapshots.back(), samples.back()));
+
+    size_t numRecords = samples.size() * rounds;
+    printf("%-28s %10.1f M records/s   (%zu bytes)\n", "serialize", (double) numRecords / binarySecs / 1e6, bytes);
+    printf("%-28s %10.1f M records/s   (%016llx)\n", "reflectAssign(FIELD_STATE)", (double) numRecords / assignSecs / 1e6,
+            (unsigned long long) checksum(snapshots));
+}
+
+static void benchColumnScan(const vector<Sample>& samples, int rounds) {
+    reflection::SoAVector<Sample> columns;
+    columns.reserve(samples.size());
+
+    for (const Sample& sample : samples)
+        columns.push_back(sample);
+
+    int64_t sums[2] = {};
+
+    double rowSecs = seconds([&] {
+        for (int r = 0; r < rounds; r++) {
+            for (const Sample& sample : samples)
+                sums[0] += sample.count;
+        }
+    });
+
+    double columnSecs = seconds([&] {
+        for (int r = 0; r < rounds; r++) {
+            for (int32_t count : columns.column(&Sample::count))
+                sums[1] += count;
+        }
+    });
+
+    check(sums[0] == sums[1]);
+
+    size_t numRecords = samples.size() * rounds;
+    printf("%-28s %10.1f M records/s\n", "scan vector<Sample>", (double) numRecords / rowSecs / 1e6);
+    printf("%-28s %10.1f M records/s\n", "scan SoAVector<Sample>", (double) numRecords / columnSecs / 1e6);
+}
+
+// count > 0 && valid, sum of value
+static void benchQuery(const vector<Sample>& samples, int rounds) {
+    reflection::SoAVector<Sample> columns;
+    columns.reserve(samples.size());
+
+    for (const Sample& sample : samples)
+        columns.push_back(sample);
+
+    // integer constants against a float field compare in double: ratio = i / 3 must not be truncated
+    size_t aboveOne = 0, equalToOne = 0;
+
+    for (const Sample& sample : samples) {
+        aboveOne += (sample.ratio > 1);
+        equalToOne += (sample.ratio == 1);
+    }
+
+    reflection::Query<vector<Sample>> aboveQuery(samples), equalQuery(samples);
+    reflection::Query<reflection::SoAVector<Sample>> aboveColumnQuery(columns);
+    check(aboveQuery.where(reflection::err, "ratio", reflection::QUERY_GT, 1) && aboveQuery.count() == aboveOne);
+    check(equalQuery.where(reflection::err, "ratio", reflection::QUERY_EQ, 1) && equalQuery.count() == equalToOne);
+    check(aboveColumnQuery.where(reflection::err, "ratio", reflection::QUERY_GT, 1) && aboveColumnQuery.count() == aboveOne);
+
+    double sums[3] = {};
+
+    double loopSecs = seconds([&] {
+        for (int r = 0; r < rounds; r++) {
+            for (const Sample& sample : samples) {
+                if (sample.count > 0 && sample.valid)
+                    sums[0] += sample.value;
+            }
+        }
+    });
+
+    reflection::QueryAggregate_t aggregate;
+
+    double rowSecs = seconds([&] {
+        for (int r = 0; r < rounds; r++) {
+            reflection::Query<vector<Sample>> query(samples);
+            check(query.where(reflection::err, "count", reflection::QUERY_GT, 0)
+                    && query.where(reflection::err, "valid", reflection::QUERY_EQ, true)
+                    && query.aggregate(reflection::err, "value", &aggregate));
+            sums[1] += aggregate.sum;
+        }
+    });
+
+    double columnSecs = seconds([&] {
+        for (int r = 0; r < rounds; r++) {
+            reflection::Query<reflection::SoAVector<Sample>> query(columns);
+            check(query.where(reflection::err, "count", reflection::QUERY_GT, 0)
+                    && query.where(reflection::err, "valid", reflection::QUERY_EQ, true)
+                    && query.aggregate(reflection::err, "value", &aggregate));
+            sums[2] += aggregate.sum;
+        }
+    });
+
+    size_t numRecords = samples.size() * rounds;
+    printf("%-28s %10.1f M records/s   (sum %g)\n", "hand-written loop", (double) numRecords / loopSecs / 1e6, sums[0]);
+    printf("%-28s %10.1f M records/s   (sum %g)\n", "Query<vector<Sample>>", (double) numRecords / rowSecs / 1e6, sums[1]);
+    printf("%-28s %10.1f M records/s   (sum %g)\n", "Query<SoAVector<Sample>>", (double) numRecords / columnSecs / 1e6, sums[2]);
+}
+
+// adds up every numeric field the way a generic hot loop would
+static int64_t sumField(uint32_t kind, const void* p) {
+    switch (kind) {
+        case reflection::KIND_FLOAT:    return (int64_t) *reinterpret_cast<const float*>(p);
+        case reflection::KIND_INT32:    return *reinterpret_cast<const int32_t*>(p);
+        case reflection::KIND_UINT32:   return *reinterpret_cast<const uint32_t*>(p);
+        default:                        return 0;
+    }
+}
+
+// the same for compile-time iteration; overloads stand in for the switch on kind
+struct SumFields {
+    int64_t& sum;
+
+    template <class Field> void operator ()(const Field&, float value) const { sum += (int64_t) value; }
+    template <class Field> void operator ()(const Field&, int32_t value) const { sum += value; }
+    template <class Field> void operator ()(const Field&, uint32_t value) const { sum += value; }
+};
+
+static void benchFieldIteration(size_t count, int rounds) {
+    vector<Particle> particles(count);
+
+    for (size_t i = 0; i < count; i++) {
+        Particle& p = particles[i];
+        p.x = p.y = p.z = (float) i;
+        p.vx = p.vy = p.vz = 0.5f;
+        p.id = (int32_t) i;
+        p.flags = (uint32_t) i & 7;
+    }
+
+    const reflection::FlatFieldTable_t* table = reflection::reflectFieldsStatic<Particle>().table;
+    const size_t numFields = count * table->count * rounds;
+    int64_t sums[4] = {};
+
+    double getterSecs = seconds([&] {
+        int64_t sum = 0;
+
+        for (int r = 0; r < rounds; r++)
+            for (const auto& p : particles)
+                for (size_t i = 0; i < table->count; i++) {
+                    const reflection::Field_t* field = table->entries[i].field;
+                    sum += sumField(field->kind, field->fieldGetter(&p));
+                }
+
+        sums[0] = sum;
+    });
+
+    double offsetSecs = seconds([&] {
+        int64_t sum = 0;
+
+        for (int r = 0; r < rounds; r++)
+            for (const auto& p : particles)
+                for (size_t i = 0; i < table->count; i++) {
+                    const reflection::FlatField_t& entry = table->entries[i];
+                    sum += sumField(entry.field->kind, reinterpret_cast<const char*>(&p) + entry.offset);
+                }
+
+        sums[1] = sum;
+    });
+
+    double fieldsSecs = seconds([&] {
+        int64_t sum = 0;
+
+        for (int r = 0; r < rounds; r++)
+            for (const auto& p : particles)
+                for (const auto& field : reflection::reflectFields(p))
+                    sum += sumField(field.kind, field.ptr());
+
+        sums[2] = sum;
+    });
+
+    double staticSecs = seconds([&] {
+        int64_t sum = 0;
+
+        for (int r = 0; r < rounds; r++)
+            for (const auto& p : particles)
+                reflection::forEachField(p, SumFields{sum});
+
+        sums[3] = sum;
+    });
+
+    check(sums[0] == sums[1] && sums[1] == sums[2] && sums[2] == sums[3]);
+
+    printf("%-28s %10.1f M fields/s\n", "field access via getter", (double) numFields / getterSecs / 1e6);
+    printf("%-28s %10.1f M fields/s\n", "field access via offset", (double) numFields / offsetSecs / 1e6);
+    printf("%-28s %10.1f M fields/s\n", "reflectFields() iteration", (double) numFields / fieldsSecs / 1e6);
+    printf("%-28s %10.1f M fields/s\n", "forEachField() (static)", (double) numFields / staticSecs / 1e6);
+}
+
+int main(int argc, char** argv) {
+    const size_t numSamples = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 200000;
+    const int rounds = 5;
+
+    auto samples = makeSamples(numSamples);
+
+    printf("%s\n\n", reflection::reflectToJson(samples[7]).c_str());
+
+    benchSerialization(samples, rounds);
+    printf("\n");
+    benchValidation(samples, rounds);
+    printf("\n");
+    benchHashing(samples, rounds);
+    printf("\n");
+    benchComparison(samples, rounds);
+    printf("\n");
+    benchSnapshot(samples, rounds);
+    printf("\n");
+    benchColumnScan(samples, rounds);
+    printf("\n");
+    benchQuery(samples, rounds);
+    printf("\n");
+    benchFieldIteration(1000000, rounds);
+}
+
+#include <reflection/default_error_handler.cpp>
@@ -25,6 +25,7 @@
 */
 
 #include <reflection/dump.hpp>
+#include <reflection/schema_bundle.hpp>
 
 #include <cassert>
 #include <string>
@@ -102,7 +103,21 @@ int main(int argc, char** argv) {
     assert(file != nullptr);
 
     MyReader rd(file);
-    MySchemaProvider sp;
+    // one mapped file if example_serialization wrote it, otherwise a .class_schema file per class
+    reflection::SchemaBundle bundle;
+    reflection::SchemaBundleProvider bundleProvider(bundle);
+    MySchemaProvider fileProvider;
+
+    reflection::ISchemaProvider* provider = &fileProvider;
+
+    if (FILE* bundleFile = fopen("schemas.bundle", "rb")) {
+        fclose(bundleFile);
+
+        if (bundle.open(reflection::err, "schemas.bundle"))
+            provider = &bundleProvider;
+    }
+
+    reflection::SchemaCache sp(provider);
 
     if (str_ends_with(fileName, ".class")) {
         if (argc < 3)
@@ -0,0 +1,126 @@
+/*
+    Boost Software License - Version 1.0 - August 17, 2003
+
+    Permission is hereby granted, free of charge, to any person or organization
+    obtaining a copy of the software and accompanying documentation covered by
+    this license (the "Software") to use, reproduce, display, distribute,
+    execute, and transmit the Software, and to prepare derivative works of the
+    Software, and to permit third-parties to whom the Software is furnished to
+    do so, all subject to the following:
+
+    The copyright notices in the Software and this entire statement, including
+    the above license grant, this restriction and the following disclaimer,
+    must be included in all copies of the Software, in whole or in part, and
+    all derivative works of the Software, unless such copies or derivative
+    works are solely in the form of machine-executable object code generated by
+    a source language processor.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+    SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+    FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+*/
+
+
+// Serialization hooks run for every field of a reflected class, as long as REFLECTOR_COMPILED_SERIALIZATION is not
+// defined (the compiled path skips them for built-in types).
+
+#include <reflection/api.hpp>
+#include <reflection/magic.hpp>
+
+#include <reflection/basic_types.hpp>
+#include <reflection/buffer_io.hpp>
+#include <reflection/class.hpp>
+
+#include <cstdlib>
+
+using namespace std;
+
+static int numInstancesWritten = 0;
+static int numValuesWritten = 0;
+
+namespace serialization {
+// Count every value written, through a stronger match (REFL_MATCH_0)
+template <class T>
+int preSerializationHook(IErrorHandler* err, IWriter* writer, const T& value, REFL_MATCH_0) {
+    numValuesWritten++;
+    return -1;
+}
+
+template <typename Fields>
+int preInstanceSerializationHook(IErrorHandler* err, IWriter* writer, const char* className,
+        const Fields& fields, REFL_MATCH_0) {
+    numInstancesWritten++;
+    return -1;
+}
+
+// Clamp negative integers on the way in; -1 keeps the result of the default deserializer
+template <>
+int postDeserializationHook(IErrorHandler* err, IReader* reader, int32_t& value_out, int deserializationResult,
+        REFL_MATCH_1) {
+    if (deserializationResult && value_out < 0)
+        value_out = 0;
+
+    return -1;
+}
+}
+
+struct Position {
+    float x;
+    float y;
+
+    REFL_BEGIN("Position", 1)
+        REFL_FIELD(x)
+        REFL_FIELD(y)
+    REFL_END
+};
+
+struct Item {
+    string name;
+    int32_t quantity;
+    Position position;
+
+    REFL_BEGIN("Item", 1)
+        REFL_FIELD(name)
+        REFL_FIELD(quantity)
+        REFL_FIELD(position)
+    REFL_END
+};
+
+static void check(bool condition, const char* what) {
+    if (!condition) {
+        fprintf(stderr, "FAILED: %s\n", what);
+        abort();
+    }
+}
+
+int main(int argc, char** argv) {
+    Item item = { "crate", -3, { 1.5f, 2.0f } };
+
+    serialization::BufferWriter wr;
+    check(reflection::reflectSerialize(item, &wr), "reflectSerialize");
+
+    // Item and the nested Position; then name, quantity, x and y (classes only go through the instance hooks)
+    printf("instances written: %d, values written: %d\n", numInstancesWritten, numValuesWritten);
+    check(numInstancesWritten == 2, "preInstanceSerializationHook");
+    check(numValuesWritten == 4, "preSerializationHook");
+
+    Item copy = {};
+    serialization::BufferReader rd(wr.data(), wr.size());
+    check(reflection::reflectDeserialize(copy, &rd), "reflectDeserialize");
+
+    printf("%s\n", reflection::reflectToString(copy).c_str());
+    check(copy.name == "crate" && copy.quantity == 0 && copy.position.y == 2.0f, "postDeserializationHook");
+}
+
+#include <reflection/default_error_handler.cpp>
+
+/* OUTPUT:
+
+instances written: 2, values written: 4
+{name="crate", quantity="0", position="{x="1.5", y="2"}"}
+
+*/
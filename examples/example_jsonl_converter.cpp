@@ -0,0 +1,443 @@
+/*
+    Boost Software License - Version 1.0 - August 17, 2003
+
+    Permission is hereby granted, free of charge, to any person or organization
+    obtaining a copy of the software and accompanying documentation covered by
+    this license (the "Software") to use, reproduce, display, distribute,
+    execute, and transmit the Software, and to prepare derivative works of the
+    Software, and to permit third-parties to whom the Software is furnished to
+    do so, all subject to the following:
+
+    The copyright notices in the Software and this entire statement, including
+    the above license grant, this restriction and the following disclaimer,
+    must be included in all copies of the Software, in whole or in part, and
+    all derivative works of the Software, unless such copies or derivative
+    works are solely in the form of machine-executable object code generated by
+    a source language processor.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+    SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+    FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+*/
+
+// Streams a file of binary-serialized instances of one class (as written back-to-back by reflectSerialize) to
+// JSON Lines. Schemas come from schemas.bundle if given, otherwise from schemas/<classId>.class_schema files.
+//
+//     example_jsonl_converter records.bin "Sample,1" [-b schemas.bundle] [-j threads] [-o out.jsonl]
+
+#include <reflection/api.hpp>
+#include <reflection/json.hpp>
+#include <reflection/schema_bundle.hpp>
+
+#include <atomic>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+using serialization::JsonWriter;
+using serialization::Tag_t;
+
+enum {
+    FLUSH_SIZE = 4 * 1024 * 1024,       // output is written in blocks of about this size
+    CHUNK_RECORDS = 16384,              // records per unit of parallel work
+    MAX_DEPTH = 64,
+};
+
+class FileSchemaProvider : public reflection::ISchemaProvider {
+public:
+    serialization::IReader* openClassSchemaOrNull(const char* className) override {
+        string path = string("schemas/") + className + ".class_schema";
+        FILE* file = fopen(path.c_str(), "rb");
+
+        if (file == nullptr)
+            return nullptr;
+
+        fseek(file, 0, SEEK_END);
+        long length = ftell(file);
+        fseek(file, 0, SEEK_SET);
+
+        Reader* reader = new Reader();
+        reader->data.resize(length > 0 ? length : 0);
+        bool ok = reader->data.empty() || fread(&reader->data[0], 1, reader->data.size(), file) == reader->data.size();
+        fclose(file);
+
+        if (!ok) {
+            delete reader;
+            return nullptr;
+        }
+
+        reader->pos = reinterpret_cast<const uint8_t*>(reader->data.data());
+        reader->end = reader->pos + reader->data.size();
+        return reader;
+    }
+
+    void closeClassSchema(serialization::IReader* reader) override {
+        delete static_cast<Reader*>(reader);
+    }
+
+private:
+    struct Reader final : serialization::BufferReader {
+        string data;
+    };
+};
+
+// A class schema with nested classes resolved up front, so that worker threads never touch the schema cache
+struct Plan {
+    struct Field {
+        const char* name;
+        Tag_t tag;
+        const Plan* nested;
+    };
+
+    vector<Field> fields;
+};
+
+class Planner {
+public:
+    explicit Planner(reflection::ISchemaProvider* sp) : sp(sp) {}
+
+    const Plan* planFor(const string& classId, int depth = 0) {
+        auto it = plans.find(classId);
+
+        if (it != plans.end())
+            return &it->second;
+
+        const reflection::ParsedSchema_t* schema;
+
+        if (depth > MAX_DEPTH || !sp->getParsedSchema(classId.c_str(), schema) || schema == nullptr) {
+            reflection::err->errorf("SchemaMismatch", "No usable schema for class `%s`.", classId.c_str());
+            return nullptr;
+        }
+
+        Plan& plan = plans[classId];
+
+        for (const reflection::SchemaField_t& field : schema->fields) {
+            Plan::Field planField = { field.name.c_str(), field.tag, nullptr };
+
+            if (field.tag == serialization::TAG_CLASS && (planField.nested = planFor(field.fieldClassName, depth + 1)) == nullptr)
+                return nullptr;
+
+            plan.fields.push_back(planField);
+        }
+
+        return &plan;
+    }
+
+private:
+    reflection::ISchemaProvider* sp;
+    map<string, Plan> plans;
+};
+
+struct Cursor {
+    const uint8_t* pos;
+    const uint8_t* end;
+};
+
+static bool truncated() {
+    return reflection::err->error("UnexpectedEOF", "Record truncated."), false;
+}
+
+static bool readSmv(Cursor& in, bool& negative_out, uint64_t& magnitude_out) {
+    switch (serialization::readSmv(in.pos, in.end, negative_out, magnitude_out)) {
+        case serialization::SMV_OK:
+            return true;
+
+        case serialization::SMV_TRUNCATED:
+            return truncated();
+
+        default:
+            return reflection::err->error("IntegerOverflow", "Encoded integer is too long."), false;
+    }
+}
+
+// converts (emit) or just skips (!emit, to find record boundaries) one instance
+template <bool emit>
+static bool convertInstance(const Plan& plan, Cursor& in, JsonWriter& json) {
+    reflection::IErrorHandler* err = reflection::err;
+
+    if (emit && !json.beginObject(err))
+        return false;
+
+    for (const Plan::Field& field : plan.fields) {
+        if (emit && !json.key(err, field.name))
+            return false;
+
+        switch (field.tag) {
+            case serialization::TAG_BOOL:
+            case serialization::TAG_CHAR: {
+                if (in.pos + 1 > in.end)
+                    return truncated();
+
+                uint8_t value = *in.pos++;
+
+                if (emit && !(field.tag == serialization::TAG_BOOL ? json.writeBool(err, value != 0) : json.writeInt(err, value)))
+                    return false;
+                break;
+            }
+
+            case serialization::TAG_SMVINT: {
+                bool negative;
+                uint64_t magnitude;
+
+                if (!readSmv(in, negative, magnitude))
+                    return false;
+
+                if (!emit)
+                    break;
+
+                // signedness is not in the schema; a non-negative value may be a uint64_t that needs all 64 bits
+                if (!negative) {
+                    if (!json.writeUInt(err, magnitude))
+                        return false;
+                }
+                else if (magnitude > (uint64_t) INT64_MAX + 1)
+                    return err->error("IntegerOverflow", "Negative integer is out of range."), false;
+                else if (!json.writeInt(err, (int64_t)(0 - magnitude)))
+                    return false;
+                break;
+            }
+
+            case serialization::TAG_REAL32: {
+                float value;
+
+                if (in.pos + sizeof(value) > in.end)
+                    return truncated();
+
+                memcpy(&value, in.pos, sizeof(value));
+                in.pos += sizeof(value);
+
+                if (emit && !json.writeFloat(err, value))
+                    return false;
+                break;
+            }
+
+            case serialization::TAG_REAL64: {
+                double value;
+
+                if (in.pos + sizeof(value) > in.end)
+                    return truncated();
+
+                memcpy(&value, in.pos, sizeof(value));
+                in.pos += sizeof(value);
+
+                if (emit && !json.writeDouble(err, value))
+                    return false;
+                break;
+            }
+
+            case serialization::TAG_UTF8: {
+                bool negative;
+                uint64_t length;
+
+                if (!readSmv(in, negative, length))
+                    return false;
+
+                if (negative || length > (uint64_t)(in.end - in.pos))
+                    return truncated();
+
+                if (emit && !json.writeString(err, reinterpret_cast<const char*>(in.pos), (size_t) length))
+                    return false;
+
+                in.pos += length;
+                break;
+            }
+
+            case serialization::TAG_CLASS:
+                if (!convertInstance<emit>(*field.nested, in, json))
+                    return false;
+                break;
+
+            default:
+                return err->errorf("UnknownType", "Field `%s` has tag %02X, which cannot be converted.", field.name, field.tag),
+                        false;
+        }
+    }
+
+    return !emit || json.endObject(err);
+}
+
+// writes out and empties `json`
+static bool flushTo(JsonWriter& json, FILE* out) {
+    if (fwrite(json.data(), 1, json.size(), out) != json.size())
+        return reflection::err->error("IOError", "Failed to write the output."), false;
+
+    json.clear();
+    return true;
+}
+
+static bool convertRange(const Plan& plan, Cursor in, JsonWriter& json, FILE* out) {
+    while (in.pos < in.end) {
+        if (!convertInstance<true>(plan, in, json) || !json.endLine(reflection::err))
+            return false;
+
+        if (out != nullptr && json.size() >= FLUSH_SIZE && !flushTo(json, out))
+            return false;
+    }
+
+    return true;
+}
+
+// Splits the input into chunks of CHUNK_RECORDS records (a skip pass, much cheaper than formatting),
+// converts a batch of chunks in parallel and writes their output in order.
+static bool convertParallel(const Plan& plan, Cursor in, unsigned int numThreads, FILE* out) {
+    struct Chunk {
+        Cursor range;
+        JsonWriter json;
+        bool ok;
+    };
+
+    const size_t batchSize = numThreads * 4;
+    vector<Chunk> chunks(batchSize);
+    JsonWriter none;
+
+    while (in.pos < in.end) {
+        size_t numChunks = 0;
+
+        for (; numChunks < batchSize && in.pos < in.end; numChunks++) {
+            Chunk& chunk = chunks[numChunks];
+            chunk.range.pos = in.pos;
+
+            for (size_t i = 0; i < CHUNK_RECORDS && in.pos < in.end; i++) {
+                if (!convertInstance<false>(plan, in, none))
+                    return false;
+            }
+
+            chunk.range.end = in.pos;
+            chunk.json.clear();
+        }
+
+        atomic<size_t> next(0);
+        vector<thread> workers;
+
+        for (unsigned int t = 0; t < numThreads; t++) {
+            workers.emplace_back([&] {
+                for (size_t i; (i = next++) < numChunks; )
+                    chunks[i].ok = convertRange(plan, chunks[i].range, chunks[i].json, nullptr);
+            });
+        }
+
+        for (thread& worker : workers)
+            worker.join();
+
+        for (size_t i = 0; i < numChunks; i++) {
+            if (!chunks[i].ok || !flushTo(chunks[i].json, out))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+static int usage() {
+    fprintf(stderr, "usage: example_jsonl_converter <records file> <classId> [-b <schema bundle>] [-j <threads>] [-o <output>]\n");
+    return -1;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3)
+        return usage();
+
+    const char* inputName = argv[1];
+    const char* classId = argv[2];
+    const char* bundleName = nullptr;
+    const char* outputName = nullptr;
+    unsigned int numThreads = 1;
+
+    for (int i = 3; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-b") == 0)
+            bundleName = argv[i + 1];
+        else if (strcmp(argv[i], "-j") == 0)
+            numThreads = (unsigned int) strtoul(argv[i + 1], nullptr, 10);
+        else if (strcmp(argv[i], "-o") == 0)
+            outputName = argv[i + 1];
+        else
+            return usage();
+    }
+
+    // schemas: parsed once each, then resolved into a Plan
+    reflection::SchemaBundle bundle;
+    reflection::SchemaBundleProvider bundleProvider(bundle);
+    FileSchemaProvider fileProvider;
+
+    if (bundleName != nullptr && !bundle.open(reflection::err, bundleName))
+        return -1;
+
+    reflection::SchemaCache schemas(bundleName != nullptr ? static_cast<reflection::ISchemaProvider*>(&bundleProvider)
+            : &fileProvider);
+    Planner planner(&schemas);
+    const Plan* plan = planner.planFor(classId);
+
+    if (plan == nullptr)
+        return -1;
+
+    // input: mapped, records are read in place
+    int fd = open(inputName, O_RDONLY);
+    struct stat st;
+
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "cannot open '%s'\n", inputName);
+        return -1;
+    }
+
+    const uint8_t* data = nullptr;
+
+    if (st.st_size > 0) {
+        void* p = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (p == MAP_FAILED) {
+            fprintf(stderr, "cannot map '%s'\n", inputName);
+            close(fd);
+            return -1;
+        }
+        madvise(p, (size_t) st.st_size, MADV_SEQUENTIAL);
+        data = reinterpret_cast<const uint8_t*>(p);
+    }
+
+    close(fd);
+
+    FILE* out = (outputName != nullptr) ? fopen(outputName, "wb") : stdout;
+
+    if (out == nullptr) {
+        fprintf(stderr, "cannot create '%s'\n", outputName);
+
+        if (data != nullptr)
+            munmap(const_cast<uint8_t*>(data), (size_t) st.st_size);
+
+        return -1;
+    }
+
+    Cursor in = { data, data + st.st_size };
+    bool ok;
+
+    if (numThreads > 1)
+        ok = convertParallel(*plan, in, numThreads, out);
+    else {
+        JsonWriter json;
+        ok = convertRange(*plan, in, json, out);
+        ok = flushTo(json, out) && ok;
+    }
+
+    // buffered output can still fail here
+    if ((out != stdout ? fclose(out) : fflush(out)) != 0) {
+        fprintf(stderr, "cannot write '%s'\n", (outputName != nullptr) ? outputName : "<stdout>");
+        ok = false;
+    }
+
+    if (data != nullptr)
+        munmap(const_cast<uint8_t*>(data), (size_t) st.st_size);
+
+    return ok ? 0 : 1;
+}
+
+#include <reflection/default_error_handler.cpp>
@@ -29,6 +29,7 @@
 
 #include <reflection/basic_types.hpp>
 #include <reflection/class.hpp>
+#include <reflection/schema_bundle.hpp>
 
 #include <map>
 
@@ -179,14 +180,14 @@ public:
 template <typename C>
 static void dumpSchema() {
     const char* className = reflection::versionedNameOfClass<C>();
-    auto fields = reflection::reflectFieldsStatic<C>();
 
     string path = string("schemas/") + className + ".class_schema";
     FILE* file = fopen(path.c_str(), "wb");
     assert(file != nullptr);
 
+    // serialized once per class and cached, see SchemaBlob
     MyWriter wr(file);
-    serialization::InstanceSerializer<C>::serializeSchema(reflection::err, &wr, className, fields);
+    reflection::schemaBlobOf<C>(reflection::err)->write(reflection::err, &wr);
 
     fclose(file);
 }
@@ -215,6 +216,15 @@ int main(int argc, char** argv) {
     dumpSchema<Sword>();
     dumpSchema<Actor>();
     dumpSchema<GameCharacter>();
+
+    // the same schemas (and those of any other reflected class) as a single file, see SchemaBundleProvider
+    file = fopen("schemas.bundle", "wb");
+    assert(file != nullptr);
+
+    MyWriter bundleWriter(file);
+    reflection::writeSchemaBundle(reflection::err, &bundleWriter);
+
+    fclose(file);
 }
 
 #include <reflection/default_error_handler.cpp>
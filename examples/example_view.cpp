@@ -0,0 +1,95 @@
+/*
+    Boost Software License - Version 1.0 - August 17, 2003
+
+    Permission is hereby granted, free of charge, to any person or organization
+    obtaining a copy of the software and accompanying documentation covered by
+    this license (the "Software") to use, reproduce, display, distribute,
+    execute, and transmit the Software, and to prepare derivative works of the
+    Software, and to permit third-parties to whom the Software is furnished to
+    do so, all subject to the following:
+
+    The copyright notices in the Software and this entire statement, including
+    the above license grant, this restriction and the following disclaimer,
+    must be included in all copies of the Software, in whole or in part, and
+    all derivative works of the Software, unless such copies or derivative
+    works are solely in the form of machine-executable object code generated by
+    a source language processor.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+    SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+    FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+*/
+
+#include <reflection/api.hpp>
+#include <reflection/magic.hpp>
+
+#include <reflection/basic_types.hpp>
+#include <reflection/class.hpp>
+#include <reflection/view.hpp>
+
+#include <cassert>
+
+using namespace std;
+
+struct Order {
+    int64_t id;
+    string customer;
+    string shippingAddress;
+    string notes;
+    int32_t quantity;
+    double unitPrice;
+
+    REFL_BEGIN("Order", 1)
+        REFL_FIELD(id)
+        REFL_FIELD(customer)
+        REFL_FIELD(shippingAddress)
+        REFL_FIELD(notes)
+        REFL_FIELD(quantity)
+        REFL_FIELD(unitPrice)
+    REFL_END
+};
+
+int main(int argc, char** argv) {
+    Order order = { 1001, "ACME Corp.", "1 Infinite Loop", "leave at the door", 12, 9.5 };
+
+    serialization::BufferWriter wr;
+    assert(reflection::reflectSerializeIndexed(order, &wr));
+
+    // only touch the fields we care about; nothing else gets decoded
+    reflection::ReflectedView<Order> view;
+    assert(view.open(wr.data(), wr.size()));
+
+    string customer;
+    int32_t quantity;
+
+    assert(view.get("customer", customer));
+    assert(view.get("quantity", quantity));
+
+    printf("%s ordered %d items (%u bytes, %u fields)\n", customer.c_str(), (int) quantity,
+            (unsigned int) view.size(), (unsigned int) view.count());
+
+    // asking for the wrong type is an error, not a reinterpretation
+    double wrongType;
+    assert(!view.get("customer", wrongType));
+
+    // full decode is still available
+    Order copy;
+    serialization::BufferReader rd(wr.data(), wr.size());
+    assert(reflection::reflectDeserializeIndexed(copy, &rd));
+    printf("%s\n", reflection::reflectToString(copy).c_str());
+}
+
+#include <reflection/default_error_handler.cpp>
+
+/* OUTPUT:
+
+ACME Corp. ordered 12 items (84 bytes, 6 fields)
+
+ERROR `IncorrectType`:	Field `Order::customer` is `std::string`, requested `double`.
+{id="1001", customer="ACME Corp.", shippingAddress="1 Infinite Loop", notes="leave at the door", quantity="12", unitPrice="9.5"}
+
+*/
@@ -118,42 +118,52 @@ bool setDashArgument(Fields& fields, int argc, char* argv[], int& i, const char*
     return false;
 }
 
-template <class Fields>
-bool setDashDashArgument(Fields& fields, int argc, char* argv[], int& i, const char* programName, char argSpecified[]) {
-    for (size_t j = 0; j < fields.count(); j++) {
-        auto field = fields[j];
+// the option spec (e.g. "--verbose") is the part of the field params before the description
+inline const char* optionSpec(const reflection::Field_t& field) {
+    return field.params;
+}
 
-        const char* spec = field.params;
+template <class Command>
+const reflection::FieldNameIndex& optionIndex() {
+    static const reflection::FieldNameIndex index(reflection::reflectFieldsStatic<Command>().fieldSet, &optionSpec);
+    return index;
+}
 
-        if (strcmp(spec, argv[i]) == 0) {
-            if (field.template isType<bool>()) {
-                // --option
-                if (!field.setFromString("1"))
-                    return false;
+template <class Fields>
+bool setDashDashArgument(Fields& fields, const reflection::FieldNameIndex& options, int argc, char* argv[], int& i,
+        const char* programName, char argSpecified[]) {
+    int j = options.find(argv[i]);
 
-                argSpecified[j] = 1;
-                return true;
-            }
-            else {
-                // --option Value
-                ++i;
+    if (j < 0) {
+        fprintf(stderr, "%s: error: unrecognized argument '%s'\n", programName, argv[i]);
+        return false;
+    }
 
-                if (i >= argc) {
-                    fprintf(stderr, "%s: error: expected '%s <%s>'\n", programName, spec, field.name);
-                    return false;
-                }
+    auto field = fields[j];
 
-                if (!field.setFromString(argv[i]))
-                    return false;
+    if (field.template isType<bool>()) {
+        // --option
+        if (!field.setFromString("1"))
+            return false;
 
-                argSpecified[j] = 1;
-                return true;
-            }
-        }
+        argSpecified[j] = 1;
+        return true;
     }
+    else {
+        // --option Value
+        ++i;
 
-    fprintf(stderr, "%s: error: unrecognized argument '%s'\n", programName, argv[i]);
-    return false;
+        if (i >= argc) {
+            fprintf(stderr, "%s: error: expected '%s <%s>'\n", programName, field.params, field.name);
+            return false;
+        }
+
+        if (!field.setFromString(argv[i]))
+            return false;
+
+        argSpecified[j] = 1;
+        return true;
+    }
 }
 
 template <class Fields>
@@ -201,7 +211,7 @@ int execute(const Command_t& cmd, int argc, char* argv[], const char* programNam
             else {
                 // double-dash argument
 
-                if (!setDashDashArgument(fields, argc, argv, i, programName, argSpecified))
+                if (!setDashDashArgument(fields, optionIndex<Command>(), argc, argv, i, programName, argSpecified))
                     return -1;
             }
         }
@@ -234,9 +244,7 @@ void help(const Command_t& cmd, const char* programName, bool full) {
     else
         printf("usage: %s", programName);
 
-    for (size_t j = 0; j < fields.count(); j++) {
-        const auto& field = fields[j];
-
+    for (const auto& field : fields) {
         const char* spec = field.params;
 
         printf(" ");
@@ -262,9 +270,7 @@ void help(const Command_t& cmd, const char* programName, bool full) {
     if (!full)
         return;
 
-    for (size_t j = 0; j < fields.count(); j++) {
-        const auto& field = fields[j];
-
+    for (const auto& field : fields) {
         const char* spec = field.params;
         const char* description = field.params + strlen(spec) + 1;
 
@@ -28,17 +28,20 @@
 
 #include "bufstring.hpp"
 #include "base.hpp"
+#include "binary_program.hpp"
+#include "json.hpp"
+#include "msgpack.hpp"
+#include "string_sink.hpp"
 
 #include <type_traits>
 
 #ifndef REFLECTOR_AVOID_STL
+#include <iterator>
 #include <string>
 #endif
 
 namespace reflection {  // UUID('c3549467-1615-4087-9829-176a2dc44b76')
 
-extern IErrorHandler* err;
-
 template <typename From, typename To>
 struct copy_const {
     typedef To type;
@@ -62,6 +65,10 @@ public:
             field = fieldGetter(inst);
         }
 
+        Field(const Field_t& field_in, const char* className, Ptr_t inst, void* field)
+            : Field_t(field_in), className(className), inst(inst), field(field) {
+        }
+
         void* ptr() { return field; }
         const void* ptr() const { return field; }
 
@@ -74,8 +81,13 @@ public:
         bool isPolymorphic() const { return refl->isPolymorphic(); }
         template <typename T> bool isType() const { return refl == reflectionForType2<T>(); }
         const char* staticTypeName() const { return refl->staticTypeName(); }
-        bool toString(char*& buf, size_t& bufSize) const { return refl->toString(err, buf, bufSize, FIELD_STATE, field); }
-        bool toString(IErrorHandler* err, char*& buf, size_t& bufSize) const { return refl->toString(err, buf, bufSize, FIELD_STATE, field); }
+        bool toString(char*& buf, size_t& bufSize) const { return toString(err, buf, bufSize); }
+        bool toString(IErrorHandler* err, IStringSink* sink) const { return refl->toString(err, sink, FIELD_STATE, field); }
+
+        bool toString(IErrorHandler* err, char*& buf, size_t& bufSize) const {
+            BufStringSink sink(buf, bufSize);
+            return refl->toString(err, &sink, FIELD_STATE, field) && sink.terminate(err);
+        }
         const char* typeName() const { return refl->typeName(field); }
         bool setFromString(IErrorHandler* err, const char* str) { return refl->setFromString(err, str, strlen(str), field); }
 
@@ -83,49 +95,78 @@ public:
         bool setFromString(const std::string& str) { return refl->setFromString(err, str.c_str(), str.length(), field); }
 
         std::string toString() const {
-            char* buf = nullptr;
-            size_t bufSize = 0;
-            AllocGuard guard(buf);
+            BufString_t str;
+            BufStringSink sink(str);
 
-            if (!refl->toString(err, buf, bufSize, FIELD_STATE, field))
+            if (!refl->toString(err, &sink, FIELD_STATE, field))
                 return "";
 
-            return buf;
+            return std::string(sink.data(), sink.length());
         }
 #endif
     };
 
+    typedef typename copy_const<Ptr_t, Field>::type FieldRef_t;
+
+    class iterator {
+    public:
+#ifndef REFLECTOR_AVOID_STL
+        typedef std::forward_iterator_tag iterator_category;
+#endif
+        typedef Field value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const Field* pointer;
+        typedef FieldRef_t reference;
+
+        iterator(const ReflectedFields* fields, size_t index) : fields(fields), index(index) {}
+
+        FieldRef_t operator *() const { return (*fields)[index]; }
+        iterator& operator ++() { index++; return *this; }
+        iterator operator ++(int) { iterator it(*this); index++; return it; }
+
+        bool operator ==(const iterator& other) const { return index == other.index; }
+        bool operator !=(const iterator& other) const { return index != other.index; }
+
+    private:
+        const ReflectedFields* fields;
+        size_t index;
+    };
+
     ReflectedFields(Ptr_t inst, FieldSet_t const* fieldSet)
-            : inst(inst), fieldSet(fieldSet) {
-        // count all fields including base class(es)
-        numFields = 0;
-        for (FieldSet_t const* p_fieldSet = fieldSet; p_fieldSet != nullptr; p_fieldSet = p_fieldSet->baseClassFields) {
-            numFields += p_fieldSet->numFields;
-        }
+            : inst(inst), fieldSet(fieldSet), table(fieldSet->flattened()) {
+        // no fields if the table couldn't be built (already reported)
+        numFields = (table != nullptr) ? table->count : 0;
     }
 
-    typename copy_const<Ptr_t, Field>::type operator [] (size_t index) const {
-        FieldSet_t const* p_fieldSet = fieldSet;
-        Ptr_t p_inst = inst;
+    FieldRef_t operator [] (size_t index) const {
+        const FlatField_t& entry = table->entries[index];
 
-        while (true) {
-            // perhaps the field is in this class?
-            if (index < p_fieldSet->numFields)
-                return Field(p_fieldSet->fields[index], p_fieldSet->className, p_inst);
+        // keep null for reflectFieldsStatic
+        if (inst == nullptr)
+            return Field(*entry.field, entry.className, inst);
 
-            // apparently not; search next base class
-            index -= p_fieldSet->numFields;
-            p_inst = p_fieldSet->derivedPtrToBasePtr(const_cast<void*>(p_inst));
-            p_fieldSet = p_fieldSet->baseClassFields;
-        }
+        Ptr_t p_inst = reinterpret_cast<Ptr_t>(reinterpret_cast<uintptr_t>(inst) + entry.baseOffset);
+
+        if (entry.field->systemFlags & FIELD_HAS_OFFSET)
+            return Field(*entry.field, entry.className, p_inst, reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(inst) + entry.offset));
+
+        return Field(*entry.field, entry.className, p_inst);
     }
 
+    iterator begin() const { return iterator(this, 0); }
+    iterator end() const { return iterator(this, numFields); }
+
     size_t count() const {
         return numFields;
     }
 
+    // position of the field (own or inherited) with this name, or -1; O(1) through the per-class index
+    int indexOf(const char* name, size_t nameLen) const { return fieldSet->nameIndex()->find(name, nameLen); }
+    int indexOf(const char* name) const { return fieldSet->nameIndex()->find(name); }
+
     Ptr_t inst;
     FieldSet_t const* fieldSet;
+    FlatFieldTable_t const* table;
     size_t numFields;
 };
 
@@ -156,9 +197,7 @@ void reflectPrint(T& instance, uint32_t fieldMask = FIELD_STATE | FIELD_CONFIG)
 
     auto fields = reflectFields(instance);
 
-    for (size_t i = 0; i < fields.count(); i++) {
-        const auto& field = fields[i];
-
+    for (const auto& field : fields) {
         if (!(field.systemFlags & fieldMask))
             continue;
 
@@ -182,6 +221,42 @@ bool reflectSerialize(const T& inst, serialization::IWriter* writer) {
     return refl->serialize(err, writer, reinterpret_cast<const void*>(&inst));
 }
 
+// ====================================================================== //
+//  reflectSerializedSize
+// ====================================================================== //
+
+template <typename T>
+bool countSerializedSize(const T& inst, size_t& size_out) {
+    serialization::CountingWriter counter;
+
+    if (!reflectSerialize(inst, &counter))
+        return false;
+
+    size_out = counter.count;
+    return true;
+}
+
+template <typename T>
+bool serializedSizeOf(const T& inst, size_t& size_out, REFL_MATCH_1) {
+    return countSerializedSize(inst, size_out);
+}
+
+#ifdef REFLECTOR_COMPILED_SERIALIZATION
+template <typename T>
+auto serializedSizeOf(const T& inst, size_t& size_out, REFL_MATCH_0)
+        -> decltype(inst.reflection_getFields(REFL_MATCH), bool()) {
+    serialization::BinaryProgram const* program = inst.reflection_getFields(REFL_MATCH)->binaryProgram();
+
+    return (program != nullptr) ? program->serializedSize(err, &inst, size_out) : countSerializedSize(inst, size_out);
+}
+#endif
+
+// number of bytes reflectSerialize would write
+template <typename T>
+bool reflectSerializedSize(const T& inst, size_t& size_out) {
+    return serializedSizeOf(inst, size_out, REFL_MATCH);
+}
+
 // ====================================================================== //
 //  reflectDeserialize
 // ====================================================================== //
@@ -199,15 +274,13 @@ bool reflectDeserialize(T& value_out, serialization::IReader* reader) {
 
 #ifndef REFLECTOR_AVOID_STL
 inline std::string reflectToString(const ReflectedValue_t& val, uint32_t fieldMask = FIELD_STATE) {
-    char* buf = nullptr;
-    size_t bufSize = 0;
+    BufString_t str;
+    BufStringSink sink(str);
 
-    if (!val.refl->toString(err, buf, bufSize, fieldMask, val.p_value))
+    if (!val.refl->toString(err, &sink, fieldMask, val.p_value))
         return "";
 
-    std::string str(buf);
-    free(buf);
-    return std::move(str);
+    return std::string(sink.data(), sink.length());
 }
 
 template <typename T>
@@ -221,18 +294,102 @@ template <typename T>
 std::string reflectToString(const T& inst, uint32_t fieldMask = FIELD_STATE) {
     ITypeReflection* refl = reflectionForType(inst);
 
-    char* buf = nullptr;
-    size_t bufSize = 0;
+    BufString_t str;
+    BufStringSink sink(str);
 
-    if (!refl->toString(err, buf, bufSize, fieldMask, reinterpret_cast<const void*>(&inst)))
+    if (!refl->toString(err, &sink, fieldMask, reinterpret_cast<const void*>(&inst)))
         return "";
 
-    std::string str(buf);
-    free(buf);
-    return std::move(str);
+    return std::string(sink.data(), sink.length());
 }
 #endif
 
+// ====================================================================== //
+//  reflectToJson
+// ====================================================================== //
+
+template <typename T>
+bool reflectToJson(const T& inst, serialization::JsonWriter* writer, uint32_t fieldMask = FIELD_STATE | FIELD_CONFIG) {
+    ITypeReflection* refl = reflectionForType2<T>();
+
+    return refl->toJson(err, writer, fieldMask, reinterpret_cast<const void*>(&inst));
+}
+
+#ifndef REFLECTOR_AVOID_STL
+template <typename T>
+std::string reflectToJson(const T& inst, uint32_t fieldMask = FIELD_STATE | FIELD_CONFIG) {
+    serialization::JsonWriter writer;
+
+    if (!reflectToJson(inst, &writer, fieldMask))
+        return "";
+
+    return std::string(writer.data(), writer.size());
+}
+#endif
+
+// ====================================================================== //
+//  reflectFromJson
+// ====================================================================== //
+
+template <typename T>
+bool reflectFromJson(T& value_out, serialization::JsonReader* reader, uint32_t fieldMask = FIELD_STATE | FIELD_CONFIG) {
+    ITypeReflection* refl = reflectionForType2<T>();
+
+    return refl->setFromJson(err, reader, fieldMask, reinterpret_cast<void*>(&value_out));
+}
+
+// the whole input must be one JSON value
+template <typename T>
+bool reflectFromJson(T& value_out, const char* json, size_t jsonLen, uint32_t fieldMask = FIELD_STATE | FIELD_CONFIG) {
+    serialization::JsonReader reader(json, jsonLen);
+
+    return reflectFromJson(value_out, &reader, fieldMask) && reader.expectEnd(err);
+}
+
+#ifndef REFLECTOR_AVOID_STL
+template <typename T>
+bool reflectFromJson(T& value_out, const std::string& json, uint32_t fieldMask = FIELD_STATE | FIELD_CONFIG) {
+    return reflectFromJson(value_out, json.c_str(), json.length(), fieldMask);
+}
+#endif
+
+// ====================================================================== //
+//  reflectToMsgPack
+// ====================================================================== //
+
+template <typename T>
+bool reflectToMsgPack(const T& inst, serialization::MsgPackWriter* writer, uint32_t fieldMask = FIELD_STATE | FIELD_CONFIG) {
+    ITypeReflection* refl = reflectionForType2<T>();
+
+    return refl->toMsgPack(err, writer, fieldMask, reinterpret_cast<const void*>(&inst));
+}
+
+// ====================================================================== //
+//  reflectFromMsgPack
+// ====================================================================== //
+
+template <typename T>
+bool reflectFromMsgPack(T& value_out, serialization::MsgPackReader* reader, uint32_t fieldMask = FIELD_STATE | FIELD_CONFIG) {
+    ITypeReflection* refl = reflectionForType2<T>();
+
+    return refl->setFromMsgPack(err, reader, fieldMask, reinterpret_cast<void*>(&value_out));
+}
+
+// the whole input must be one MessagePack value
+template <typename T>
+bool reflectFromMsgPack(T& value_out, const void* data, size_t size, uint32_t fieldMask = FIELD_STATE | FIELD_CONFIG) {
+    serialization::MsgPackReader reader(data, size);
+
+    if (!reflectFromMsgPack(value_out, &reader, fieldMask))
+        return false;
+
+    if (!reader.atEnd())
+        return err->errorf("TrailingData", "%u unexpected bytes after MessagePack value.",
+                (unsigned int) reader.remaining()), false;
+
+    return true;
+}
+
 // ====================================================================== //
 //  reflectFromString
 // ====================================================================== //
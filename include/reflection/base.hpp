@@ -61,6 +61,12 @@ class IWriter {
 public:
     virtual bool write(IErrorHandler* err, const void* buffer, size_t count) = 0;
 };
+
+class BinaryProgram;
+class JsonReader;
+class JsonWriter;
+class MsgPackReader;
+class MsgPackWriter;
 }
 
 namespace reflection {
@@ -70,7 +76,21 @@ enum {
     FIELD_CONFIG = 2,
     FIELD_DEPENDENCY = 4,
     FIELD_RESOURCE = 8,
-    FIELD_MANDATORY = 256
+    FIELD_MANDATORY = 256,
+    FIELD_HAS_OFFSET = 512,             // Field_t::offset is valid (set automatically for standard-layout classes)
+};
+
+// coarse classification of a field's type, known at compile time (see TypeKind<T> in magic.hpp);
+// lets encoders handle common types inline instead of going through ITypeReflection
+enum {
+    KIND_OTHER = 0,         // only reachable through ITypeReflection
+    KIND_BOOL,
+    KIND_INT8, KIND_INT16, KIND_INT32, KIND_INT64,
+    KIND_UINT8, KIND_UINT16, KIND_UINT32, KIND_UINT64,
+    KIND_FLOAT, KIND_DOUBLE,
+    KIND_STRING,            // std::string
+    KIND_VECTOR,            // std::vector<T>
+    KIND_CLASS,             // reflected class
 };
 
 struct UUID_t {
@@ -121,6 +141,47 @@ public:
     void notImplemented(const char* functionName) { this->errorf("NotImplemented", "Function `%s` is not implemented.", functionName); }
 };
 
+// process-wide handler, also used by the lazily built per-class tables
+extern IErrorHandler* err;
+
+// Destination for text produced by ITypeReflection::toString. Appends go straight into the window [pos, limit)
+// and only call `overflow` once it fills up, which lets the sink grow its buffer or flush it to a stream.
+class IStringSink {
+public:
+    bool append(IErrorHandler* err, const char* str, size_t strLen) {
+        if (strLen <= (size_t)(limit - pos)) {
+            if (strLen > 0)
+                memcpy(pos, str, strLen);
+
+            pos += strLen;
+            return true;
+        }
+
+        return overflow(err, str, strLen);
+    }
+
+    bool append(IErrorHandler* err, const char* str) { return append(err, str, strlen(str)); }
+
+    bool append(IErrorHandler* err, char c) {
+        if (pos < limit) {
+            *pos++ = c;
+            return true;
+        }
+
+        return overflow(err, &c, 1);
+    }
+
+protected:
+    IStringSink() : pos(nullptr), limit(nullptr) {}
+    ~IStringSink() {}
+
+    // must consume all of `str` and may move the window
+    virtual bool overflow(IErrorHandler* err, const char* str, size_t strLen) = 0;
+
+    char* pos;
+    char* limit;
+};
+
 // general class for type reflection
 class ITypeReflection {
 public:
@@ -136,10 +197,22 @@ public:
 
     virtual bool setFromString(IErrorHandler* err, const char* str, size_t strLen,
             void* p_value) = 0;
-    virtual bool toString(IErrorHandler* err, char*& buf, size_t& bufSize, uint32_t fieldMask,
+    virtual bool toString(IErrorHandler* err, IStringSink* sink, uint32_t fieldMask,
+            const void* p_value) = 0;
+
+    virtual bool setFromJson(IErrorHandler* err, serialization::JsonReader* reader, uint32_t fieldMask,
+            void* p_value) = 0;
+    virtual bool toJson(IErrorHandler* err, serialization::JsonWriter* writer, uint32_t fieldMask,
+            const void* p_value) = 0;
+
+    virtual bool setFromMsgPack(IErrorHandler* err, serialization::MsgPackReader* reader, uint32_t fieldMask,
+            void* p_value) = 0;
+    virtual bool toMsgPack(IErrorHandler* err, serialization::MsgPackWriter* writer, uint32_t fieldMask,
             const void* p_value) = 0;
 };
 
+struct FieldSet_t;
+
 // reflectable class field
 struct Field_t {
     const char* name;                       // statically allocated field name
@@ -147,6 +220,10 @@ struct Field_t {
     uint32_t systemFlags;                   // built-in field flags
     uint32_t flags;                         // user-specified field flags
     const char* params;                     // user-specified field properties or nullptr
+    uint32_t kind;                          // KIND_*
+    ptrdiff_t offset;                       // instance pointer + offset = field pointer, if FIELD_HAS_OFFSET
+    FieldSet_t const* (*classFields)();     // fields of the field's own type, if KIND_CLASS
+    uint32_t elementKind;                   // KIND_* of the elements, if KIND_VECTOR
 
     union {
         ITypeReflection* refl;              // field type information
@@ -154,6 +231,10 @@ struct Field_t {
     };
 };
 
+struct FlatFieldTable_t;
+class FieldNameIndex;
+class SchemaBlob;
+
 // set of all reflectable fields in a class not including base class(es)
 struct FieldSet_t {
     const char* className;
@@ -162,6 +243,64 @@ struct FieldSet_t {
 
     FieldSet_t const* baseClassFields;      // base class fields
     void* (*derivedPtrToBasePtr)(void*);    // helper to convert derived* to base* (which may or may not differ)
+
+    FlatFieldTable_t const* (*flattened)(); // all fields including base classes, built on first use; nullptr if that failed
+    FieldNameIndex const* (*nameIndex)();   // name -> index into `flattened`, built on first use
+    serialization::BinaryProgram const* (*binaryProgram)();    // compiled binary (de)serializer, built on first use; nullptr if that failed
+    SchemaBlob const* (*schemaBlob)(IErrorHandler* err);        // serialized .class_schema, built on first use
+};
+
+// one field of a class or any of its base classes
+struct FlatField_t {
+    Field_t const* field;
+    const char* className;                  // class which declares the field
+    ptrdiff_t baseOffset;                   // most derived* -> declaring class* adjustment, in bytes
+    ptrdiff_t offset;                       // most derived* -> field*, if the field has FIELD_HAS_OFFSET
+};
+
+// Fields of a class followed by those of its base classes (the same order ReflectedFields always had),
+// with base-pointer adjustments accumulated so that any field is reachable in O(1)
+struct FlatFieldTable_t {
+    FlatField_t* entries;
+    size_t count;
+
+    // `probe` must point to (real or pretend) storage for the most derived class; it is only used in pointer arithmetic
+    FlatFieldTable_t(FieldSet_t const* fieldSet, void* probe) : entries(nullptr), count(0) {
+        for (FieldSet_t const* p_fieldSet = fieldSet; p_fieldSet != nullptr; p_fieldSet = p_fieldSet->baseClassFields)
+            count += p_fieldSet->numFields;
+
+        if (count == 0)
+            return;
+
+        entries = (FlatField_t*) malloc(count * sizeof(FlatField_t));
+
+        if (entries == nullptr) {
+            err->allocationError("reflection::FlatFieldTable_t::FlatFieldTable_t");
+            return;
+        }
+
+        size_t i = 0;
+        void* p_base = probe;
+
+        for (FieldSet_t const* p_fieldSet = fieldSet; p_fieldSet != nullptr; p_fieldSet = p_fieldSet->baseClassFields) {
+            for (size_t j = 0; j < p_fieldSet->numFields; j++, i++) {
+                entries[i].field = &p_fieldSet->fields[j];
+                entries[i].className = p_fieldSet->className;
+                entries[i].baseOffset = reinterpret_cast<char*>(p_base) - reinterpret_cast<char*>(probe);
+                entries[i].offset = entries[i].baseOffset + p_fieldSet->fields[j].offset;
+            }
+
+            if (p_fieldSet->derivedPtrToBasePtr != nullptr)
+                p_base = p_fieldSet->derivedPtrToBasePtr(p_base);
+        }
+    }
+
+    FlatFieldTable_t(const FlatFieldTable_t& other) = delete;
+    FlatFieldTable_t& operator =(const FlatFieldTable_t& other) = delete;
+
+    ~FlatFieldTable_t() { free(entries); }
+
+    bool available() const { return count == 0 || entries != nullptr; }
 };
 
 template <class C>
@@ -34,33 +34,30 @@ namespace reflection {  // UUID('c3549467-1615-4087-9829-176a2dc44b76')
 template <typename T>
 class StdVectorReflectionTemplate {
 public:
+    // the string must hold one JSON array
     static bool fromString(IErrorHandler* err, const char* str, size_t strLen, std::vector<T>& value_out) {
-        return err->notImplemented("reflection::StdVectorReflectionTemplate::fromString"), false;
+        serialization::JsonReader reader(str, strLen);
+
+        return serialization::JsonSerializer<std::vector<T>>::deserialize(err, &reader, value_out, FIELD_STATE | FIELD_CONFIG)
+                && reader.expectEnd(err);
     }
 
-    static bool toString(IErrorHandler* err, char*& buf, size_t& bufSize, const std::vector<T>& value) {
-        if (!bufStringSet(err, buf, bufSize, "[", 1))
+    static bool toString(IErrorHandler* err, IStringSink* sink, const std::vector<T>& value) {
+        if (!sink->append(err, '['))
             return false;
 
         ITypeReflection* refl = reflectionForType2<T>();
-        char* ourBuf = nullptr;
-        size_t ourBufSize = 0;
 
         for (size_t i = 0; i < value.size(); i++)
         {
-            if (i > 0 && !bufStringAppend(err, buf, bufSize, ", ", 2))
+            if (i > 0 && !sink->append(err, ", ", 2))
                 return false;
 
-            if (!refl->toString(err, ourBuf, ourBufSize, FIELD_STATE,
-                    reinterpret_cast<const void*>(&value[i]))
-                    || !bufStringAppend(err, buf, bufSize, ourBuf, ourBufSize))
-            {
-                free(ourBuf);
+            if (!refl->toString(err, sink, FIELD_STATE, reinterpret_cast<const void*>(&value[i])))
                 return false;
-            }
         }
 
-        return bufStringAppend(err, buf, bufSize, "]", 1);
+        return sink->append(err, ']');
     }
 };
 #endif
@@ -34,12 +34,12 @@ namespace reflection {  // UUID('c3549467-1615-4087-9829-176a2dc44b76')
 class StdStringReflectionTemplate {
 public:
     static bool fromString(IErrorHandler* err, const char* str, size_t strLen, std::string& value_out) {
-        value_out = str;
+        value_out.assign(str, strLen);
         return true;
     }
 
-    static bool toString(IErrorHandler* err, char*& buf, size_t& bufSize, const std::string& value) {
-        return bufStringSet(err, buf, bufSize, value.c_str(), value.length());
+    static bool toString(IErrorHandler* err, IStringSink* sink, const std::string& value) {
+        return sink->append(err, value.c_str(), value.length());
     }
 };
 #endif
@@ -0,0 +1,449 @@
+/*
+    Boost Software License - Version 1.0 - August 17, 2003
+
+    Permission is hereby granted, free of charge, to any person or organization
+    obtaining a copy of the software and accompanying documentation covered by
+    this license (the "Software") to use, reproduce, display, distribute,
+    execute, and transmit the Software, and to prepare derivative works of the
+    Software, and to permit third-parties to whom the Software is furnished to
+    do so, all subject to the following:
+
+    The copyright notices in the Software and this entire statement, including
+    the above license grant, this restriction and the following disclaimer,
+    must be included in all copies of the Software, in whole or in part, and
+    all derivative works of the Software, unless such copies or derivative
+    works are solely in the form of machine-executable object code generated by
+    a source language processor.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+    SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+    FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "base.hpp"
+#include "buffer_io.hpp"
+#include "serializer.hpp"
+
+namespace serialization {
+
+enum {
+    OP_BYTES,               // raw copy of `size` bytes (8-bit integers, floats and runs of them)
+    OP_BOOL,
+    OP_SMV_INT16, OP_SMV_INT32, OP_SMV_INT64,
+    OP_SMV_UINT16, OP_SMV_UINT32, OP_SMV_UINT64,
+    OP_STRING,              // std::string
+    OP_CLASS,               // nested class that couldn't be inlined: runs `program`
+    OP_DYNAMIC,             // anything else, through ITypeReflection
+};
+
+struct BinaryOp_t {
+    uint32_t code;                          // OP_*
+    uint32_t size;                          // OP_BYTES: number of bytes
+    ptrdiff_t offset;                       // field = instance + offset, unless `getter` is set
+    ptrdiff_t baseOffset;                   // field = getter(instance + baseOffset)
+    void* (*getter)(const void*);
+    uint32_t kind;                          // KIND_* and element KIND_* of the field (see Field_t), for validation
+    uint32_t elementKind;
+
+    union {
+        reflection::ITypeReflection* refl;  // OP_DYNAMIC
+        BinaryProgram const* program;       // OP_CLASS
+    };
+};
+
+// The flattened field list of a class compiled into a flat array of ops, with nested classes inlined where their
+// offsets are known and adjacent raw fields merged into a single copy. Produces exactly the same bytes as the
+// per-field InstanceSerializer, but skips Field construction, virtual calls and hooks for all built-in types.
+// Dependencies (REFL_DEPENDENCY) are not part of the state and are left out.
+class BinaryProgram {
+public:
+    explicit BinaryProgram(reflection::FieldSet_t const* fieldSet) : ops(nullptr), numOps(0), capacity(0) {
+        complete = compile(fieldSet, 0);
+    }
+
+    ~BinaryProgram() { free(ops); }
+
+    BinaryProgram(const BinaryProgram& other) = delete;
+    BinaryProgram& operator =(const BinaryProgram& other) = delete;
+
+    // false if a table couldn't be allocated (already reported)
+    bool available() const { return complete; }
+
+    bool serialize(IErrorHandler* err, IWriter* writer, const void* inst) const {
+        OutputBuffer out(writer);
+        return run(err, out, reinterpret_cast<const uint8_t*>(inst)) && out.flush(err);
+    }
+
+    bool deserialize(IErrorHandler* err, IReader* reader, void* inst) const {
+        for (size_t i = 0; i < numOps; i++) {
+            const BinaryOp_t& op = ops[i];
+            void* p = address(op, reinterpret_cast<const uint8_t*>(inst));
+
+            switch (op.code) {
+                case OP_BYTES:
+                    if (!reader->read(err, p, op.size))
+                        return false;
+                    break;
+
+                case OP_BOOL:
+                    if (!Serializer<bool>::deserialize(err, reader, *reinterpret_cast<bool*>(p)))
+                        return false;
+                    break;
+
+                case OP_SMV_INT16:  if (!readSmv<int16_t>(err, reader, p)) return false; break;
+                case OP_SMV_INT32:  if (!readSmv<int32_t>(err, reader, p)) return false; break;
+                case OP_SMV_INT64:  if (!readSmv<int64_t>(err, reader, p)) return false; break;
+                case OP_SMV_UINT16: if (!readSmv<uint16_t>(err, reader, p)) return false; break;
+                case OP_SMV_UINT32: if (!readSmv<uint32_t>(err, reader, p)) return false; break;
+                case OP_SMV_UINT64: if (!readSmv<uint64_t>(err, reader, p)) return false; break;
+
+#ifndef REFLECTOR_AVOID_STL
+                case OP_STRING:
+                    if (!readString(err, reader, *reinterpret_cast<std::string*>(p)))
+                        return false;
+                    break;
+#endif
+
+                case OP_CLASS:
+                    if (!op.program->deserialize(err, reader, p))
+                        return false;
+                    break;
+
+                default:
+                    if (!op.refl->deserialize(err, reader, p))
+                        return false;
+            }
+        }
+
+        return true;
+    }
+
+    // number of bytes `serialize` would produce
+    bool serializedSize(IErrorHandler* err, const void* inst, size_t& size_out) const {
+        size_t size = 0;
+        uint8_t scratch[SmvIntSerializer<uint64_t>::MAX_ENCODED_SIZE];
+
+        for (size_t i = 0; i < numOps; i++) {
+            const BinaryOp_t& op = ops[i];
+            const void* p = address(op, reinterpret_cast<const uint8_t*>(inst));
+
+            switch (op.code) {
+                case OP_BYTES:      size += op.size; break;
+                case OP_BOOL:       size += 1; break;
+                case OP_SMV_INT16:  size += SmvIntSerializer<int16_t>::encodeValue(scratch, load<int16_t>(p)); break;
+                case OP_SMV_INT32:  size += SmvIntSerializer<int32_t>::encodeValue(scratch, load<int32_t>(p)); break;
+                case OP_SMV_INT64:  size += SmvIntSerializer<int64_t>::encodeValue(scratch, load<int64_t>(p)); break;
+                case OP_SMV_UINT16: size += SmvIntSerializer<uint16_t>::encodeValue(scratch, load<uint16_t>(p)); break;
+                case OP_SMV_UINT32: size += SmvIntSerializer<uint32_t>::encodeValue(scratch, load<uint32_t>(p)); break;
+                case OP_SMV_UINT64: size += SmvIntSerializer<uint64_t>::encodeValue(scratch, load<uint64_t>(p)); break;
+
+#ifndef REFLECTOR_AVOID_STL
+                case OP_STRING: {
+                    size_t length = reinterpret_cast<const std::string*>(p)->length();
+                    size += SmvIntSerializer<size_t>::encodeValue(scratch, length) + length;
+                    break;
+                }
+#endif
+
+                case OP_CLASS: {
+                    size_t nestedSize;
+
+                    if (!op.program->serializedSize(err, p, nestedSize))
+                        return false;
+
+                    size += nestedSize;
+                    break;
+                }
+
+                default: {
+                    CountingWriter counter;
+
+                    if (!op.refl->serialize(err, &counter, p))
+                        return false;
+
+                    size += counter.count;
+                }
+            }
+        }
+
+        size_out = size;
+        return true;
+    }
+
+    size_t count() const { return numOps; }
+    const BinaryOp_t& operator [](size_t index) const { return ops[index]; }
+
+private:
+    // batches small writes so that the IWriter is called once per few hundred bytes rather than once per field
+    struct OutputBuffer {
+        enum { CAPACITY = 512 };
+
+        OutputBuffer(IWriter* writer) : writer(writer), used(0) {}
+
+        uint8_t* reserve(IErrorHandler* err, size_t count) {
+            if (used + count > CAPACITY && !flush(err))
+                return nullptr;
+
+            return buf + used;
+        }
+
+        bool write(IErrorHandler* err, const void* data, size_t count) {
+            if (count > CAPACITY / 2)
+                return flush(err) && writer->write(err, data, count);
+
+            uint8_t* p = reserve(err, count);
+
+            if (p == nullptr)
+                return false;
+
+            memcpy(p, data, count);
+            used += count;
+            return true;
+        }
+
+        bool flush(IErrorHandler* err) {
+            if (used == 0)
+                return true;
+
+            size_t count = used;
+            used = 0;
+            return writer->write(err, buf, count);
+        }
+
+        IWriter* writer;
+        size_t used;
+        uint8_t buf[CAPACITY];
+    };
+
+    template <typename T>
+    static bool writeSmv(IErrorHandler* err, OutputBuffer& out, const void* p) {
+        uint8_t* dst = out.reserve(err, SmvIntSerializer<T>::MAX_ENCODED_SIZE);
+
+        if (dst == nullptr)
+            return false;
+
+        out.used += SmvIntSerializer<T>::encodeValue(dst, load<T>(p));
+        return true;
+    }
+
+    template <typename T>
+    static bool readSmv(IErrorHandler* err, IReader* reader, void* p) {
+        T value;
+
+        if (!SmvIntSerializer<T>::deserializeValue(err, reader, value))
+            return false;
+
+        memcpy(p, &value, sizeof(value));
+        return true;
+    }
+
+    // fields are accessed by size and signedness only (e.g. `long long` as int64_t), hence memcpy rather than a cast
+    template <typename T>
+    static T load(const void* p) {
+        T value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    bool run(IErrorHandler* err, OutputBuffer& out, const uint8_t* inst) const {
+        for (size_t i = 0; i < numOps; i++) {
+            const BinaryOp_t& op = ops[i];
+            const void* p = address(op, inst);
+
+            switch (op.code) {
+                case OP_BYTES:
+                    if (!out.write(err, p, op.size))
+                        return false;
+                    break;
+
+                case OP_BOOL: {
+                    uint8_t normalizedValue = *reinterpret_cast<const bool*>(p) ? 0x01 : 0x00;
+
+                    if (!out.write(err, &normalizedValue, 1))
+                        return false;
+                    break;
+                }
+
+                case OP_SMV_INT16:  if (!writeSmv<int16_t>(err, out, p)) return false; break;
+                case OP_SMV_INT32:  if (!writeSmv<int32_t>(err, out, p)) return false; break;
+                case OP_SMV_INT64:  if (!writeSmv<int64_t>(err, out, p)) return false; break;
+                case OP_SMV_UINT16: if (!writeSmv<uint16_t>(err, out, p)) return false; break;
+                case OP_SMV_UINT32: if (!writeSmv<uint32_t>(err, out, p)) return false; break;
+                case OP_SMV_UINT64: if (!writeSmv<uint64_t>(err, out, p)) return false; break;
+
+#ifndef REFLECTOR_AVOID_STL
+                case OP_STRING: {
+                    const std::string& value = *reinterpret_cast<const std::string*>(p);
+                    size_t length = value.length();
+
+                    if (!writeSmv<size_t>(err, out, &length) || !out.write(err, value.data(), length))
+                        return false;
+                    break;
+                }
+#endif
+
+                case OP_CLASS:
+                    if (!op.program->run(err, out, reinterpret_cast<const uint8_t*>(p)))
+                        return false;
+                    break;
+
+                default:
+                    if (!out.flush(err) || !op.refl->serialize(err, out.writer, p))
+                        return false;
+            }
+        }
+
+        return true;
+    }
+
+#ifndef REFLECTOR_AVOID_STL
+    static bool readString(IErrorHandler* err, IReader* reader, std::string& value_out) {
+        uint64_t length;
+
+        if (!SmvIntSerializer<uint64_t>::deserializeValue(err, reader, length))
+            return false;
+
+        value_out.clear();
+
+        // grow in steps, so that a corrupt length fails on end of input instead of allocating it all up front
+        for (size_t have = 0; have < length; ) {
+            size_t chunk = (length - have < 4096) ? (size_t)(length - have) : 4096;
+
+            value_out.resize(have + chunk);
+
+            if (!reader->read(err, &value_out[have], chunk))
+                return false;
+
+            have += chunk;
+        }
+
+        return true;
+    }
+#endif
+
+    static void* address(const BinaryOp_t& op, const uint8_t* inst) {
+        if (op.getter != nullptr)
+            return op.getter(inst + op.baseOffset);
+
+        return const_cast<uint8_t*>(inst + op.offset);
+    }
+
+    bool compile(reflection::FieldSet_t const* fieldSet, ptrdiff_t at) {
+        reflection::FlatFieldTable_t const* table = fieldSet->flattened();
+
+        if (table == nullptr)
+            return false;
+
+        for (size_t i = 0; i < table->count; i++) {
+            const reflection::FlatField_t& entry = table->entries[i];
+            const reflection::Field_t& field = *entry.field;
+
+            if (field.systemFlags & reflection::FIELD_DEPENDENCY)
+                continue;
+
+            BinaryOp_t op;
+            op.size = 0;
+            op.kind = field.kind;
+            op.elementKind = field.elementKind;
+
+            if (field.systemFlags & reflection::FIELD_HAS_OFFSET) {
+                op.offset = at + entry.offset;
+                op.baseOffset = 0;
+                op.getter = nullptr;
+            }
+            else {
+                op.offset = 0;
+                op.baseOffset = at + entry.baseOffset;
+                op.getter = field.fieldGetter;
+            }
+
+            switch (field.kind) {
+                case reflection::KIND_BOOL:     op.code = OP_BOOL; break;
+                case reflection::KIND_INT8:
+                case reflection::KIND_UINT8:    op.code = OP_BYTES; op.size = 1; break;
+                case reflection::KIND_INT16:    op.code = OP_SMV_INT16; break;
+                case reflection::KIND_INT32:    op.code = OP_SMV_INT32; break;
+                case reflection::KIND_INT64:    op.code = OP_SMV_INT64; break;
+                case reflection::KIND_UINT16:   op.code = OP_SMV_UINT16; break;
+                case reflection::KIND_UINT32:   op.code = OP_SMV_UINT32; break;
+                case reflection::KIND_UINT64:   op.code = OP_SMV_UINT64; break;
+                case reflection::KIND_FLOAT:    op.code = OP_BYTES; op.size = sizeof(float); break;
+                case reflection::KIND_DOUBLE:   op.code = OP_BYTES; op.size = sizeof(double); break;
+                case reflection::KIND_STRING:   op.code = OP_STRING; break;
+
+                case reflection::KIND_CLASS:
+                    // a member object has exactly its declared type, so its fields can be laid out in place
+                    if (op.getter == nullptr) {
+                        if (!compile(field.classFields(), op.offset))
+                            return false;
+                        continue;
+                    }
+
+                    op.code = OP_CLASS;
+                    op.program = field.classFields()->binaryProgram();
+
+                    if (op.program == nullptr)
+                        return false;
+                    break;
+
+                default:
+                    op.code = OP_DYNAMIC;
+                    op.refl = field.refl;
+            }
+
+            if (op.code != OP_CLASS && op.code != OP_DYNAMIC)
+                op.refl = nullptr;
+
+            if (!append(op))
+                return false;
+        }
+
+        return true;
+    }
+
+    bool append(const BinaryOp_t& op) {
+        if (numOps > 0) {
+            BinaryOp_t& last = ops[numOps - 1];
+
+            // merge with the previous op if both are raw and adjacent in memory
+            if (op.code == OP_BYTES && last.code == OP_BYTES && op.getter == nullptr && last.getter == nullptr
+                    && last.offset + (ptrdiff_t) last.size == op.offset) {
+                last.size += op.size;
+                return true;
+            }
+        }
+
+        if (numOps == capacity) {
+            size_t newCapacity = (capacity != 0) ? capacity * 2 : 8;
+            BinaryOp_t* newOps = (BinaryOp_t*) realloc(ops, newCapacity * sizeof(BinaryOp_t));
+
+            if (newOps == nullptr)
+                return reflection::err->allocationError("serialization::BinaryProgram::append"), false;
+
+            ops = newOps;
+            capacity = newCapacity;
+        }
+
+        ops[numOps++] = op;
+        return true;
+    }
+
+    BinaryOp_t* ops;
+    size_t numOps;
+    size_t capacity;
+    bool complete;
+};
+
+// nullptr if the program couldn't be built (already reported)
+template <class C>
+BinaryProgram const* binaryProgramOf() {
+    static const BinaryProgram program(C::template reflection_s_getFields<C>(REFL_MATCH));
+    return program.available() ? &program : nullptr;
+}
+}
@@ -0,0 +1,115 @@
+/*
+    Boost Software License - Version 1.0 - August 17, 2003
+
+    Permission is hereby granted, free of charge, to any person or organization
+    obtaining a copy of the software and accompanying documentation covered by
+    this license (the "Software") to use, reproduce, display, distribute,
+    execute, and transmit the Software, and to prepare derivative works of the
+    Software, and to permit third-parties to whom the Software is furnished to
+    do so, all subject to the following:
+
+    The copyright notices in the Software and this entire statement, including
+    the above license grant, this restriction and the following disclaimer,
+    must be included in all copies of the Software, in whole or in part, and
+    all derivative works of the Software, unless such copies or derivative
+    works are solely in the form of machine-executable object code generated by
+    a source language processor.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+    SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+    FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "base.hpp"
+#include "bufstring.hpp"
+
+namespace serialization {
+
+// IReader over a caller-owned block of memory
+class BufferReader : public IReader {
+public:
+    BufferReader() : pos(nullptr), end(nullptr) {}
+    BufferReader(const void* data, size_t size)
+            : pos(reinterpret_cast<const uint8_t*>(data)), end(reinterpret_cast<const uint8_t*>(data) + size) {}
+
+    virtual bool read(IErrorHandler* err, void* buffer, size_t count) override {
+        if (count > (size_t)(end - pos))
+            return err->unexpectedEndOfInput(":buffer"), false;
+
+        memcpy(buffer, pos, count);
+        pos += count;
+        return true;
+    }
+
+    size_t remaining() const { return end - pos; }
+
+    const uint8_t* pos;
+    const uint8_t* end;
+};
+
+// IWriter appending to a growable heap buffer
+class BufferWriter : public IWriter {
+public:
+    BufferWriter() : buf(nullptr), bufSize(0), length(0) {}
+    ~BufferWriter() { free(buf); }
+
+    BufferWriter(const BufferWriter& other) = delete;
+    BufferWriter& operator =(const BufferWriter& other) = delete;
+
+    virtual bool write(IErrorHandler* err, const void* buffer, size_t count) override {
+        if (length + count > bufSize
+                && !reflection::ensureSize(err, buf, bufSize, growTo(length + count)))
+            return false;
+
+        memcpy(buf + length, buffer, count);
+        length += count;
+        return true;
+    }
+
+    void clear() { length = 0; }
+
+    const void* data() const { return buf; }
+    size_t size() const { return length; }
+
+    char* buf;
+    size_t bufSize;
+    size_t length;
+
+private:
+    size_t growTo(size_t needed) const {
+        size_t newSize = bufSize * 2;
+        return newSize > needed ? newSize : needed;
+    }
+};
+
+// IWriter that only counts bytes, to measure the serialized size of a value
+class CountingWriter : public IWriter {
+public:
+    CountingWriter() : count(0) {}
+
+    virtual bool write(IErrorHandler* err, const void* buffer, size_t count) override {
+        this->count += count;
+        return true;
+    }
+
+    size_t count;
+};
+
+// fixed-width little-endian integers, used where a field must be addressable without decoding its neighbours
+inline void storeU32LE(uint8_t* p, uint32_t value) {
+    p[0] = (uint8_t)(value);
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+inline uint32_t loadU32LE(const uint8_t* p) {
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+}
@@ -0,0 +1,324 @@
+/*
+    Boost Software License - Version 1.0 - August 17, 2003
+
+    Permission is hereby granted, free of charge, to any person or organization
+    obtaining a copy of the software and accompanying documentation covered by
+    this license (the "Software") to use, reproduce, display, distribute,
+    execute, and transmit the Software, and to prepare derivative works of the
+    Software, and to permit third-parties to whom the Software is furnished to
+    do so, all subject to the following:
+
+    The copyright notices in the Software and this entire statement, including
+    the above license grant, this restriction and the following disclaimer,
+    must be included in all copies of the Software, in whole or in part, and
+    all derivative works of the Software, unless such copies or derivative
+    works are solely in the form of machine-executable object code generated by
+    a source language processor.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+    SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+    FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include <cerrno>
+#include <clocale>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+#if defined(__has_include)
+#if __has_include(<charconv>) && (__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+#include <charconv>
+#endif
+#endif
+
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+#define REFLECTOR_HAVE_FLOAT_TO_CHARS
+#endif
+
+namespace reflection {  // UUID('c3549467-1615-4087-9829-176a2dc44b76')
+
+// Number <-> text conversions that neither allocate nor depend on the C locale.
+// Formatting functions write into a caller-provided buffer (no terminating NUL) and return the number of chars written.
+
+enum {
+    MAX_INT_CHARS = 20,         // "-9223372036854775808", "18446744073709551615"
+    MAX_FLOAT_CHARS = 32,       // shortest round-trip double plus sign and exponent
+};
+
+inline const char* digitPairs() {
+    static const char pairs[201] =
+            "00010203040506070809" "10111213141516171819" "20212223242526272829" "30313233343536373839"
+            "40414243444546474849" "50515253545556575859" "60616263646566676869" "70717273747576777879"
+            "80818283848586878889" "90919293949596979899";
+    return pairs;
+}
+
+inline size_t formatUInt(char* buf, uint64_t value) {
+    char tmp[MAX_INT_CHARS];
+    char* p = tmp + sizeof(tmp);
+    const char* pairs = digitPairs();
+
+    while (value >= 100) {
+        unsigned int i = (unsigned int)(value % 100) * 2;
+        value /= 100;
+        *--p = pairs[i + 1];
+        *--p = pairs[i];
+    }
+
+    if (value >= 10) {
+        unsigned int i = (unsigned int) value * 2;
+        *--p = pairs[i + 1];
+        *--p = pairs[i];
+    }
+    else
+        *--p = (char)('0' + value);
+
+    size_t length = tmp + sizeof(tmp) - p;
+    memcpy(buf, p, length);
+    return length;
+}
+
+inline size_t formatInt(char* buf, int64_t value) {
+    if (value < 0) {
+        *buf = '-';
+        // negate in unsigned arithmetic so that INT64_MIN doesn't overflow
+        return 1 + formatUInt(buf + 1, 0 - (uint64_t) value);
+    }
+
+    return formatUInt(buf, (uint64_t) value);
+}
+
+// printf-based fallback: the shortest %g precision that reads back to the same value
+template <typename Float_t>
+size_t formatFloatFallback(char* buf, Float_t value, int minPrecision, int maxPrecision) {
+    int length = 0;
+
+    for (int precision = minPrecision; precision <= maxPrecision; precision++) {
+        length = snprintf(buf, MAX_FLOAT_CHARS, "%.*g", precision, (double) value);
+
+        if ((Float_t) strtod(buf, nullptr) == value)
+            break;
+    }
+
+    // snprintf honours LC_NUMERIC; the output must not
+    for (int i = 0; i < length; i++)
+        if (buf[i] == ',')
+            buf[i] = '.';
+
+    return (size_t) length;
+}
+
+// Shortest representation that parses back to exactly `value`. The caller handles NaN and infinities.
+inline size_t formatDouble(char* buf, double value) {
+#ifdef REFLECTOR_HAVE_FLOAT_TO_CHARS
+    return std::to_chars(buf, buf + MAX_FLOAT_CHARS, value).ptr - buf;
+#else
+    return formatFloatFallback<double>(buf, value, 15, 17);
+#endif
+}
+
+inline size_t formatFloat(char* buf, float value) {
+#ifdef REFLECTOR_HAVE_FLOAT_TO_CHARS
+    return std::to_chars(buf, buf + MAX_FLOAT_CHARS, value).ptr - buf;
+#else
+    return formatFloatFallback<float>(buf, value, 6, 9);
+#endif
+}
+
+enum ParseResult_t {
+    PARSE_OK,
+    PARSE_INVALID,          // not a number of the expected form
+    PARSE_OUT_OF_RANGE,     // well-formed, but doesn't fit the target type
+};
+
+// Integer in the given base (2..16, no prefix) with an optional leading '-'; the whole of [str, str + strLen)
+// must be consumed. The range check is exact for every width, including the most negative value of signed types.
+template <typename Int_t>
+ParseResult_t parseInteger(const char* str, size_t strLen, Int_t& value_out, unsigned int base = 10) {
+    typedef std::numeric_limits<Int_t> Limits;
+
+    const char* p = str;
+    const char* end = str + strLen;
+    bool negative = false;
+
+    if (p != end && *p == '-') {
+        negative = true;
+        p++;
+    }
+
+    if (p == end)
+        return PARSE_INVALID;
+
+    uint64_t magnitude = 0;
+    bool overflow = false;
+
+    for (; p != end; p++) {
+        unsigned int digit;
+
+        if (*p >= '0' && *p <= '9')
+            digit = (unsigned int)(*p - '0');
+        else if (*p >= 'a' && *p <= 'f')
+            digit = (unsigned int)(*p - 'a' + 10);
+        else if (*p >= 'A' && *p <= 'F')
+            digit = (unsigned int)(*p - 'A' + 10);
+        else
+            return PARSE_INVALID;
+
+        if (digit >= base)
+            return PARSE_INVALID;
+
+        if (magnitude > (UINT64_MAX - digit) / base)
+            overflow = true;
+
+        magnitude = magnitude * base + digit;
+    }
+
+    if (overflow)
+        return PARSE_OUT_OF_RANGE;
+
+    if (!negative) {
+        if (magnitude > (uint64_t) Limits::max())
+            return PARSE_OUT_OF_RANGE;
+
+        value_out = (Int_t) magnitude;
+    }
+    else {
+        if (!Limits::is_signed) {
+            if (magnitude != 0)
+                return PARSE_OUT_OF_RANGE;
+
+            value_out = 0;
+            return PARSE_OK;
+        }
+
+        // |min| = max + 1 for two's complement
+        if (magnitude > (uint64_t) Limits::max() + 1)
+            return PARSE_OUT_OF_RANGE;
+
+        value_out = (Int_t)(0 - magnitude);
+    }
+
+    return PARSE_OK;
+}
+
+// Integer literal as accepted by strtol with base 0: optional sign, then a 0x/0X (hexadecimal) or 0 (octal) prefix
+template <typename Int_t>
+ParseResult_t parseIntegerLiteral(const char* str, size_t strLen, Int_t& value_out) {
+    const char* end = str + strLen;
+    bool negative = false;
+
+    if (str != end && (*str == '-' || *str == '+')) {
+        negative = (*str == '-');
+        str++;
+    }
+
+    unsigned int base = 10;
+
+    if (end - str > 2 && str[0] == '0' && (str[1] == 'x' || str[1] == 'X')) {
+        base = 16;
+        str += 2;
+    }
+    else if (end - str > 1 && str[0] == '0') {
+        base = 8;
+        str++;
+    }
+
+    // parseInteger would accept a second sign
+    if (str != end && *str == '-')
+        return PARSE_INVALID;
+
+    if (!negative)
+        return parseInteger(str, end - str, value_out, base);
+
+    uint64_t magnitude;
+    ParseResult_t result = parseInteger(str, end - str, magnitude, base);
+
+    if (result != PARSE_OK)
+        return result;
+
+    if (magnitude == 0) {
+        value_out = 0;
+        return PARSE_OK;
+    }
+
+    if (!std::numeric_limits<Int_t>::is_signed || magnitude > (uint64_t) std::numeric_limits<Int_t>::max() + 1)
+        return PARSE_OUT_OF_RANGE;
+
+    value_out = (Int_t)(0 - magnitude);
+    return PARSE_OK;
+}
+
+// parseFloat through strtod, which wants a terminated string in the current locale's notation. A value too small
+// for the type becomes a denormal or zero; one too large is out of range.
+template <typename Float_t>
+ParseResult_t parseFloatStrtod(const char* str, size_t strLen, Float_t& value_out) {
+    char buf[128];
+
+    if (strLen == 0 || strLen >= sizeof(buf))
+        return PARSE_INVALID;
+
+    const char decimalPoint = *localeconv()->decimal_point;
+
+    for (size_t i = 0; i < strLen; i++) {
+        if (str[i] == ',' || (str[i] == decimalPoint && decimalPoint != '.'))
+            return PARSE_INVALID;
+
+        // strtod would also take hexadecimal floats ("0x10", "0x1p4")
+        if (str[i] == 'x' || str[i] == 'X' || str[i] == 'p' || str[i] == 'P')
+            return PARSE_INVALID;
+
+        buf[i] = (str[i] == '.') ? decimalPoint : str[i];
+    }
+
+    buf[strLen] = 0;
+
+    char* end;
+    errno = 0;
+    double value = strtod(buf, &end);
+
+    if (end != buf + strLen || buf[0] == ' ' || buf[0] == '+')
+        return PARSE_INVALID;
+
+    if (errno == ERANGE && (value > 1.0 || value < -1.0))
+        return PARSE_OUT_OF_RANGE;
+
+    // finite doubles that overflow a float; an explicit "inf" is fine
+    if (!std::isinf(value) && (value > (double) std::numeric_limits<Float_t>::max()
+            || value < -(double) std::numeric_limits<Float_t>::max()))
+        return PARSE_OUT_OF_RANGE;
+
+    value_out = (Float_t) value;
+    return PARSE_OK;
+}
+
+// The whole of [str, str + strLen) must be a decimal floating-point number.
+template <typename Float_t>
+ParseResult_t parseFloat(const char* str, size_t strLen, Float_t& value_out) {
+#ifdef REFLECTOR_HAVE_FLOAT_TO_CHARS
+    Float_t value;
+    auto result = std::from_chars(str, str + strLen, value);
+
+    // from_chars reports underflow as out of range too; strtod tells the two apart, so both builds agree
+    if (result.ec == std::errc::result_out_of_range)
+        return (result.ptr == str + strLen) ? parseFloatStrtod(str, strLen, value_out) : PARSE_INVALID;
+
+    if (result.ec != std::errc() || result.ptr != str + strLen)
+        return PARSE_INVALID;
+
+    value_out = value;
+    return PARSE_OK;
+#else
+    return parseFloatStrtod(str, strLen, value_out);
+#endif
+}
+}
@@ -27,49 +27,39 @@
 #pragma once
 
 #include "api.hpp"
+#include "json.hpp"
+#include "msgpack.hpp"
+#include "registry.hpp"
 #include "serialization_manager.hpp"
 
 namespace reflection {  // UUID('c3549467-1615-4087-9829-176a2dc44b76')
 
 template <typename Fields>
-bool fieldsToBufString(IErrorHandler* err, char*& buf, size_t& bufSize, const Fields& fields, uint32_t fieldMask) {
-    if (!bufStringSet(err, buf, bufSize, "{", 1))
+bool fieldsToString(IErrorHandler* err, IStringSink* sink, const Fields& fields, uint32_t fieldMask) {
+    if (!sink->append(err, '{'))
         return false;
 
-    char* fieldAsString = nullptr;
-    size_t fieldAsStringSize = 0;
-
-    AllocGuard guard(fieldAsString);
     bool first = true;
 
-    for (size_t i = 0; i < fields.count(); i++) {
-        const auto& field = fields[i];
-
+    for (const auto& field : fields) {
         if (!(field.systemFlags & fieldMask))
             continue;
 
         if (!first) {
-            if (!bufStringAppend(err, buf, bufSize, ", ", 2))
+            if (!sink->append(err, ", ", 2))
                 return false;
         }
         else
             first = false;
 
-        if (!field.toString(err, fieldAsString, fieldAsStringSize))
-            return false;
-
-        if (!bufStringAppend(err, buf, bufSize, field.name, strlen(field.name))
-                || !bufStringAppend(err, buf, bufSize, "=\"", 2)
-                || !bufStringAppend(err, buf, bufSize, fieldAsString, strlen(fieldAsString))
-                || !bufStringAppend(err, buf, bufSize, "\"", 1))
+        if (!sink->append(err, field.name)
+                || !sink->append(err, "=\"", 2)
+                || !field.toString(err, sink)
+                || !sink->append(err, '"'))
             return false;
-
     }
 
-    if (!bufStringAppend(err, buf, bufSize, "}", 1))
-        return false;
-
-    return true;
+    return sink->append(err, '}');
 }
 
 template <class C>
@@ -96,6 +86,13 @@ class ClassReflection : public ITypeReflection {
     virtual bool serialize(IErrorHandler* err, serialization::IWriter* writer, const void* p_value) override {
         const C& instance = *reinterpret_cast<const C*>(p_value);
 
+#ifdef REFLECTOR_COMPILED_SERIALIZATION
+        serialization::BinaryProgram const* program = instance.reflection_getFields(REFL_MATCH)->binaryProgram();
+
+        if (program != nullptr)
+            return program->serialize(err, writer, p_value);
+#endif
+
         const auto fields = reflectFields(instance);
 
         return serialization::SerializationManager<C>::serializeInstance(
@@ -105,6 +102,13 @@ class ClassReflection : public ITypeReflection {
     virtual bool deserialize(IErrorHandler* err, serialization::IReader* reader, void* p_value) override {
         C& instance = *reinterpret_cast<C*>(p_value);
 
+#ifdef REFLECTOR_COMPILED_SERIALIZATION
+        serialization::BinaryProgram const* program = instance.reflection_getFields(REFL_MATCH)->binaryProgram();
+
+        if (program != nullptr)
+            return program->deserialize(err, reader, p_value);
+#endif
+
         auto fields = reflectFields(instance);
 
         return serialization::SerializationManager<C>::deserializeInstance(
@@ -127,18 +131,54 @@ class ClassReflection : public ITypeReflection {
         return serialization::SerializationManager<C>::verifyInstanceTypeInformation(err, reader, instance);
     }
 
+    // the string must hold one JSON object
     virtual bool setFromString(IErrorHandler* err, const char* str, size_t strLen,
             void* p_value) override {
-        return err->notImplemented("reflection::ClassReflection::setFromString"), false;
+        serialization::JsonReader reader(str, strLen);
+
+        return setFromJson(err, &reader, FIELD_STATE | FIELD_CONFIG, p_value) && reader.expectEnd(err);
     }
 
-    virtual bool toString(IErrorHandler* err, char*& buffer, size_t& bufferSize, uint32_t fieldMask,
+    virtual bool toString(IErrorHandler* err, IStringSink* sink, uint32_t fieldMask,
             const void* p_value) override {
         const C& instance = *reinterpret_cast<const C*>(p_value);
 
         const auto fields = reflectFields(instance);
-        return fieldsToBufString(err, buffer, bufferSize, fields, fieldMask);
+        return fieldsToString(err, sink, fields, fieldMask);
     }
+
+    virtual bool setFromJson(IErrorHandler* err, serialization::JsonReader* reader, uint32_t fieldMask,
+            void* p_value) override {
+        C& instance = *reinterpret_cast<C*>(p_value);
+
+        auto fields = reflectFields(instance);
+        return serialization::JsonInstanceSerializer::deserializeInstance(err, reader, fields, fieldMask);
+    }
+
+    virtual bool toJson(IErrorHandler* err, serialization::JsonWriter* writer, uint32_t fieldMask,
+            const void* p_value) override {
+        const C& instance = *reinterpret_cast<const C*>(p_value);
+
+        const auto fields = reflectFields(instance);
+        return serialization::JsonInstanceSerializer::serializeInstance(err, writer, fields, fieldMask);
+    }
+
+    virtual bool setFromMsgPack(IErrorHandler* err, serialization::MsgPackReader* reader, uint32_t fieldMask,
+            void* p_value) override {
+        C& instance = *reinterpret_cast<C*>(p_value);
+
+        auto fields = reflectFields(instance);
+        return serialization::MsgPackInstanceSerializer::deserializeInstance(err, reader, fields, fieldMask);
+    }
+
+    virtual bool toMsgPack(IErrorHandler* err, serialization::MsgPackWriter* writer, uint32_t fieldMask,
+            const void* p_value) override {
+        const C& instance = *reinterpret_cast<const C*>(p_value);
+
+        const auto fields = reflectFields(instance);
+        return serialization::MsgPackInstanceSerializer::serializeInstance(err, writer, fields, fieldMask);
+    }
+
 };
 
 template <class C>
@@ -147,12 +187,24 @@ ITypeReflection* reflectionForType(C) {
     return &reflection;
 }
 
+// makes ClassReflection<C> reachable from the type registry
+template <class C>
+struct ClassReflectionRegistrar {
+    static const bool registered;
+};
+
 template <class C>
 struct ReflectionForType2
 {
     static ITypeReflection* reflectionForType2() {
+        (void) &ClassReflectionRegistrar<C>::registered;
+
         static ClassReflection<C> reflection;
         return &reflection;
     }
 };
+
+template <class C>
+const bool ClassReflectionRegistrar<C>::registered =
+        (TypeRegistrar<typename std::remove_const<C>::type>::type.reflection = &ReflectionForType2<C>::reflectionForType2, true);
 }
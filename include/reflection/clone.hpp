@@ -0,0 +1,111 @@
+/*
+    Boost Software License - Version 1.0 - August 17, 2003
+
+    Permission is hereby granted, free of charge, to any person or organization
+    obtaining a copy of the software and accompanying documentation covered by
+    this license (the "Software") to use, reproduce, display, distribute,
+    execute, and transmit the Software, and to prepare derivative works of the
+    Software, and to permit third-parties to whom the Software is furnished to
+    do so, all subject to the following:
+
+    The copyright notices in the Software and this entire statement, including
+    the above license grant, this restriction and the following disclaimer,
+    must be included in all copies of the Software, in whole or in part, and
+    all derivative works of the Software, unless such copies or derivative
+    works are solely in the form of machine-executable object code generated by
+    a source language processor.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+    SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+    FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "base.hpp"
+#include "field_runs.hpp"
+#include "magic.hpp"
+
+#include <cstring>
+#include <type_traits>
+
+namespace reflection {  // UUID('c3549467-1615-4087-9829-176a2dc44b76')
+template <class C>
+void reflectAssign(C& dst, const C& src, uint32_t fieldMask = FIELD_STATE | FIELD_CONFIG);
+
+// Copy of a value of type T. Reflected classes are assigned field by field under the same mask (like setFromJson),
+// everything else -- including strings and containers -- through its own operator =.
+template <typename T, typename Enable = void>
+struct StructuralAssign {
+    static void assign(T& dst, const T& src, uint32_t fieldMask) { dst = src; }
+};
+
+template <typename T>
+struct StructuralAssign<T, typename VoidType<decltype(&T::reflection_s_className)>::type> {
+    static void assign(T& dst, const T& src, uint32_t fieldMask) { reflectAssign(dst, src, fieldMask); }
+};
+
+// scalar fields, merged into runs only when their systemFlags match, so that any mask selects whole runs
+template <class C>
+const FieldRunLayout& copyLayoutOf() {
+    static const FieldRunLayout layout(fieldSetOfClass<C>(), FieldRunLayout::FLOATING_POINT | FieldRunLayout::SPLIT_BY_FLAGS);
+    return layout;
+}
+
+inline void copyRuns(const FieldRunLayout& layout, void* dst, const void* src, uint32_t fieldMask) {
+    for (size_t i = 0; i < layout.numRuns; i++) {
+        const FieldRunLayout::Run_t& run = layout.runs[i];
+
+        if (run.systemFlags & fieldMask)
+            memcpy(reinterpret_cast<char*>(dst) + run.offset, reinterpret_cast<const char*>(src) + run.offset, run.size);
+    }
+}
+
+template <class C>
+class AssignVisitor {
+public:
+    AssignVisitor(const C& src, const FieldRunLayout& layout, uint32_t fieldMask)
+            : src(src), layout(layout), fieldMask(fieldMask), index(0) {}
+
+    template <class Owner, typename T, T Owner::*member>
+    void operator ()(const StaticField<Owner, T, member>& field, T& value) {
+        if (!layout.isCovered(index) && (field.systemFlags & fieldMask))
+            StructuralAssign<T>::assign(value, src.*member, fieldMask);
+
+        index++;
+    }
+
+    const C& src;
+    const FieldRunLayout& layout;
+    uint32_t fieldMask;
+    size_t index;
+};
+
+// Copies the fields of `src` selected by `fieldMask` into `dst`, leaving the others untouched. Scalar members laid
+// out next to each other (with the same flags) are copied with one memcpy per run; the remaining fields are assigned
+// at compile-time resolved types. Dependencies are only copied (as plain pointers) if the mask asks for them.
+template <class C>
+void reflectAssign(C& dst, const C& src, uint32_t fieldMask) {
+    const FieldRunLayout& layout = copyLayoutOf<C>();
+
+    if (&dst == &src)
+        return;
+
+    copyRuns(layout, &dst, &src, fieldMask);
+
+    AssignVisitor<C> visitor(src, layout, fieldMask);
+    forEachField(dst, visitor);
+}
+
+// A default-constructed C with the fields of `src` selected by `fieldMask` copied in, e.g. a snapshot of FIELD_STATE
+template <class C>
+C reflectClone(const C& src, uint32_t fieldMask = FIELD_STATE | FIELD_CONFIG) {
+    C copy;
+    reflectAssign(copy, src, fieldMask);
+    return copy;
+}
+}
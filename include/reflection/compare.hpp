@@ -0,0 +1,283 @@
+/*
+    Boost Software License - Version 1.0 - August 17, 2003
+
+    Permission is hereby granted, free of charge, to any person or organization
+    obtaining a copy of the software and accompanying documentation covered by
+    this license (the "Software") to use, reproduce, display, distribute,
+    execute, and transmit the Software, and to prepare derivative works of the
+    Software, and to permit third-parties to whom the Software is furnished to
+    do so, all subject to the following:
+
+    The copyright notices in the Software and this entire statement, including
+    the above license grant, this restriction and the following disclaimer,
+    must be included in all copies of the Software, in whole or in part, and
+    all derivative works of the Software, unless such copies or derivative
+    works are solely in the form of machine-executable object code generated by
+    a source language processor.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+    SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+    FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "base.hpp"
+#include "field_runs.hpp"
+#include "magic.hpp"
+
+#include <type_traits>
+
+#ifndef REFLECTOR_AVOID_STL
+#include <string>
+#include <vector>
+#endif
+
+namespace reflection {  // UUID('c3549467-1615-4087-9829-176a2dc44b76')
+
+// integer and bool fields, which two instances have equal iff memcmp says so
+template <class C>
+const FieldRunLayout& memcmpLayoutOf() {
+    static const FieldRunLayout layout(fieldSetOfClass<C>(), 0);
+    return layout;
+}
+
+inline bool runsEqual(const FieldRunLayout& layout, const void* a, const void* b) {
+    for (size_t i = 0; i < layout.numRuns; i++) {
+        const FieldRunLayout::Run_t& run = layout.runs[i];
+
+        if (memcmp(reinterpret_cast<const char*>(a) + run.offset, reinterpret_cast<const char*>(b) + run.offset, run.size) != 0)
+            return false;
+    }
+
+    return true;
+}
+
+template <class C>
+bool reflectEquals(const C& a, const C& b);
+
+template <class C>
+int reflectCompare(const C& a, const C& b);
+
+// Equality and ordering of a value of type T. Reflected classes compare field by field, strings and vectors
+// lexicographically; floating point follows the built-in operators (so NaN is never equal, and unordered).
+// Other types need a specialization, unless their bytes are their value (see HasUniqueBytes).
+template <typename T, typename Enable = void>
+struct StructuralCompare {
+    static_assert(HasUniqueBytes<T>::value, "reflectEquals: no StructuralCompare for this type (its bytes may include padding)");
+
+    static bool equals(const T& a, const T& b) { return memcmp(&a, &b, sizeof(T)) == 0; }
+    static int compare(const T& a, const T& b) { return memcmp(&a, &b, sizeof(T)); }
+};
+
+template <typename T>
+struct StructuralCompare<T, typename std::enable_if<std::is_arithmetic<T>::value || std::is_enum<T>::value
+        || std::is_pointer<T>::value>::type> {
+    static bool equals(const T& a, const T& b) { return a == b; }
+    static int compare(const T& a, const T& b) { return (a < b) ? -1 : (b < a) ? 1 : 0; }
+};
+
+template <typename T>
+struct StructuralCompare<T, typename VoidType<decltype(&T::reflection_s_className)>::type> {
+    static bool equals(const T& a, const T& b) { return reflectEquals(a, b); }
+    static int compare(const T& a, const T& b) { return reflectCompare(a, b); }
+};
+
+#ifndef REFLECTOR_AVOID_STL
+template <>
+struct StructuralCompare<std::string> {
+    static bool equals(const std::string& a, const std::string& b) { return a == b; }
+    static int compare(const std::string& a, const std::string& b) { int rc = a.compare(b); return (rc > 0) - (rc < 0); }
+};
+
+template <typename T>
+struct StructuralCompare<std::vector<T>> {
+    typedef std::integral_constant<bool, std::is_integral<T>::value || std::is_enum<T>::value> IsBlock;
+
+    static bool equals(const std::vector<T>& a, const std::vector<T>& b) {
+        return a.size() == b.size() && elementsEqual(a, b, IsBlock());
+    }
+
+    static int compare(const std::vector<T>& a, const std::vector<T>& b) {
+        size_t count = (a.size() < b.size()) ? a.size() : b.size();
+
+        for (size_t i = 0; i < count; i++) {
+            int rc = StructuralCompare<T>::compare(a[i], b[i]);
+
+            if (rc != 0)
+                return rc;
+        }
+
+        return (a.size() < b.size()) ? -1 : (b.size() < a.size()) ? 1 : 0;
+    }
+
+private:
+    static bool elementsEqual(const std::vector<T>& a, const std::vector<T>& b, std::true_type isBlock) {
+        return a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+    }
+
+    static bool elementsEqual(const std::vector<T>& a, const std::vector<T>& b, std::false_type isBlock) {
+        for (size_t i = 0; i < a.size(); i++) {
+            if (!StructuralCompare<T>::equals(a[i], b[i]))
+                return false;
+        }
+
+        return true;
+    }
+};
+#endif
+
+template <class C>
+class EqualsVisitor {
+public:
+    EqualsVisitor(const C& b, const FieldRunLayout& layout) : b(b), layout(layout), index(0), equal(true) {}
+
+    template <class Owner, typename T, T Owner::*member>
+    void operator ()(const StaticField<Owner, T, member>& field, const T& value) {
+        if (equal && !layout.isCovered(index) && !(field.systemFlags & FIELD_DEPENDENCY))
+            equal = StructuralCompare<T>::equals(value, b.*member);
+
+        index++;
+    }
+
+    const C& b;
+    const FieldRunLayout& layout;
+    size_t index;
+    bool equal;
+};
+
+template <class C>
+class CompareVisitor {
+public:
+    explicit CompareVisitor(const C& b) : b(b), result(0) {}
+
+    template <class Owner, typename T, T Owner::*member>
+    void operator ()(const StaticField<Owner, T, member>& field, const T& value) {
+        if (result == 0 && !(field.systemFlags & FIELD_DEPENDENCY))
+            result = StructuralCompare<T>::compare(value, b.*member);
+    }
+
+    const C& b;
+    int result;
+};
+
+// Field-wise equality of the reflected state (dependencies excluded). Integer and bool members laid out next to
+// each other are compared with a single memcmp per run; the remaining fields are compared at compile-time resolved
+// types, nested classes recursively.
+template <class C>
+bool reflectEquals(const C& a, const C& b) {
+    const FieldRunLayout& layout = memcmpLayoutOf<C>();
+
+    if (!runsEqual(layout, &a, &b))
+        return false;
+
+    EqualsVisitor<C> visitor(b, layout);
+    forEachField(a, visitor);
+    return visitor.equal;
+}
+
+// Lexicographic ordering over the fields in reflectFields() order: <0, 0 or >0
+template <class C>
+int reflectCompare(const C& a, const C& b) {
+    CompareVisitor<C> visitor(b);
+    forEachField(a, visitor);
+    return visitor.result;
+}
+
+// Dotted path of a (possibly nested) field, e.g. "position.latitude"; long paths are truncated
+class FieldPath {
+public:
+    FieldPath() : length(0) { path[0] = 0; }
+
+    size_t push(const char* name) {
+        size_t previous = length;
+
+        if (length > 0)
+            append(".", 1);
+
+        append(name, strlen(name));
+        return previous;
+    }
+
+    void pop(size_t previous) {
+        length = previous;
+        path[length] = 0;
+    }
+
+    const char* c_str() const { return path; }
+
+private:
+    void append(const char* str, size_t strLen) {
+        if (strLen > sizeof(path) - 1 - length)
+            strLen = sizeof(path) - 1 - length;
+
+        memcpy(path + length, str, strLen);
+        length += strLen;
+        path[length] = 0;
+    }
+
+    char path[256];
+    size_t length;
+};
+
+template <class C, typename Func>
+void reflectDiff(const C& a, const C& b, Func&& onDifference, FieldPath& path);
+
+template <class C, typename Func>
+class DiffVisitor {
+public:
+    DiffVisitor(const C& b, Func& onDifference, FieldPath& path) : b(b), onDifference(onDifference), path(path) {}
+
+    template <class Owner, typename T, T Owner::*member>
+    void operator ()(const StaticField<Owner, T, member>& field, const T& value) {
+        if (field.systemFlags & FIELD_DEPENDENCY)
+            return;
+
+        if (!StructuralCompare<T>::equals(value, b.*member)) {
+            size_t previous = path.push(field.name);
+            diffValue(value, b.*member, std::integral_constant<bool, (int) TypeKind<T>::value == (int) KIND_CLASS>());
+            path.pop(previous);
+        }
+    }
+
+private:
+    template <typename T>
+    void diffValue(const T& a, const T& b, std::true_type isClass) { reflectDiff(a, b, onDifference, path); }
+
+    template <typename T>
+    void diffValue(const T& a, const T& b, std::false_type isClass) { onDifference(path.c_str()); }
+
+    const C& b;
+    Func& onDifference;
+    FieldPath& path;
+};
+
+template <class C, typename Func>
+void reflectDiff(const C& a, const C& b, Func&& onDifference, FieldPath& path) {
+    DiffVisitor<C, Func> visitor(b, onDifference, path);
+    forEachField(a, visitor);
+}
+
+// Calls onDifference(path) for every leaf field that differs between `a` and `b`; nested classes are descended into
+template <class C, typename Func>
+void reflectDiff(const C& a, const C& b, Func&& onDifference) {
+    if (reflectEquals(a, b))
+        return;
+
+    FieldPath path;
+    reflectDiff(a, b, onDifference, path);
+}
+
+#ifndef REFLECTOR_AVOID_STL
+template <class C>
+std::vector<std::string> reflectDiff(const C& a, const C& b) {
+    std::vector<std::string> paths;
+    reflectDiff(a, b, [&paths](const char* path) { paths.push_back(path); });
+    return paths;
+}
+#endif
+}
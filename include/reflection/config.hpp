@@ -41,9 +41,7 @@ template <typename T>
 bool configure(T& inst, IConfigManager* cfgMgr) {
     auto fields = reflectFields(inst);
 
-    for (size_t i = 0; i < fields.count(); i++) {
-        auto field = fields[i];
-
+    for (auto field : fields) {
         if (field.systemFlags & FIELD_CONFIG) {
             const char* value;
             if (!cfgMgr->getValueForKey(err, field.className, field.name, value))
@@ -42,9 +42,7 @@ template <typename T>
 bool di(T& inst) {
     auto fields = reflectFields(inst);
 
-    for (size_t i = 0; i < fields.count(); i++) {
-        auto field = fields[i];
-
+    for (auto field : fields) {
         if (field.systemFlags & FIELD_DEPENDENCY) {
             assert(field.uuid);
 
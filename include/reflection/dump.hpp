@@ -28,6 +28,7 @@
 
 #include "api.hpp"
 #include "basic_types.hpp"
+#include "schema_provider.hpp"
 #include "serializer.hpp"
 
 namespace reflection {  // UUID('c3549467-1615-4087-9829-176a2dc44b76')
@@ -38,12 +39,6 @@ public:
     virtual void seekBack(long amount) = 0;
 };
 
-class ISchemaProvider {
-public:
-    virtual IReader* openClassSchemaOrNull(const char* className) = 0;
-    virtual void closeClassSchema(IReader* reader) = 0;
-};
-
 static bool dumpValue(Tag_t tag, IReader* reader, ISeekBack* sb, ISchemaProvider* sp = nullptr, int offset = 0);
 static bool dumpTaggedValue(IReader* reader, ISeekBack* sb, ISchemaProvider* sp = nullptr, int offset = 0);
 
@@ -97,7 +92,7 @@ static bool dumpString(IReader* reader) {
 }
 
 static bool dumpTaggedClass(IReader* reader, ISeekBack* sb, ISchemaProvider* sp = nullptr, int offset = 0) {
-    BufString_t className, str;
+    BufString_t className;
     uint32_t numFields;
 
     if (!Serializer<BufString_t>::deserialize(err, reader, className)
@@ -106,44 +101,27 @@ static bool dumpTaggedClass(IReader* reader, ISeekBack* sb, ISchemaProvider* sp
 
     printf("`%s`", className.buf);
 
-    IReader* schemaReader = (sp == nullptr) ? nullptr : sp->openClassSchemaOrNull(className.buf);
+    ParsedSchema_t storage;
+    const ParsedSchema_t* schema;
 
-    if (schemaReader == nullptr)
+    if (!getClassSchema(sp, className.buf, storage, schema))
+        return false;
+
+    if (schema == nullptr)
         printf(" (schema not available)");
+    else if (schema->fields.size() != numFields)
+        return err->errorf("SchemaMismatch", "Class `%s` has %u fields, but its schema lists %u.", className.buf,
+                (unsigned int) numFields, (unsigned int) schema->fields.size()), false;
 
     printf(" {\n");
     offset++;
 
-    if (schemaReader != nullptr) {
-        if (!checkTag(err, schemaReader, TAG_CLASS_SCHEMA))
-            return false;
-
-        if (/*!Serializer<BufString_t>::deserialize(err, schemaReader, className)
-                ||*/ !Serializer<uint32_t>::deserialize(err, schemaReader, numFields))
-            return false;
-
-        // TODO: check if values as expected
-    }
-
     for (uint32_t i = 0; i < numFields; i++) {
         doOffset(offset);
 
-        if (schemaReader != nullptr) {
-            Tag_t tag;
-
-            if (!Serializer<BufString_t>::deserialize(err, schemaReader, className)
-                    || !Serializer<BufString_t>::deserialize(err, schemaReader, str)
-                    || !schemaReader->read(err, &tag, sizeof(tag)))
-                return false;
-
-            printf("`%s::%s` => ", className.buf, str.buf);
-
-            if (tag == TAG_CLASS) {
-                if (!Serializer<BufString_t>::deserialize(err, schemaReader, className))
-                    return false;
-
-                //printf("(class `%s`) ", className.buf);
-            }
+        if (schema != nullptr) {
+            const SchemaField_t& field = schema->fields[i];
+            printf("`%s::%s` => ", field.className.c_str(), field.name.c_str());
         }
 
         if (!dumpTaggedValue(reader, sb, sp, offset))
@@ -152,9 +130,6 @@ static bool dumpTaggedClass(IReader* reader, ISeekBack* sb, ISchemaProvider* sp
         printf("\n");
     }
 
-    if (schemaReader != nullptr)
-        sp->closeClassSchema(schemaReader);
-
     offset--;
     doOffset(offset);
     printf("}");
@@ -162,17 +137,16 @@ static bool dumpTaggedClass(IReader* reader, ISeekBack* sb, ISchemaProvider* sp
     return true;
 }
 
-static bool dumpClass(IReader* reader, ISeekBack* sb, const char* className_, ISchemaProvider* sp, int offset = 0) {
-    BufString_t className, str;
-    uint32_t numFields;
+static bool dumpClass(IReader* reader, ISeekBack* sb, const char* className, ISchemaProvider* sp, int offset = 0) {
+    printf("`%s`", className);
 
-    bufStringSet(err, className.buf, className.bufSize, className_, strlen(className_));
+    ParsedSchema_t storage;
+    const ParsedSchema_t* schema;
 
-    printf("`%s`", className.buf);
-
-    IReader* schemaReader = (sp == nullptr) ? nullptr : sp->openClassSchemaOrNull(className.buf);
+    if (!getClassSchema(sp, className, storage, schema))
+        return false;
 
-    if (schemaReader == nullptr) {
+    if (schema == nullptr) {
         printf(" (schema not available)\n");
         return false;
     }
@@ -180,38 +154,21 @@ static bool dumpClass(IReader* reader, ISeekBack* sb, const char* className_, IS
     printf(" {\n");
     offset++;
 
-    if (!Serializer<uint32_t>::deserialize(err, schemaReader, numFields))
-        return false;
-
-    // TODO: check if values as expected
-
-    for (uint32_t i = 0; i < numFields; i++) {
+    for (const SchemaField_t& field : schema->fields) {
         doOffset(offset);
 
-        Tag_t tag;
-
-        if (!Serializer<BufString_t>::deserialize(err, schemaReader, className)
-                || !Serializer<BufString_t>::deserialize(err, schemaReader, str)
-                || !schemaReader->read(err, &tag, sizeof(tag)))
-            return false;
-
-        printf("`%s::%s` => ", className.buf, str.buf);
+        printf("`%s::%s` => ", field.className.c_str(), field.name.c_str());
 
-        if (tag == TAG_CLASS) {
-            if (!Serializer<BufString_t>::deserialize(err, schemaReader, className))
-                return false;
-
-            if (!dumpClass(reader, sb, className.buf, sp, offset))
+        if (field.tag == TAG_CLASS) {
+            if (!dumpClass(reader, sb, field.fieldClassName.c_str(), sp, offset))
                 return false;
         }
-        else if (!dumpValue(tag, reader, sb, sp, offset))
+        else if (!dumpValue(field.tag, reader, sb, sp, offset))
             return false;
 
         printf("\n");
     }
 
-    sp->closeClassSchema(schemaReader);
-
     offset--;
     doOffset(offset);
     printf("}");
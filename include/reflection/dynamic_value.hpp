@@ -0,0 +1,367 @@
+/*
+    Boost Software License - Version 1.0 - August 17, 2003
+
+    Permission is hereby granted, free of charge, to any person or organization
+    obtaining a copy of the software and accompanying documentation covered by
+    this license (the "Software") to use, reproduce, display, distribute,
+    execute, and transmit the Software, and to prepare derivative works of the
+    Software, and to permit third-parties to whom the Software is furnished to
+    do so, all subject to the following:
+
+    The copyright notices in the Software and this entire statement, including
+    the above license grant, this restriction and the following disclaimer,
+    must be included in all copies of the Software, in whole or in part, and
+    all derivative works of the Software, unless such copies or derivative
+    works are solely in the form of machine-executable object code generated by
+    a source language processor.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+    SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+    FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "schema_provider.hpp"
+#include "serializer.hpp"
+
+#include <cstddef>
+
+namespace reflection {  // UUID('c3549467-1615-4087-9829-176a2dc44b76')
+
+// Bump allocator for short-lived trees of trivially destructible objects: everything is freed at once by
+// reset() or the destructor, nothing individually.
+class Arena {
+public:
+    explicit Arena(size_t chunkSize = 64 * 1024) : head(nullptr), pos(nullptr), end(nullptr), chunkSize(chunkSize) {}
+    ~Arena() { release(nullptr); }
+
+    Arena(const Arena& other) = delete;
+    Arena& operator =(const Arena& other) = delete;
+
+    // nullptr if out of memory
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+        uintptr_t p = ((uintptr_t) pos + (align - 1)) & ~(uintptr_t)(align - 1);
+
+        if (head == nullptr || p + size > (uintptr_t) end) {
+            size_t needed = sizeof(Chunk) + size + align;
+            Chunk* chunk = (Chunk*) malloc(needed > chunkSize ? needed : chunkSize);
+
+            if (chunk == nullptr)
+                return nullptr;
+
+            chunk->next = head;
+            head = chunk;
+            pos = reinterpret_cast<char*>(chunk + 1);
+            end = reinterpret_cast<char*>(chunk) + (needed > chunkSize ? needed : chunkSize);
+
+            p = ((uintptr_t) pos + (align - 1)) & ~(uintptr_t)(align - 1);
+        }
+
+        pos = reinterpret_cast<char*>(p + size);
+        return reinterpret_cast<void*>(p);
+    }
+
+    template <typename T>
+    T* allocateArray(size_t count) {
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    // NUL-terminated copy
+    const char* copyString(const char* str, size_t length) {
+        char* copy = allocateArray<char>(length + 1);
+
+        if (copy != nullptr) {
+            memcpy(copy, str, length);
+            copy[length] = 0;
+        }
+
+        return copy;
+    }
+
+    // forgets everything allocated so far, keeping the most recent chunk for reuse
+    void reset() {
+        if (head == nullptr)
+            return;
+
+        release(head);
+        head->next = nullptr;
+        pos = reinterpret_cast<char*>(head + 1);
+    }
+
+private:
+    struct Chunk {
+        Chunk* next;
+        std::max_align_t align;
+    };
+
+    void release(Chunk* keep) {
+        for (Chunk* chunk = (keep != nullptr) ? keep->next : head; chunk != nullptr; ) {
+            Chunk* next = chunk->next;
+            free(chunk);
+            chunk = next;
+        }
+    }
+
+    Chunk* head;
+    char* pos;
+    char* end;
+    size_t chunkSize;
+};
+
+struct DynamicField_t;
+
+// A value decoded without its C++ type, from the binary encoding and the class schema. Lives in an Arena;
+// `tag` is one of TAG_BOOL, TAG_CHAR, TAG_SMVINT (signedness is not in the schema), TAG_REAL32, TAG_REAL64,
+// TAG_UTF8 or TAG_CLASS.
+struct DynamicValue {
+    struct String_t {
+        const char* data;                   // NUL-terminated
+        size_t length;
+    };
+
+    struct Object_t {
+        const char* className;
+        DynamicField_t* fields;
+        size_t numFields;
+    };
+
+    // as encoded, so that the full range of both int64_t and uint64_t fits
+    struct Integer_t {
+        bool negative;
+        uint64_t magnitude;
+    };
+
+    serialization::Tag_t tag;
+
+    union {
+        bool boolValue;
+        uint8_t charValue;
+        Integer_t integer;
+        float floatValue;
+        double doubleValue;
+        String_t string;
+        Object_t object;
+    };
+
+    bool isNumber() const {
+        return tag == serialization::TAG_BOOL || tag == serialization::TAG_CHAR || tag == serialization::TAG_SMVINT
+                || tag == serialization::TAG_REAL32 || tag == serialization::TAG_REAL64;
+    }
+
+    // any number as a double (0 for other values)
+    double toDouble() const {
+        switch (tag) {
+            case serialization::TAG_BOOL:   return boolValue ? 1.0 : 0.0;
+            case serialization::TAG_CHAR:   return charValue;
+            case serialization::TAG_SMVINT: return integer.negative ? -(double) integer.magnitude : (double) integer.magnitude;
+            case serialization::TAG_REAL32: return floatValue;
+            case serialization::TAG_REAL64: return doubleValue;
+            default:                        return 0.0;
+        }
+    }
+
+    // field of an object (own or inherited) by name, or nullptr
+    inline const DynamicValue* get(const char* name) const;
+    DynamicValue* get(const char* name) { return const_cast<DynamicValue*>(static_cast<const DynamicValue*>(this)->get(name)); }
+};
+
+struct DynamicField_t {
+    const char* className;                  // class which declares the field
+    const char* name;
+    DynamicValue value;
+};
+
+inline const DynamicValue* DynamicValue::get(const char* name) const {
+    if (tag != serialization::TAG_CLASS)
+        return nullptr;
+
+    for (size_t i = 0; i < object.numFields; i++) {
+        if (strcmp(object.fields[i].name, name) == 0)
+            return &object.fields[i].value;
+    }
+
+    return nullptr;
+}
+
+class DynamicDecoder {
+public:
+    enum { MAX_DEPTH = 64, STRING_STEP = 4096 };
+
+    DynamicDecoder(IErrorHandler* err, serialization::IReader* reader, ISchemaProvider* sp, Arena& arena)
+            : err(err), reader(reader), sp(sp), arena(arena) {}
+
+    // className must stay valid as long as the tree if `classNameIsStable`, otherwise it is copied
+    bool decodeValue(serialization::Tag_t tag, const char* className, bool classNameIsStable, DynamicValue& value_out,
+            int depth) {
+        using namespace serialization;
+
+        value_out.tag = tag;
+
+        switch (tag) {
+            case TAG_BOOL:      return Serializer<bool>::deserialize(err, reader, value_out.boolValue);
+            case TAG_CHAR:      return reader->read(err, &value_out.charValue, 1);
+            case TAG_SMVINT:    return readSmv(err, reader, value_out.integer.negative, value_out.integer.magnitude);
+            case TAG_REAL32:    return reader->read(err, &value_out.floatValue, sizeof(float));
+            case TAG_REAL64:    return reader->read(err, &value_out.doubleValue, sizeof(double));
+            case TAG_UTF8:      return decodeString(value_out.string);
+            case TAG_CLASS:     return decodeObject(className, classNameIsStable, value_out.object, depth + 1);
+
+            default:
+                return err->errorf("UnknownType", "Cannot decode values with tag %02X without their element type.", tag),
+                        false;
+        }
+    }
+
+    bool decodeObject(const char* className, bool classNameIsStable, DynamicValue::Object_t& object_out, int depth) {
+        if (depth > MAX_DEPTH)
+            return err->errorf("SchemaMismatch", "Classes nested more than %d levels deep.", (int) MAX_DEPTH), false;
+
+        ParsedSchema_t storage;
+        const ParsedSchema_t* schema;
+
+        if (!getClassSchema(sp, className, storage, schema))
+            return false;
+
+        if (schema == nullptr)
+            return err->errorf("SchemaMismatch", "No schema for class `%s`.", className), false;
+
+        // a cached schema outlives the tree, a freshly parsed one does not
+        const bool copyNames = (schema == &storage);
+        const size_t numFields = schema->fields.size();
+
+        object_out.className = classNameIsStable ? className : arena.copyString(className, strlen(className));
+        object_out.fields = arena.allocateArray<DynamicField_t>(numFields);
+        object_out.numFields = numFields;
+
+        if (object_out.className == nullptr || (numFields > 0 && object_out.fields == nullptr))
+            return err->allocationError("reflection::DynamicDecoder::decodeObject"), false;
+
+        for (size_t i = 0; i < numFields; i++) {
+            const SchemaField_t& field = schema->fields[i];
+            DynamicField_t& out = object_out.fields[i];
+
+            out.className = copyNames ? arena.copyString(field.className.c_str(), field.className.size()) : field.className.c_str();
+            out.name = copyNames ? arena.copyString(field.name.c_str(), field.name.size()) : field.name.c_str();
+
+            if (out.className == nullptr || out.name == nullptr)
+                return err->allocationError("reflection::DynamicDecoder::decodeObject"), false;
+
+            if (!decodeValue(field.tag, field.fieldClassName.c_str(), !copyNames, out.value, depth))
+                return false;
+        }
+
+        return true;
+    }
+
+private:
+    bool decodeString(DynamicValue::String_t& string_out) {
+        uint64_t length;
+
+        if (!serialization::SmvIntSerializer<uint64_t>::deserializeValue(err, reader, length))
+            return false;
+
+        // Short strings are read straight into the arena. Longer ones go through a scratch buffer grown in steps as
+        // the data arrives (as in BinaryProgram::readString), so that a corrupt or hostile length fails on end of
+        // input instead of reserving all of it up front.
+        if (length > STRING_STEP) {
+            scratch.clear();
+
+            for (uint64_t have = 0; have < length; ) {
+                size_t step = (length - have < STRING_STEP) ? (size_t)(length - have) : (size_t) STRING_STEP;
+
+                scratch.resize((size_t) have + step);
+
+                if (!reader->read(err, &scratch[(size_t) have], step))
+                    return false;
+
+                have += step;
+            }
+
+            string_out.data = arena.copyString(scratch.data(), scratch.size());
+            string_out.length = scratch.size();
+
+            if (string_out.data == nullptr)
+                return err->allocationError("reflection::DynamicDecoder::decodeString"), false;
+
+            return true;
+        }
+
+        char* data = arena.allocateArray<char>((size_t) length + 1);
+
+        if (data == nullptr)
+            return err->allocationError("reflection::DynamicDecoder::decodeString"), false;
+
+        if (!reader->read(err, data, (size_t) length))
+            return false;
+
+        data[length] = 0;
+        string_out.data = data;
+        string_out.length = (size_t) length;
+        return true;
+    }
+
+    IErrorHandler* err;
+    serialization::IReader* reader;
+    ISchemaProvider* sp;
+    Arena& arena;
+    std::string scratch;
+};
+
+// Decodes an instance of `classId` (as written by reflectSerialize) into a tree allocated from `arena`.
+// Wrap the provider in a SchemaCache when decoding many records: then each schema is parsed once and the tree
+// points into the cache for class and field names instead of copying them.
+inline bool decodeDynamicValue(IErrorHandler* err, serialization::IReader* reader, const char* classId,
+        ISchemaProvider* sp, Arena& arena, DynamicValue*& value_out) {
+    DynamicValue* value = arena.allocateArray<DynamicValue>(1);
+
+    if (value == nullptr)
+        return err->allocationError("reflection::decodeDynamicValue"), false;
+
+    value->tag = serialization::TAG_CLASS;
+
+    DynamicDecoder decoder(err, reader, sp, arena);
+
+    if (!decoder.decodeObject(classId, false, value->object, 0))
+        return false;
+
+    value_out = value;
+    return true;
+}
+
+// The inverse: writes a (possibly modified) tree back in the same binary encoding
+inline bool encodeDynamicValue(IErrorHandler* err, serialization::IWriter* writer, const DynamicValue& value) {
+    using namespace serialization;
+
+    switch (value.tag) {
+        case TAG_BOOL:      return Serializer<bool>::serialize(err, writer, value.boolValue);
+        case TAG_CHAR:      return writer->write(err, &value.charValue, 1);
+        case TAG_REAL32:    return writer->write(err, &value.floatValue, sizeof(float));
+        case TAG_REAL64:    return writer->write(err, &value.doubleValue, sizeof(double));
+
+        case TAG_SMVINT: {
+            uint8_t bytes[MAX_SMV_SIZE];
+            return writer->write(err, bytes, encodeSmv(bytes, value.integer.negative, value.integer.magnitude));
+        }
+
+        case TAG_UTF8:
+            return SmvIntSerializer<size_t>::serializeValue(err, writer, value.string.length)
+                    && writer->write(err, value.string.data, value.string.length);
+
+        case TAG_CLASS:
+            for (size_t i = 0; i < value.object.numFields; i++) {
+                if (!encodeDynamicValue(err, writer, value.object.fields[i].value))
+                    return false;
+            }
+
+            return true;
+
+        default:
+            return err->errorf("UnknownType", "Cannot encode values with tag %02X.", value.tag), false;
+    }
+}
+}
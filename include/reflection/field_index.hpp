@@ -0,0 +1,170 @@
+/*
+    Boost Software License - Version 1.0 - August 17, 2003
+
+    Permission is hereby granted, free of charge, to any person or organization
+    obtaining a copy of the software and accompanying documentation covered by
+    this license (the "Software") to use, reproduce, display, distribute,
+    execute, and transmit the Software, and to prepare derivative works of the
+    Software, and to permit third-parties to whom the Software is furnished to
+    do so, all subject to the following:
+
+    The copyright notices in the Software and this entire statement, including
+    the above license grant, this restriction and the following disclaimer,
+    must be included in all copies of the Software, in whole or in part, and
+    all derivative works of the Software, unless such copies or derivative
+    works are solely in the form of machine-executable object code generated by
+    a source language processor.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+    SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+    FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "base.hpp"
+
+namespace reflection {  // UUID('c3549467-1615-4087-9829-176a2dc44b76')
+
+inline uint32_t hashFieldName(const char* name, size_t nameLen) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < nameLen; i++) {
+        hash ^= (uint8_t) name[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+inline const char* fieldName(const Field_t& field) {
+    return field.name;
+}
+
+// Open-addressing hash of field names -> position in the flattened field table of a class (base class fields included).
+// Built once per class; lookups don't allocate and never call strcmp on a hash mismatch.
+// Any other per-field string can serve as the key (e.g. the option spec of command-line arguments).
+class FieldNameIndex {
+public:
+    explicit FieldNameIndex(FieldSet_t const* fieldSet, const char* (*keyOf)(const Field_t& field) = &fieldName)
+            : fieldSet(fieldSet), slots(nullptr), mask(0) {
+        FlatFieldTable_t const* table = fieldSet->flattened();
+        size_t numSlots = 4;
+
+        if (table == nullptr)
+            return;
+
+        while (numSlots < table->count * 2)
+            numSlots *= 2;
+
+        slots = (Slot_t*) calloc(numSlots, sizeof(Slot_t));
+
+        // every lookup then misses
+        if (slots == nullptr) {
+            err->allocationError("reflection::FieldNameIndex::FieldNameIndex");
+            return;
+        }
+
+        mask = numSlots - 1;
+
+        for (size_t i = 0; i < table->count; i++) {
+            const char* name = keyOf(*table->entries[i].field);
+
+            if (name == nullptr)
+                continue;
+
+            size_t nameLen = strlen(name);
+            uint32_t hash = hashFieldName(name, nameLen);
+
+            // a derived class field shadows a base class field of the same name, as it comes first
+            if (find(name, nameLen, hash) >= 0)
+                continue;
+
+            size_t slot = hash & mask;
+
+            while (slots[slot].name != nullptr)
+                slot = (slot + 1) & mask;
+
+            Slot_t entry = {name, (uint32_t) nameLen, hash, (uint32_t) i};
+            slots[slot] = entry;
+        }
+    }
+
+    ~FieldNameIndex() { free(slots); }
+
+    FieldNameIndex(const FieldNameIndex& other) = delete;
+    FieldNameIndex& operator =(const FieldNameIndex& other) = delete;
+
+    // index of the field, or -1 if not found
+    int find(const char* name, size_t nameLen) const {
+        return find(name, nameLen, hashFieldName(name, nameLen));
+    }
+
+    int find(const char* name) const {
+        return find(name, strlen(name));
+    }
+
+    FieldSet_t const* fieldSet;             // the (most derived) class this index was built for
+
+private:
+    struct Slot_t {
+        const char* name;
+        uint32_t nameLen;
+        uint32_t hash;
+        uint32_t index;
+    };
+
+    int find(const char* name, size_t nameLen, uint32_t hash) const {
+        if (slots == nullptr)
+            return -1;
+
+        for (size_t slot = hash & mask; slots[slot].name != nullptr; slot = (slot + 1) & mask) {
+            const Slot_t& entry = slots[slot];
+
+            if (entry.hash == hash && entry.nameLen == nameLen && memcmp(entry.name, name, nameLen) == 0)
+                return (int) entry.index;
+        }
+
+        return -1;
+    }
+
+    Slot_t* slots;
+    size_t mask;
+};
+
+template <class C>
+FieldNameIndex const* fieldNameIndex() {
+    static const FieldNameIndex index(C::template reflection_s_getFields<C>(REFL_MATCH));
+    return &index;
+}
+
+// Field of the class or any of its base classes by name, or nullptr. `index` is the field's position in
+// reflectFields() order, which is also the position in the flattened table.
+inline FlatField_t const* findField(FieldSet_t const* fieldSet, const char* name, size_t nameLen, int* index_out = nullptr) {
+    int index = fieldSet->nameIndex()->find(name, nameLen);
+
+    if (index_out != nullptr)
+        *index_out = index;
+
+    return (index >= 0) ? &fieldSet->flattened()->entries[index] : nullptr;
+}
+
+inline FlatField_t const* findField(FieldSet_t const* fieldSet, const char* name, int* index_out = nullptr) {
+    return findField(fieldSet, name, strlen(name), index_out);
+}
+
+template <class C>
+FlatField_t const* findField(const char* name, size_t nameLen, int* index_out = nullptr) {
+    return findField(C::template reflection_s_getFields<C>(REFL_MATCH), name, nameLen, index_out);
+}
+
+template <class C>
+FlatField_t const* findField(const char* name, int* index_out = nullptr) {
+    return findField(C::template reflection_s_getFields<C>(REFL_MATCH), name, strlen(name), index_out);
+}
+}
@@ -0,0 +1,128 @@
+/*
+    Boost Software License - Version 1.0 - August 17, 2003
+
+    Permission is hereby granted, free of charge, to any person or organization
+    obtaining a copy of the software and accompanying documentation covered by
+    this license (the "Software") to use, reproduce, display, distribute,
+    execute, and transmit the Software, and to prepare derivative works of the
+    Software, and to permit third-parties to whom the Software is furnished to
+    do so, all subject to the following:
+
+    The copyright notices in the Software and this entire statement, including
+    the above license grant, this restriction and the following disclaimer,
+    must be included in all copies of the Software, in whole or in part, and
+    all derivative works of the Software, unless such copies or derivative
+    works are solely in the form of machine-executable object code generated by
+    a source language processor.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+    SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+    FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "base.hpp"
+
+#include <cstdlib>
+
+namespace reflection {  // UUID('c3549467-1615-4087-9829-176a2dc44b76')
+
+// Scalar fields of a class that sit at known offsets, merged into runs that are adjacent in memory, so that they can
+// be compared or copied with one memcmp / memcpy per run. Built from the flattened field table (base classes included).
+// If that fails, the layout is empty and callers handle every field one by one.
+class FieldRunLayout {
+public:
+    enum {
+        FLOATING_POINT = 1,     // include float and double (fine to copy, but not to memcmp)
+        SPLIT_BY_FLAGS = 2,     // only merge fields with the same systemFlags, so that runs can be selected by a mask
+    };
+
+    struct Run_t {
+        ptrdiff_t offset;
+        size_t size;
+        uint32_t systemFlags;
+    };
+
+    FieldRunLayout(FieldSet_t const* fieldSet, int options) : runs(nullptr), numRuns(0), covered(nullptr) {
+        FlatFieldTable_t const* table = fieldSet->flattened();
+
+        if (table == nullptr || table->count == 0)
+            return;
+
+        runs = (Run_t*) malloc(table->count * sizeof(Run_t));
+        covered = (bool*) malloc(table->count * sizeof(bool));
+
+        if (runs == nullptr || covered == nullptr) {
+            err->allocationError("reflection::FieldRunLayout::FieldRunLayout");
+            free(runs);
+            free(covered);
+            runs = nullptr;
+            covered = nullptr;
+            return;
+        }
+
+        for (size_t i = 0; i < table->count; i++) {
+            const Field_t& field = *table->entries[i].field;
+            size_t size = scalarSize(field.kind, options);
+
+            covered[i] = (size != 0 && (field.systemFlags & FIELD_HAS_OFFSET) && !(field.systemFlags & FIELD_DEPENDENCY));
+
+            if (!covered[i])
+                continue;
+
+            ptrdiff_t offset = table->entries[i].offset;
+            uint32_t systemFlags = field.systemFlags & ~FIELD_HAS_OFFSET;
+            Run_t* last = (numRuns > 0) ? &runs[numRuns - 1] : nullptr;
+
+            if (last != nullptr && last->offset + (ptrdiff_t) last->size == offset
+                    && (!(options & SPLIT_BY_FLAGS) || last->systemFlags == systemFlags)) {
+                last->size += size;
+                last->systemFlags |= systemFlags;
+            }
+            else {
+                Run_t run = {offset, size, systemFlags};
+                runs[numRuns++] = run;
+            }
+        }
+    }
+
+    ~FieldRunLayout() {
+        free(runs);
+        free(covered);
+    }
+
+    FieldRunLayout(const FieldRunLayout& other) = delete;
+    FieldRunLayout& operator =(const FieldRunLayout& other) = delete;
+
+    // whether the field at this position (reflectFields() order) is part of a run
+    bool isCovered(size_t index) const { return covered != nullptr && covered[index]; }
+
+    Run_t* runs;
+    size_t numRuns;
+
+private:
+    static size_t scalarSize(uint32_t kind, int options) {
+        switch (kind) {
+            case KIND_BOOL:     return sizeof(bool);
+            case KIND_INT8:
+            case KIND_UINT8:    return 1;
+            case KIND_INT16:
+            case KIND_UINT16:   return 2;
+            case KIND_INT32:
+            case KIND_UINT32:   return 4;
+            case KIND_INT64:
+            case KIND_UINT64:   return 8;
+            case KIND_FLOAT:    return (options & FLOATING_POINT) ? sizeof(float) : 0;
+            case KIND_DOUBLE:   return (options & FLOATING_POINT) ? sizeof(double) : 0;
+            default:            return 0;
+        }
+    }
+
+    bool* covered;
+};
+}
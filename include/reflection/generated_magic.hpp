@@ -1,6 +1,6 @@
 #pragma once
 
-// Generated by gen_reflection_header.py
+// Generated by gen_magic_header.py
 
 namespace reflection {
 #define REFL_BEGIN(className_, version_) \
@@ -12,16 +12,17 @@ public:\
     const char* reflection_className(REFL_MATCH_0) const { return className_; }\
     const ::reflection::UUID_t* reflection_uuidOrNull(REFL_MATCH_1) const { return nullptr; }\
     ::reflection::FieldSet_t const* reflection_getFields(REFL_MATCH_0) const {\
-        typedef std::remove_reference<decltype(*this)>::type ThisClass;\
+        typedef std::remove_const<std::remove_reference<decltype(*this)>::type>::type ThisClass;\
         return reflection_s_getFields<ThisClass>(REFL_MATCH);\
    }\
     template <class ThisClass>\
     static ::reflection::FieldSet_t const* reflection_s_getFields(REFL_MATCH_0) {\
-        const char* thisClassName = className_;\
-        thisClassName = thisClassName;\
-        ::reflection::FieldSet_t const* baseClassFields = nullptr;\
-        void* (*derivedPtrToBasePtr)(void*) = nullptr;\
-        static ::reflection::Field_t const fields[] = {\
+        return reflection_s_staticFields<ThisClass>(::reflection::FieldSetBuilder<ThisClass>(className_, nullptr, nullptr));\
+    }\
+    typedef void reflection_BaseClass;\
+    template <class ThisClass, class Visitor>\
+    static REFL_CONSTEXPR REFL_VISITOR_RESULT(Visitor) reflection_s_staticFields(Visitor&& visitor) {\
+        return visitor(\
 
 
 #define REFL_BEGIN_EXTENDS(className_, version_, baseClass_) \
@@ -33,16 +34,18 @@ public:\
     const char* reflection_className(REFL_MATCH_0) const { return className_; }\
     const ::reflection::UUID_t* reflection_uuidOrNull(REFL_MATCH_1) const { return nullptr; }\
     ::reflection::FieldSet_t const* reflection_getFields(REFL_MATCH_0) const {\
-        typedef std::remove_reference<decltype(*this)>::type ThisClass;\
+        typedef std::remove_const<std::remove_reference<decltype(*this)>::type>::type ThisClass;\
         return reflection_s_getFields<ThisClass>(REFL_MATCH);\
    }\
     template <class ThisClass>\
     static ::reflection::FieldSet_t const* reflection_s_getFields(REFL_MATCH_0) {\
-        const char* thisClassName = className_;\
-        thisClassName = thisClassName;\
-        ::reflection::FieldSet_t const* baseClassFields = baseClass_::reflection_s_getFields<baseClass_>(REFL_MATCH);\
-        void* (*derivedPtrToBasePtr)(void*) = &::reflection::derivedPtrToBasePtr<ThisClass, baseClass_>;\
-        static ::reflection::Field_t const fields[] = {\
+        return reflection_s_staticFields<ThisClass>(::reflection::FieldSetBuilder<ThisClass>(className_,\
+                baseClass_::reflection_s_getFields<baseClass_>(REFL_MATCH), &::reflection::derivedPtrToBasePtr<ThisClass, baseClass_>));\
+    }\
+    typedef baseClass_ reflection_BaseClass;\
+    template <class ThisClass, class Visitor>\
+    static REFL_CONSTEXPR REFL_VISITOR_RESULT(Visitor) reflection_s_staticFields(Visitor&& visitor) {\
+        return visitor(\
 
 
 #define REFL_BEGIN_VIRTUAL(className_, version_) \
@@ -54,16 +57,17 @@ public:\
     virtual const char* reflection_className(REFL_MATCH_0) const { return className_; }\
     virtual const ::reflection::UUID_t* reflection_uuidOrNull(REFL_MATCH_1) const { return nullptr; }\
     virtual ::reflection::FieldSet_t const* reflection_getFields(REFL_MATCH_0) const {\
-        typedef std::remove_reference<decltype(*this)>::type ThisClass;\
+        typedef std::remove_const<std::remove_reference<decltype(*this)>::type>::type ThisClass;\
         return reflection_s_getFields<ThisClass>(REFL_MATCH);\
    }\
     template <class ThisClass>\
     static ::reflection::FieldSet_t const* reflection_s_getFields(REFL_MATCH_0) {\
-        const char* thisClassName = className_;\
-        thisClassName = thisClassName;\
-        ::reflection::FieldSet_t const* baseClassFields = nullptr;\
-        void* (*derivedPtrToBasePtr)(void*) = nullptr;\
-        static ::reflection::Field_t const fields[] = {\
+        return reflection_s_staticFields<ThisClass>(::reflection::FieldSetBuilder<ThisClass>(className_, nullptr, nullptr));\
+    }\
+    typedef void reflection_BaseClass;\
+    template <class ThisClass, class Visitor>\
+    static REFL_CONSTEXPR REFL_VISITOR_RESULT(Visitor) reflection_s_staticFields(Visitor&& visitor) {\
+        return visitor(\
 
 
 #define REFL_BEGIN_VIRTUAL_EXTENDS(className_, version_, baseClass_) \
@@ -75,16 +79,18 @@ public:\
     virtual const char* reflection_className(REFL_MATCH_0) const { return className_; }\
     virtual const ::reflection::UUID_t* reflection_uuidOrNull(REFL_MATCH_1) const { return nullptr; }\
     virtual ::reflection::FieldSet_t const* reflection_getFields(REFL_MATCH_0) const {\
-        typedef std::remove_reference<decltype(*this)>::type ThisClass;\
+        typedef std::remove_const<std::remove_reference<decltype(*this)>::type>::type ThisClass;\
         return reflection_s_getFields<ThisClass>(REFL_MATCH);\
    }\
     template <class ThisClass>\
     static ::reflection::FieldSet_t const* reflection_s_getFields(REFL_MATCH_0) {\
-        const char* thisClassName = className_;\
-        thisClassName = thisClassName;\
-        ::reflection::FieldSet_t const* baseClassFields = baseClass_::reflection_s_getFields<baseClass_>(REFL_MATCH);\
-        void* (*derivedPtrToBasePtr)(void*) = &::reflection::derivedPtrToBasePtr<ThisClass, baseClass_>;\
-        static ::reflection::Field_t const fields[] = {\
+        return reflection_s_staticFields<ThisClass>(::reflection::FieldSetBuilder<ThisClass>(className_,\
+                baseClass_::reflection_s_getFields<baseClass_>(REFL_MATCH), &::reflection::derivedPtrToBasePtr<ThisClass, baseClass_>));\
+    }\
+    typedef baseClass_ reflection_BaseClass;\
+    template <class ThisClass, class Visitor>\
+    static REFL_CONSTEXPR REFL_VISITOR_RESULT(Visitor) reflection_s_staticFields(Visitor&& visitor) {\
+        return visitor(\
 
 
 }
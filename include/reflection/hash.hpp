@@ -0,0 +1,242 @@
+/*
+    Boost Software License - Version 1.0 - August 17, 2003
+
+    Permission is hereby granted, free of charge, to any person or organization
+    obtaining a copy of the software and accompanying documentation covered by
+    this license (the "Software") to use, reproduce, display, distribute,
+    execute, and transmit the Software, and to prepare derivative works of the
+    Software, and to permit third-parties to whom the Software is furnished to
+    do so, all subject to the following:
+
+    The copyright notices in the Software and this entire statement, including
+    the above license grant, this restriction and the following disclaimer,
+    must be included in all copies of the Software, in whole or in part, and
+    all derivative works of the Software, unless such copies or derivative
+    works are solely in the form of machine-executable object code generated by
+    a source language processor.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+    SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+    FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "base.hpp"
+#include "magic.hpp"
+
+#include <type_traits>
+
+#ifndef REFLECTOR_AVOID_STL
+#include <functional>
+#include <string>
+#include <vector>
+#endif
+
+namespace reflection {  // UUID('c3549467-1615-4087-9829-176a2dc44b76')
+
+// XXH64 (https://github.com/Cyan4973/xxHash), reading the input as little-endian words on every host
+class XXHash64 {
+public:
+    static uint64_t hash(const void* data, size_t length, uint64_t seed) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
+        const uint8_t* end = p + length;
+        uint64_t h;
+
+        if (length >= 32) {
+            uint64_t v1 = seed + P1 + P2, v2 = seed + P2, v3 = seed, v4 = seed - P1;
+
+            for (; p + 32 <= end; p += 32) {
+                v1 = round(v1, read64(p));
+                v2 = round(v2, read64(p + 8));
+                v3 = round(v3, read64(p + 16));
+                v4 = round(v4, read64(p + 24));
+            }
+
+            h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+            h = mergeRound(h, v1);
+            h = mergeRound(h, v2);
+            h = mergeRound(h, v3);
+            h = mergeRound(h, v4);
+        }
+        else
+            h = seed + P5;
+
+        h += (uint64_t) length;
+
+        for (; p + 8 <= end; p += 8)
+            h = rotl(h ^ round(0, read64(p)), 27) * P1 + P4;
+
+        if (p + 4 <= end) {
+            h = rotl(h ^ (read32(p) * P1), 23) * P2 + P3;
+            p += 4;
+        }
+
+        for (; p < end; p++)
+            h = rotl(h ^ (*p * P5), 11) * P1;
+
+        h ^= h >> 33;
+        h *= P2;
+        h ^= h >> 29;
+        h *= P3;
+        h ^= h >> 32;
+        return h;
+    }
+
+private:
+    static const uint64_t P1 = 11400714785074694791ull;
+    static const uint64_t P2 = 14029467366897019727ull;
+    static const uint64_t P3 = 1609587929392839161ull;
+    static const uint64_t P4 = 9650029242287828579ull;
+    static const uint64_t P5 = 2870177450012600261ull;
+
+    static uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+    static uint64_t round(uint64_t acc, uint64_t input) { return rotl(acc + input * P2, 31) * P1; }
+    static uint64_t mergeRound(uint64_t acc, uint64_t v) { return (acc ^ round(0, v)) * P1 + P4; }
+
+    static uint64_t read64(const uint8_t* p) {
+        return (uint64_t) read32(p) | ((uint64_t) read32(p + 4) << 32);
+    }
+
+    static uint64_t read32(const uint8_t* p) {
+        return (uint64_t) p[0] | ((uint64_t) p[1] << 8) | ((uint64_t) p[2] << 16) | ((uint64_t) p[3] << 24);
+    }
+};
+
+// Collects the bytes of small fields and hashes them a buffer at a time; large blocks are hashed in place.
+// Each block seeds the next, so the result only depends on the sequence of values.
+class StructuralHasher {
+public:
+    explicit StructuralHasher(uint64_t seed = 0) : state(seed), used(0) {}
+
+    void update(const void* data, size_t length) {
+        if (length > sizeof(buf) - used) {
+            flush();
+
+            if (length >= sizeof(buf) / 2) {
+                state = XXHash64::hash(data, length, state);
+                return;
+            }
+        }
+
+        memcpy(buf + used, data, length);
+        used += length;
+    }
+
+    uint64_t finish() {
+        flush();
+        return state;
+    }
+
+private:
+    void flush() {
+        if (used > 0) {
+            state = XXHash64::hash(buf, used, state);
+            used = 0;
+        }
+    }
+
+    uint64_t state;
+    size_t used;
+    uint8_t buf[256];
+};
+
+// How a value of type T feeds the hasher. Scalars contribute their bytes, reflected classes their fields
+// (dependencies excluded), strings and vectors their length followed by the elements. Pointers hash by address.
+// Other types need a specialization, unless their bytes are their value (see HasUniqueBytes).
+template <typename T, typename Enable = void>
+struct StructuralHash {
+    static_assert(HasUniqueBytes<T>::value, "reflectHash: no StructuralHash for this type (its bytes may include padding)");
+
+    static void hash(StructuralHasher& hasher, const T& value) { hasher.update(&value, sizeof(value)); }
+};
+
+template <typename T>
+struct StructuralHash<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+    // +0.0 and -0.0 compare equal, so they must hash the same
+    static void hash(StructuralHasher& hasher, const T& value) {
+        T normalized = (value == 0) ? T(0) : value;
+        hasher.update(&normalized, sizeof(normalized));
+    }
+};
+
+template <typename T>
+struct StructuralHash<T, typename VoidType<decltype(&T::reflection_s_className)>::type> {
+    struct Visitor {
+        StructuralHasher& hasher;
+
+        template <class Field, typename Value>
+        void operator ()(const Field& field, const Value& value) const {
+            if (!(field.systemFlags & FIELD_DEPENDENCY))
+                StructuralHash<Value>::hash(hasher, value);
+        }
+    };
+
+    static void hash(StructuralHasher& hasher, const T& value) {
+        forEachField(value, Visitor{hasher});
+    }
+};
+
+#ifndef REFLECTOR_AVOID_STL
+template <>
+struct StructuralHash<std::string> {
+    static void hash(StructuralHasher& hasher, const std::string& value) {
+        uint64_t length = value.length();
+        hasher.update(&length, sizeof(length));
+        hasher.update(value.data(), value.length());
+    }
+};
+
+template <typename T>
+struct StructuralHash<std::vector<T>> {
+    static void hash(StructuralHasher& hasher, const std::vector<T>& value) {
+        uint64_t length = value.size();
+        hasher.update(&length, sizeof(length));
+
+        // scalars are hashed as one block, anything with structure element by element
+        hashElements(hasher, value, std::integral_constant<bool, std::is_integral<T>::value || std::is_enum<T>::value>());
+    }
+
+    static void hashElements(StructuralHasher& hasher, const std::vector<T>& value, std::true_type isBlock) {
+        if (!value.empty())
+            hasher.update(value.data(), value.size() * sizeof(T));
+    }
+
+    static void hashElements(StructuralHasher& hasher, const std::vector<T>& value, std::false_type isBlock) {
+        for (const auto& element : value)
+            StructuralHash<T>::hash(hasher, element);
+    }
+};
+#endif
+
+// 64-bit hash of the reflected state of `inst`. Resolved at compile time through forEachField, so it covers the
+// static type's fields. Stable across runs and processes on the same platform.
+template <class C>
+uint64_t reflectHash(const C& inst, uint64_t seed = 0) {
+    StructuralHasher hasher(seed);
+    StructuralHash<C>::hash(hasher, inst);
+    return hasher.finish();
+}
+
+#ifndef REFLECTOR_AVOID_STL
+// hash functor for unordered containers, e.g. std::unordered_set<Key, reflection::ReflectHash>
+struct ReflectHash {
+    template <class C>
+    size_t operator ()(const C& inst) const { return (size_t) reflectHash(inst); }
+};
+#endif
+}
+
+#ifndef REFLECTOR_AVOID_STL
+// specializes std::hash for a reflected class; use at global scope
+#define REFL_STD_HASH(class_) \
+namespace std {\
+    template <> struct hash<class_> {\
+        size_t operator ()(const class_& inst) const { return (size_t) ::reflection::reflectHash(inst); }\
+    };\
+}
+#endif
@@ -0,0 +1,452 @@
+/*
+    Boost Software License - Version 1.0 - August 17, 2003
+
+    Permission is hereby granted, free of charge, to any person or organization
+    obtaining a copy of the software and accompanying documentation covered by
+    this license (the "Software") to use, reproduce, display, distribute,
+    execute, and transmit the Software, and to prepare derivative works of the
+    Software, and to permit third-parties to whom the Software is furnished to
+    do so, all subject to the following:
+
+    The copyright notices in the Software and this entire statement, including
+    the above license grant, this restriction and the following disclaimer,
+    must be included in all copies of the Software, in whole or in part, and
+    all derivative works of the Software, unless such copies or derivative
+    works are solely in the form of machine-executable object code generated by
+    a source language processor.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+    SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+    FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "base.hpp"
+#include "magic.hpp"
+
+#include <type_traits>
+#include <utility>
+
+#ifndef REFLECTOR_AVOID_STL
+#include <functional>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+namespace reflection {  // UUID('c3549467-1615-4087-9829-176a2dc44b76')
+
+// User flags that make IndexedCollection maintain an index on a field, e.g. REFL_FIELD(id, INDEX_HASH).
+// A collection can be told to look for different bits instead (see its template arguments).
+enum {
+    INDEX_HASH = 0x40000000,            // unordered: O(1) lookups by value
+    INDEX_SORTED = 0x80000000,          // ordered: O(log n) lookups and range scans
+};
+
+enum { INDEX_KIND_HASH, INDEX_KIND_SORTED };
+
+// one secondary index; the row id is the position of the row in IndexedCollection storage
+template <class C>
+class IFieldIndex {
+public:
+    virtual ~IFieldIndex() {}
+
+    virtual void insert(size_t id, const C& row) = 0;
+    virtual void erase(size_t id, const C& row) = 0;
+    virtual void clear() = 0;
+
+    int field;                          // dataFieldIndexOf the indexed member
+    int indexKind;                      // INDEX_KIND_*
+};
+
+template <class C, typename T, typename Map>
+class FieldIndexBase : public IFieldIndex<C> {
+public:
+    void clear() override { map.clear(); }
+
+    Map map;
+
+protected:
+    void eraseEntry(const T& key, size_t id) {
+        auto range = map.equal_range(key);
+
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == id) {
+                map.erase(it);
+                return;
+            }
+        }
+    }
+};
+
+template <typename T>
+struct HashIndexMap { typedef std::unordered_multimap<T, size_t> type; };
+
+// whether a field type can have a hash / sorted index at all
+template <typename T, typename Enable = void>
+struct IsHashable : std::false_type {};
+
+template <typename T>
+struct IsHashable<T, typename VoidType<decltype(std::hash<T>()(std::declval<const T&>()))>::type> : std::true_type {};
+
+template <typename T, typename Enable = void>
+struct IsOrdered : std::false_type {};
+
+template <typename T>
+struct IsOrdered<T, typename VoidType<decltype(std::declval<const T&>() < std::declval<const T&>())>::type>
+        : std::true_type {};
+
+template <typename T>
+struct SortedIndexMap { typedef std::multimap<T, size_t> type; };
+
+#ifdef REFLECTOR_HAVE_STATIC_FIELD_TUPLE
+// Compile-time visitor over the static field list: does every non-dependency field with `flag` set have a type for
+// which `Supported<T>` holds?
+template <uint32_t flag, template <typename, typename> class Supported>
+class IndexFlagChecker {
+public:
+    typedef bool result_type;
+
+    template <typename... Fields>
+    constexpr bool operator ()(const Fields&... staticFields) const {
+        const bool supported[] = { check(staticFields)... };
+
+        for (bool fieldSupported : supported) {
+            if (!fieldSupported)
+                return false;
+        }
+
+        return true;
+    }
+
+private:
+    template <class C, typename T, T C::*member>
+    static constexpr bool check(const StaticField<C, T, member>& field) {
+        return (field.systemFlags & FIELD_DEPENDENCY) || !(field.flags & flag) || Supported<T, void>::value;
+    }
+
+    static constexpr bool check(const StaticFieldEnd&) { return true; }
+};
+
+template <class C, class Checker>
+constexpr bool checkStaticFields(const Checker& checker, std::true_type baseIsVoid) {
+    return C::template reflection_s_staticFields<C>(checker);
+}
+
+template <class C, class Checker>
+constexpr bool checkStaticFields(const Checker& checker, std::false_type baseIsVoid) {
+    typedef typename C::reflection_BaseClass Base;
+
+    return C::template reflection_s_staticFields<C>(checker)
+            && checkStaticFields<Base>(checker, std::is_void<typename Base::reflection_BaseClass>());
+}
+#endif
+
+template <class C, typename T, const T& (*key)(const C&), class Map>
+class FieldIndex : public FieldIndexBase<C, T, Map> {
+public:
+    void insert(size_t id, const C& row) override { this->map.insert(std::make_pair(key(row), id)); }
+    void erase(size_t id, const C& row) override { this->eraseEntry(key(row), id); }
+};
+
+template <class C, class Owner, typename T, T Owner::*member>
+const T& indexKey(const C& row) { return row.*member; }
+
+template <class C, uint32_t hashFlag, uint32_t sortedFlag>
+class FieldIndexBuilder {
+public:
+    explicit FieldIndexBuilder(std::vector<IFieldIndex<C>*>& indexes) : indexes(indexes), field(0) {}
+
+    template <class Owner, typename T, T Owner::*member>
+    void operator ()(const StaticField<Owner, T, member>& staticField) {
+        if (staticField.systemFlags & FIELD_DEPENDENCY)
+            return;
+
+        addHashIndex<T, &indexKey<C, Owner, T, member>>((staticField.flags & hashFlag) != 0, IsHashable<T>());
+        addSortedIndex<T, &indexKey<C, Owner, T, member>>((staticField.flags & sortedFlag) != 0, IsOrdered<T>());
+        field++;
+    }
+
+private:
+    template <typename T, const T& (*key)(const C&)>
+    void addHashIndex(bool flagged, std::true_type hashable) {
+        if (flagged)
+            add(new FieldIndex<C, T, key, typename HashIndexMap<T>::type>(), INDEX_KIND_HASH);
+    }
+
+    // rejected at compile time where the field list is constexpr (C++14); before that, lookups fall back to a scan
+    template <typename T, const T& (*key)(const C&)>
+    void addHashIndex(bool flagged, std::false_type hashable) {
+        assert(!flagged && "IndexedCollection: field type has no std::hash");
+    }
+
+    template <typename T, const T& (*key)(const C&)>
+    void addSortedIndex(bool flagged, std::true_type ordered) {
+        if (flagged)
+            add(new FieldIndex<C, T, key, typename SortedIndexMap<T>::type>(), INDEX_KIND_SORTED);
+    }
+
+    template <typename T, const T& (*key)(const C&)>
+    void addSortedIndex(bool flagged, std::false_type ordered) {
+        assert(!flagged && "IndexedCollection: field type has no operator <");
+    }
+
+    void add(IFieldIndex<C>* index, int indexKind) {
+        index->field = field;
+        index->indexKind = indexKind;
+        indexes.push_back(index);
+    }
+
+    std::vector<IFieldIndex<C>*>& indexes;
+    int field;
+};
+
+// In-memory table of C rows with secondary indexes on the fields flagged with `hashFlag` (hash index) and/or
+// `sortedFlag` (ordered index). Rows are addressed by a stable id; insert, update and erase keep every index
+// consistent. Lookups on a field without a suitable index fall back to a linear scan.
+//
+//     struct User {
+//         int64_t id;
+//         std::string email;
+//         int32_t age;
+//
+//         REFL_BEGIN("User", 1)
+//             REFL_FIELD(id, INDEX_HASH)
+//             REFL_FIELD(email, INDEX_HASH)
+//             REFL_FIELD(age, INDEX_SORTED)
+//         REFL_END
+//     };
+//
+//     users.findOne(&User::email, email);
+//     users.forEachInRange(&User::age, 18, 30, [](size_t id, const User& user) { ... });
+template <class C, uint32_t hashFlag = INDEX_HASH, uint32_t sortedFlag = INDEX_SORTED>
+class IndexedCollection {
+public:
+    IndexedCollection() : count(0) {
+#ifdef REFLECTOR_HAVE_STATIC_FIELD_TUPLE
+        static_assert(checkStaticFields<C>(IndexFlagChecker<hashFlag, IsHashable>(),
+                std::is_void<typename C::reflection_BaseClass>()),
+                "IndexedCollection: a field flagged for a hash index has no std::hash");
+        static_assert(checkStaticFields<C>(IndexFlagChecker<sortedFlag, IsOrdered>(),
+                std::is_void<typename C::reflection_BaseClass>()),
+                "IndexedCollection: a field flagged for a sorted index has no operator <");
+#endif
+
+        FieldIndexBuilder<C, hashFlag, sortedFlag> builder(indexes);
+        forEachStaticField<C>(builder);
+    }
+
+    ~IndexedCollection() {
+        for (size_t i = 0; i < indexes.size(); i++)
+            delete indexes[i];
+    }
+
+    IndexedCollection(const IndexedCollection& other) = delete;
+    IndexedCollection& operator =(const IndexedCollection& other) = delete;
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    void clear() {
+        rows.clear();
+        alive.clear();
+        freeIds.clear();
+        count = 0;
+
+        for (size_t i = 0; i < indexes.size(); i++)
+            indexes[i]->clear();
+    }
+
+    // returns the id of the new row; ids of erased rows are reused
+    size_t insert(const C& row) {
+        size_t id;
+
+        if (!freeIds.empty()) {
+            id = freeIds.back();
+            freeIds.pop_back();
+            rows[id] = row;
+            alive[id] = 1;
+        }
+        else {
+            id = rows.size();
+            rows.push_back(row);
+            alive.push_back(1);
+        }
+
+        for (size_t i = 0; i < indexes.size(); i++)
+            indexes[i]->insert(id, rows[id]);
+
+        count++;
+        return id;
+    }
+
+    // replaces a row, re-indexing it
+    bool update(size_t id, const C& row) {
+        if (!contains(id))
+            return false;
+
+        for (size_t i = 0; i < indexes.size(); i++)
+            indexes[i]->erase(id, rows[id]);
+
+        rows[id] = row;
+
+        for (size_t i = 0; i < indexes.size(); i++)
+            indexes[i]->insert(id, rows[id]);
+
+        return true;
+    }
+
+    bool erase(size_t id) {
+        if (!contains(id))
+            return false;
+
+        for (size_t i = 0; i < indexes.size(); i++)
+            indexes[i]->erase(id, rows[id]);
+
+        alive[id] = 0;
+        freeIds.push_back(id);
+        count--;
+        return true;
+    }
+
+    bool contains(size_t id) const { return id < rows.size() && alive[id]; }
+
+    // nullptr if there is no such row. Rows may only be modified through update().
+    const C* get(size_t id) const { return contains(id) ? &rows[id] : nullptr; }
+
+    // any row whose `member` equals `key`, or nullptr
+    template <class Owner, typename T>
+    const C* findOne(T Owner::*member, const T& key, size_t* id_out = nullptr) const {
+        const C* found = nullptr;
+
+        forEachEqual(member, key, [&](size_t id, const C& row) {
+            if (found == nullptr) {
+                found = &row;
+
+                if (id_out != nullptr)
+                    *id_out = id;
+            }
+        });
+
+        return found;
+    }
+
+    // calls func(id, row) for every row whose `member` equals `key`; returns the number of rows
+    template <class Owner, typename T, typename Func>
+    size_t forEachEqual(T Owner::*member, const T& key, Func func) const {
+        int field = dataFieldIndexOf<C>(member);
+        size_t n;
+
+        if (equalInHashIndex(field, key, func, n, IsHashable<T>()) || equalInSortedIndex(field, key, func, n, IsOrdered<T>()))
+            return n;
+
+        return scan([&](const C& row) { return row.*member == key; }, func);
+    }
+
+    // calls func(id, row) for every row with lo <= `member` <= hi, in key order if the field has a sorted index
+    template <class Owner, typename T, typename Func>
+    size_t forEachInRange(T Owner::*member, const T& lo, const T& hi, Func func) const {
+        int field = dataFieldIndexOf<C>(member);
+        size_t n;
+
+        if (rangeInSortedIndex(field, lo, hi, func, n, IsOrdered<T>()))
+            return n;
+
+        return scan([&](const C& row) { return !(row.*member < lo) && !(hi < row.*member); }, func);
+    }
+
+    // calls func(id, row) for every row
+    template <typename Func>
+    void forEach(Func func) const {
+        for (size_t id = 0; id < rows.size(); id++) {
+            if (alive[id])
+                func(id, rows[id]);
+        }
+    }
+
+private:
+    template <typename T, class Map>
+    const FieldIndexBase<C, T, Map>* findIndex(int field, int indexKind) const {
+        for (size_t i = 0; i < indexes.size(); i++) {
+            if (indexes[i]->field == field && indexes[i]->indexKind == indexKind)
+                return static_cast<const FieldIndexBase<C, T, Map>*>(indexes[i]);
+        }
+
+        return nullptr;
+    }
+
+    template <typename T, typename Func>
+    bool equalInHashIndex(int field, const T& key, Func& func, size_t& n_out, std::true_type hashable) const {
+        auto index = findIndex<T, typename HashIndexMap<T>::type>(field, INDEX_KIND_HASH);
+        return index != nullptr && (n_out = visit(index->map.equal_range(key), func), true);
+    }
+
+    template <typename T, typename Func>
+    bool equalInHashIndex(int field, const T& key, Func& func, size_t& n_out, std::false_type hashable) const {
+        return false;
+    }
+
+    template <typename T, typename Func>
+    bool equalInSortedIndex(int field, const T& key, Func& func, size_t& n_out, std::true_type ordered) const {
+        auto index = findIndex<T, typename SortedIndexMap<T>::type>(field, INDEX_KIND_SORTED);
+        return index != nullptr && (n_out = visit(index->map.equal_range(key), func), true);
+    }
+
+    template <typename T, typename Func>
+    bool equalInSortedIndex(int field, const T& key, Func& func, size_t& n_out, std::false_type ordered) const {
+        return false;
+    }
+
+    template <typename T, typename Func>
+    bool rangeInSortedIndex(int field, const T& lo, const T& hi, Func& func, size_t& n_out, std::true_type ordered) const {
+        auto index = findIndex<T, typename SortedIndexMap<T>::type>(field, INDEX_KIND_SORTED);
+
+        if (index == nullptr)
+            return false;
+
+        n_out = (hi < lo) ? 0 : visit(std::make_pair(index->map.lower_bound(lo), index->map.upper_bound(hi)), func);
+        return true;
+    }
+
+    template <typename T, typename Func>
+    bool rangeInSortedIndex(int field, const T& lo, const T& hi, Func& func, size_t& n_out, std::false_type ordered) const {
+        return false;
+    }
+
+    template <class Range, typename Func>
+    size_t visit(const Range& range, Func& func) const {
+        size_t n = 0;
+
+        for (auto it = range.first; it != range.second; ++it, ++n)
+            func(it->second, rows[it->second]);
+
+        return n;
+    }
+
+    template <class Pred, typename Func>
+    size_t scan(Pred pred, Func& func) const {
+        size_t n = 0;
+
+        for (size_t id = 0; id < rows.size(); id++) {
+            if (alive[id] && pred(rows[id])) {
+                func(id, rows[id]);
+                n++;
+            }
+        }
+
+        return n;
+    }
+
+    std::vector<C> rows;
+    std::vector<uint8_t> alive;
+    std::vector<size_t> freeIds;
+    size_t count;
+
+    std::vector<IFieldIndex<C>*> indexes;
+};
+}
+#endif
@@ -0,0 +1,959 @@
+/*
+    Boost Software License - Version 1.0 - August 17, 2003
+
+    Permission is hereby granted, free of charge, to any person or organization
+    obtaining a copy of the software and accompanying documentation covered by
+    this license (the "Software") to use, reproduce, display, distribute,
+    execute, and transmit the Software, and to prepare derivative works of the
+    Software, and to permit third-parties to whom the Software is furnished to
+    do so, all subject to the following:
+
+    The copyright notices in the Software and this entire statement, including
+    the above license grant, this restriction and the following disclaimer,
+    must be included in all copies of the Software, in whole or in part, and
+    all derivative works of the Software, unless such copies or derivative
+    works are solely in the form of machine-executable object code generated by
+    a source language processor.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+    SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+    FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef REFLECTOR_HAVE_JSON
+#define REFLECTOR_HAVE_JSON
+
+#include "base.hpp"
+#include "bufstring.hpp"
+#include "charconv.hpp"
+#include "field_index.hpp"
+
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define REFLECTOR_JSON_SSE2
+#endif
+
+#ifndef REFLECTOR_AVOID_STL
+#include <string>
+#include <vector>
+#endif
+
+namespace serialization {
+
+// Streaming JSON writer. Output accumulates in a growable buffer; values are formatted in place, without temporaries.
+class JsonWriter {
+public:
+    JsonWriter() : buf(nullptr), length(0), capacity(0), needsSeparator(false) {}
+    ~JsonWriter() { free(buf); }
+
+    JsonWriter(const JsonWriter& other) = delete;
+    JsonWriter& operator =(const JsonWriter& other) = delete;
+
+    bool beginObject(IErrorHandler* err) { return beginContainer(err, '{'); }
+    bool endObject(IErrorHandler* err) { return endContainer(err, '}'); }
+    bool beginArray(IErrorHandler* err) { return beginContainer(err, '['); }
+    bool endArray(IErrorHandler* err) { return endContainer(err, ']'); }
+
+    bool key(IErrorHandler* err, const char* name) {
+        if (!writeString(err, name, strlen(name)) || !reserve(err, 1))
+            return false;
+
+        buf[length++] = ':';
+        needsSeparator = false;
+        return true;
+    }
+
+    bool writeNull(IErrorHandler* err) { return writeRaw(err, "null", 4); }
+    bool writeBool(IErrorHandler* err, bool value) { return value ? writeRaw(err, "true", 4) : writeRaw(err, "false", 5); }
+
+    bool writeInt(IErrorHandler* err, int64_t value) {
+        if (!reserve(err, 1 + reflection::MAX_INT_CHARS))
+            return false;
+
+        separate();
+        length += reflection::formatInt(buf + length, value);
+        return true;
+    }
+
+    bool writeUInt(IErrorHandler* err, uint64_t value) {
+        if (!reserve(err, 1 + reflection::MAX_INT_CHARS))
+            return false;
+
+        separate();
+        length += reflection::formatUInt(buf + length, value);
+        return true;
+    }
+
+    // JSON has no representation for NaN and infinities; they are written as null
+    bool writeDouble(IErrorHandler* err, double value) {
+        if (!std::isfinite(value))
+            return writeNull(err);
+
+        if (!reserve(err, 1 + reflection::MAX_FLOAT_CHARS))
+            return false;
+
+        separate();
+        length += reflection::formatDouble(buf + length, value);
+        return true;
+    }
+
+    bool writeFloat(IErrorHandler* err, float value) {
+        if (!std::isfinite(value))
+            return writeNull(err);
+
+        if (!reserve(err, 1 + reflection::MAX_FLOAT_CHARS))
+            return false;
+
+        separate();
+        length += reflection::formatFloat(buf + length, value);
+        return true;
+    }
+
+    // UTF-8 is passed through as-is; only '"', '\\' and control characters are escaped
+    bool writeString(IErrorHandler* err, const char* str, size_t strLen) {
+        if (!reserve(err, 2))
+            return false;
+
+        separate();
+        buf[length++] = '"';
+
+        while (strLen > 0) {
+            // worst case every byte becomes \u00XX
+            size_t chunk = strLen < (size_t) CHUNK_SIZE ? strLen : (size_t) CHUNK_SIZE;
+
+            if (!reserve(err, chunk * 6 + 1))
+                return false;
+
+            length += escape(buf + length, str, chunk);
+            str += chunk;
+            strLen -= chunk;
+        }
+
+        buf[length++] = '"';
+        return true;
+    }
+
+    // append already-formatted JSON text as one value
+    bool writeRaw(IErrorHandler* err, const char* json, size_t jsonLen) {
+        if (!reserve(err, 1 + jsonLen))
+            return false;
+
+        separate();
+        memcpy(buf + length, json, jsonLen);
+        length += jsonLen;
+        return true;
+    }
+
+    // terminates the current top-level value, e.g. to produce JSON Lines
+    bool endLine(IErrorHandler* err) {
+        if (!reserve(err, 1))
+            return false;
+
+        buf[length++] = '\n';
+        needsSeparator = false;
+        return true;
+    }
+
+    const char* data() const { return buf; }
+    size_t size() const { return length; }
+
+    void clear() {
+        length = 0;
+        needsSeparator = false;
+    }
+
+private:
+    enum { CHUNK_SIZE = 4096 };
+
+    bool reserve(IErrorHandler* err, size_t count) {
+        if (length + count <= capacity)
+            return true;
+
+        size_t newCapacity = capacity * 2;
+
+        if (newCapacity < length + count)
+            newCapacity = length + count;
+
+        return reflection::ensureSize(err, buf, capacity, newCapacity);
+    }
+
+    void separate() {
+        if (needsSeparator)
+            buf[length++] = ',';
+
+        needsSeparator = true;
+    }
+
+    bool beginContainer(IErrorHandler* err, char c) {
+        if (!reserve(err, 2))
+            return false;
+
+        separate();
+        buf[length++] = c;
+        needsSeparator = false;
+        return true;
+    }
+
+    bool endContainer(IErrorHandler* err, char c) {
+        if (!reserve(err, 1))
+            return false;
+
+        buf[length++] = c;
+        needsSeparator = true;
+        return true;
+    }
+
+    static size_t escapeChar(char* out, unsigned char c) {
+        static const char hex[] = "0123456789abcdef";
+
+        switch (c) {
+            case '"':   out[0] = '\\'; out[1] = '"'; return 2;
+            case '\\':  out[0] = '\\'; out[1] = '\\'; return 2;
+            case '\b':  out[0] = '\\'; out[1] = 'b'; return 2;
+            case '\f':  out[0] = '\\'; out[1] = 'f'; return 2;
+            case '\n':  out[0] = '\\'; out[1] = 'n'; return 2;
+            case '\r':  out[0] = '\\'; out[1] = 'r'; return 2;
+            case '\t':  out[0] = '\\'; out[1] = 't'; return 2;
+            default:
+                memcpy(out, "\\u00", 4);
+                out[4] = hex[c >> 4];
+                out[5] = hex[c & 15];
+                return 6;
+        }
+    }
+
+    static bool needsEscape(unsigned char c) {
+        return c < 0x20 || c == '"' || c == '\\';
+    }
+
+    // out must have room for 6 * strLen bytes
+    static size_t escape(char* out, const char* str, size_t strLen) {
+        char* p = out;
+        size_t i = 0;
+
+#ifdef REFLECTOR_JSON_SSE2
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i control = _mm_set1_epi8(0x1F);
+
+        while (i + 16 <= strLen) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i));
+
+            // bytes <= 0x1F (unsigned) compare equal to their max with 0x1F
+            __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                    _mm_cmpeq_epi8(_mm_max_epu8(v, control), control));
+
+            int mask = _mm_movemask_epi8(special);
+
+            // copy all 16 bytes speculatively; anything past the first special byte is overwritten below
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+
+            if (mask == 0) {
+                p += 16;
+                i += 16;
+                continue;
+            }
+
+            int clean = 0;
+            while (!(mask & (1 << clean)))
+                clean++;
+
+            p += clean;
+            i += clean;
+            p += escapeChar(p, (unsigned char) str[i]);
+            i++;
+        }
+#endif
+
+        for (; i < strLen; i++) {
+            unsigned char c = (unsigned char) str[i];
+
+            if (needsEscape(c))
+                p += escapeChar(p, c);
+            else
+                *p++ = (char) c;
+        }
+
+        return p - out;
+    }
+
+    char* buf;
+    size_t length;
+    size_t capacity;
+    bool needsSeparator;
+};
+
+// In-situ JSON reader. Tokens are scanned directly in the input (which is not modified and need not be terminated);
+// values are handed to the caller as spans or converted straight into their destination.
+class JsonReader {
+public:
+    JsonReader(const char* json, size_t length) : begin(json), pos(json), end(json + length) {}
+
+    JsonReader(const JsonReader& other) = delete;
+    JsonReader& operator =(const JsonReader& other) = delete;
+
+    bool beginObject(IErrorHandler* err) { return expect(err, '{'); }
+    bool beginArray(IErrorHandler* err) { return expect(err, '['); }
+
+    // Advances to the next member of the current object, consuming the key and the colon.
+    // `first` must be true for the first call after beginObject; `done` is set once the closing brace is consumed.
+    bool nextKey(IErrorHandler* err, bool first, bool& done, const char*& key, size_t& keyLen) {
+        if (!nextItem(err, first, '}', done))
+            return false;
+
+        if (done)
+            return true;
+
+        if (!readRawString(err, key, keyLen))
+            return false;
+
+        return expect(err, ':');
+    }
+
+    // Advances to the next element of the current array, see nextKey
+    bool nextElement(IErrorHandler* err, bool first, bool& done) {
+        return nextItem(err, first, ']', done);
+    }
+
+    // true if the next value is `null` (which is then consumed)
+    bool tryNull() {
+        skipWhitespace();
+
+        if (end - pos >= 4 && memcmp(pos, "null", 4) == 0) {
+            pos += 4;
+            return true;
+        }
+
+        return false;
+    }
+
+    bool readBool(IErrorHandler* err, bool& value_out) {
+        skipWhitespace();
+
+        if (end - pos >= 4 && memcmp(pos, "true", 4) == 0) {
+            pos += 4;
+            value_out = true;
+            return true;
+        }
+        else if (end - pos >= 5 && memcmp(pos, "false", 5) == 0) {
+            pos += 5;
+            value_out = false;
+            return true;
+        }
+
+        return syntaxError(err, "boolean");
+    }
+
+    template <typename Int_t>
+    bool readInteger(IErrorHandler* err, Int_t& value_out) {
+        const char* number = nullptr;
+        size_t numberLen = 0;
+
+        if (!readNumberToken(err, number, numberLen))
+            return false;
+
+        switch (reflection::parseInteger(number, numberLen, value_out)) {
+            case reflection::PARSE_OK:
+                return true;
+            case reflection::PARSE_OUT_OF_RANGE:
+                return err->errorf("IntegerOverflow", "Value `%.*s` at offset %u is outside the limit for this type.",
+                        (int) numberLen, number, (unsigned int)(number - begin)), false;
+            default:
+                pos = number;
+                return syntaxError(err, "integer");
+        }
+    }
+
+    // `null` reads as NaN, mirroring how JsonWriter stores non-finite values
+    template <typename Float_t>
+    bool readFloat(IErrorHandler* err, Float_t& value_out) {
+        if (tryNull()) {
+            value_out = std::numeric_limits<Float_t>::quiet_NaN();
+            return true;
+        }
+
+        const char* number = nullptr;
+        size_t numberLen = 0;
+
+        if (!readNumberToken(err, number, numberLen))
+            return false;
+
+        switch (reflection::parseFloat(number, numberLen, value_out)) {
+            case reflection::PARSE_OK:
+                return true;
+            case reflection::PARSE_OUT_OF_RANGE:
+                return err->errorf("FloatOverflow", "Value `%.*s` at offset %u is outside the limit for this type.",
+                        (int) numberLen, number, (unsigned int)(number - begin)), false;
+            default:
+                pos = number;
+                return syntaxError(err, "number");
+        }
+    }
+
+    // Decodes a string value; `appender` receives the unescaped text in one or more pieces. Its append() returns false
+    // (having reported the error) to abort, e.g. when out of memory.
+    template <class Appender>
+    bool readString(IErrorHandler* err, Appender& appender) {
+        skipWhitespace();
+
+        if (pos == end || *pos != '"')
+            return syntaxError(err, "string");
+
+        pos++;
+
+        for (;;) {
+            const char* run = pos;
+            scanString();
+
+            if (pos == end)
+                return err->unexpectedEndOfInput(":json"), false;
+
+            if (pos > run && !appender.append(run, pos - run))
+                return false;
+
+            if (*pos == '"') {
+                pos++;
+                return true;
+            }
+
+            if (*pos != '\\')
+                return syntaxError(err, "string (unescaped control character)");
+
+            char utf8[4];
+            size_t utf8Len;
+
+            if (!readEscape(err, utf8, utf8Len))
+                return false;
+
+            if (!appender.append(utf8, utf8Len))
+                return false;
+        }
+    }
+
+    // Skips over any value. Nested containers are only checked for matching brackets and well-formed strings.
+    bool skipValue(IErrorHandler* err) {
+        skipWhitespace();
+
+        if (pos == end)
+            return err->unexpectedEndOfInput(":json"), false;
+
+        switch (*pos) {
+            case '"': return skipString(err);
+            case 't': case 'f': { bool dummy; return readBool(err, dummy); }
+            case 'n': return tryNull() || syntaxError(err, "value");
+            case '{': case '[': break;
+            default: { const char* number; size_t numberLen; return readNumberToken(err, number, numberLen); }
+        }
+
+        // one bit per open container, set for an object
+        uint64_t objects = 0;
+        int depth = 0;
+
+        while (pos < end) {
+            switch (*pos) {
+                case '"':
+                    if (!skipString(err))
+                        return false;
+                    continue;
+
+                case '{': case '[':
+                    if (depth == MAX_SKIP_DEPTH)
+                        return err->errorf("JsonSyntaxError", "Values nested more than %d levels deep at offset %u.",
+                                (int) MAX_SKIP_DEPTH, (unsigned int)(pos - begin)), false;
+
+                    objects = (objects << 1) | (*pos == '{' ? 1 : 0);
+                    depth++;
+                    break;
+
+                case '}': case ']':
+                    if ((objects & 1) != (*pos == '}' ? 1u : 0u))
+                        return syntaxError(err, (objects & 1) ? "'}'" : "']'");
+
+                    objects >>= 1;
+
+                    if (--depth == 0) {
+                        pos++;
+                        return true;
+                    }
+                    break;
+            }
+
+            pos++;
+        }
+
+        return err->unexpectedEndOfInput(":json"), false;
+    }
+
+    // only whitespace remains
+    bool atEnd() {
+        skipWhitespace();
+        return pos == end;
+    }
+
+    bool expectEnd(IErrorHandler* err) {
+        return atEnd() || syntaxError(err, "end of input");
+    }
+
+    size_t offset() const { return pos - begin; }
+
+    bool syntaxError(IErrorHandler* err, const char* expected) {
+        if (pos == end)
+            return err->unexpectedEndOfInput(":json"), false;
+
+        return err->errorf("JsonSyntaxError", "Expected %s at offset %u.", expected, (unsigned int)(pos - begin)), false;
+    }
+
+private:
+    enum { MAX_SKIP_DEPTH = 64 };
+
+    struct KeyAppender {
+        KeyAppender(IErrorHandler* err, reflection::BufString_t& buf) : err(err), buf(buf), length(0) {}
+
+        bool append(const char* str, size_t strLen) {
+            if (!reflection::ensureSize(err, buf.buf, buf.bufSize, length + strLen))
+                return false;
+
+            memcpy(buf.buf + length, str, strLen);
+            length += strLen;
+            return true;
+        }
+
+        IErrorHandler* err;
+        reflection::BufString_t& buf;
+        size_t length;
+    };
+
+    struct NullAppender {
+        bool append(const char*, size_t) { return true; }
+    };
+
+    static bool isWhitespace(char c) {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+    }
+
+    void skipWhitespace() {
+        while (pos < end && isWhitespace(*pos))
+            pos++;
+    }
+
+    bool expect(IErrorHandler* err, char c) {
+        skipWhitespace();
+
+        if (pos == end || *pos != c) {
+            char what[4] = {'\'', c, '\'', 0};
+            return syntaxError(err, what);
+        }
+
+        pos++;
+        return true;
+    }
+
+    bool nextItem(IErrorHandler* err, bool first, char close, bool& done) {
+        skipWhitespace();
+
+        if (pos < end && *pos == close && first) {
+            pos++;
+            done = true;
+            return true;
+        }
+
+        done = false;
+
+        if (!first) {
+            if (pos < end && *pos == close) {
+                pos++;
+                done = true;
+                return true;
+            }
+
+            if (!expect(err, ','))
+                return false;
+        }
+
+        return true;
+    }
+
+    // Keys without escapes point straight into the input; others are decoded into a scratch buffer
+    bool readRawString(IErrorHandler* err, const char*& str_out, size_t& strLen_out) {
+        skipWhitespace();
+
+        if (pos == end || *pos != '"')
+            return syntaxError(err, "string");
+
+        const char* str = pos + 1;
+        pos = str;
+        scanString();
+
+        if (pos < end && *pos == '"') {
+            str_out = str;
+            strLen_out = pos - str;
+            pos++;
+            return true;
+        }
+
+        pos = str - 1;
+        KeyAppender appender(err, scratch);
+
+        if (!readString(err, appender))
+            return false;
+
+        str_out = scratch.buf;
+        strLen_out = appender.length;
+        return true;
+    }
+
+    bool skipString(IErrorHandler* err) {
+        NullAppender appender;
+        return readString(err, appender);
+    }
+
+    // advance pos to the first '"', '\\' or control character (or the end of input)
+    void scanString() {
+#ifdef REFLECTOR_JSON_SSE2
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i control = _mm_set1_epi8(0x1F);
+
+        while (end - pos >= 16) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+            __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                    _mm_cmpeq_epi8(_mm_max_epu8(v, control), control));
+
+            int mask = _mm_movemask_epi8(special);
+
+            if (mask != 0) {
+                while (!(mask & 1)) {
+                    mask >>= 1;
+                    pos++;
+                }
+
+                return;
+            }
+
+            pos += 16;
+        }
+#endif
+
+        while (pos < end) {
+            unsigned char c = (unsigned char) *pos;
+
+            if (c == '"' || c == '\\' || c < 0x20)
+                return;
+
+            pos++;
+        }
+    }
+
+    bool readHex4(IErrorHandler* err, uint32_t& value_out) {
+        if (end - pos < 4)
+            return err->unexpectedEndOfInput(":json"), false;
+
+        value_out = 0;
+
+        for (int i = 0; i < 4; i++) {
+            char c = *pos;
+            uint32_t digit;
+
+            if (c >= '0' && c <= '9')       digit = c - '0';
+            else if (c >= 'a' && c <= 'f')  digit = c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F')  digit = c - 'A' + 10;
+            else                            return syntaxError(err, "hex digit");
+
+            value_out = (value_out << 4) | digit;
+            pos++;
+        }
+
+        return true;
+    }
+
+    // pos is at the backslash
+    bool readEscape(IErrorHandler* err, char utf8[4], size_t& utf8Len) {
+        if (end - pos < 2)
+            return err->unexpectedEndOfInput(":json"), false;
+
+        char c = pos[1];
+        pos += 2;
+        utf8Len = 1;
+
+        switch (c) {
+            case '"':   utf8[0] = '"'; return true;
+            case '\\':  utf8[0] = '\\'; return true;
+            case '/':   utf8[0] = '/'; return true;
+            case 'b':   utf8[0] = '\b'; return true;
+            case 'f':   utf8[0] = '\f'; return true;
+            case 'n':   utf8[0] = '\n'; return true;
+            case 'r':   utf8[0] = '\r'; return true;
+            case 't':   utf8[0] = '\t'; return true;
+            case 'u':   break;
+            default:    pos -= 2; return syntaxError(err, "escape sequence");
+        }
+
+        uint32_t cp;
+
+        if (!readHex4(err, cp))
+            return false;
+
+        if (cp >= 0xD800 && cp <= 0xDBFF) {
+            uint32_t low;
+
+            if (end - pos < 2 || pos[0] != '\\' || pos[1] != 'u')
+                return syntaxError(err, "low surrogate");
+
+            pos += 2;
+
+            if (!readHex4(err, low))
+                return false;
+
+            if (low < 0xDC00 || low > 0xDFFF)
+                return syntaxError(err, "low surrogate");
+
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+        }
+        else if (cp >= 0xDC00 && cp <= 0xDFFF)
+            return syntaxError(err, "high surrogate");
+
+        if (cp < 0x80) {
+            utf8[0] = (char) cp;
+        }
+        else if (cp < 0x800) {
+            utf8[0] = (char)(0xC0 | (cp >> 6));
+            utf8[1] = (char)(0x80 | (cp & 0x3F));
+            utf8Len = 2;
+        }
+        else if (cp < 0x10000) {
+            utf8[0] = (char)(0xE0 | (cp >> 12));
+            utf8[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+            utf8[2] = (char)(0x80 | (cp & 0x3F));
+            utf8Len = 3;
+        }
+        else {
+            utf8[0] = (char)(0xF0 | (cp >> 18));
+            utf8[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+            utf8[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+            utf8[3] = (char)(0x80 | (cp & 0x3F));
+            utf8Len = 4;
+        }
+
+        return true;
+    }
+
+    bool readNumberToken(IErrorHandler* err, const char*& number_out, size_t& numberLen_out) {
+        skipWhitespace();
+
+        const char* number = pos;
+
+        while (pos < end && ((*pos >= '0' && *pos <= '9') || *pos == '-' || *pos == '+' || *pos == '.'
+                || *pos == 'e' || *pos == 'E'))
+            pos++;
+
+        if (pos == number)
+            return syntaxError(err, "value");
+
+        number_out = number;
+        numberLen_out = pos - number;
+        return true;
+    }
+
+    const char* begin;
+    const char* pos;
+    const char* end;
+
+    reflection::BufString_t scratch;
+};
+
+// Fallback for types without a dedicated specialization (mostly reflected classes): dispatch through their reflection
+template <typename T>
+class JsonSerializer {
+public:
+    static bool serialize(IErrorHandler* err, JsonWriter* writer, const T& value, uint32_t fieldMask) {
+        return reflection::reflectionForType2<T>()->toJson(err, writer, fieldMask, reinterpret_cast<const void*>(&value));
+    }
+
+    static bool deserialize(IErrorHandler* err, JsonReader* reader, T& value_out, uint32_t fieldMask) {
+        return reflection::reflectionForType2<T>()->setFromJson(err, reader, fieldMask, reinterpret_cast<void*>(&value_out));
+    }
+};
+
+template <>
+class JsonSerializer<bool> {
+public:
+    static bool serialize(IErrorHandler* err, JsonWriter* writer, const bool& value, uint32_t) {
+        return writer->writeBool(err, value);
+    }
+
+    static bool deserialize(IErrorHandler* err, JsonReader* reader, bool& value_out, uint32_t) {
+        return reader->readBool(err, value_out);
+    }
+};
+
+template <typename T>
+class JsonIntSerializer {
+public:
+    static bool serialize(IErrorHandler* err, JsonWriter* writer, const T& value, uint32_t) {
+        if (std::numeric_limits<T>::is_signed)
+            return writer->writeInt(err, (int64_t) value);
+        else
+            return writer->writeUInt(err, (uint64_t) value);
+    }
+
+    static bool deserialize(IErrorHandler* err, JsonReader* reader, T& value_out, uint32_t) {
+        return reader->readInteger(err, value_out);
+    }
+};
+
+template <> class JsonSerializer<char> :                public JsonIntSerializer<char> {};
+template <> class JsonSerializer<unsigned char> :       public JsonIntSerializer<unsigned char> {};
+template <> class JsonSerializer<short> :               public JsonIntSerializer<short> {};
+template <> class JsonSerializer<int> :                 public JsonIntSerializer<int> {};
+template <> class JsonSerializer<long> :                public JsonIntSerializer<long> {};
+template <> class JsonSerializer<long long> :           public JsonIntSerializer<long long> {};
+template <> class JsonSerializer<unsigned short> :      public JsonIntSerializer<unsigned short> {};
+template <> class JsonSerializer<unsigned int> :        public JsonIntSerializer<unsigned int> {};
+template <> class JsonSerializer<unsigned long> :       public JsonIntSerializer<unsigned long> {};
+template <> class JsonSerializer<unsigned long long> :  public JsonIntSerializer<unsigned long long> {};
+
+template <>
+class JsonSerializer<float> {
+public:
+    static bool serialize(IErrorHandler* err, JsonWriter* writer, const float& value, uint32_t) {
+        return writer->writeFloat(err, value);
+    }
+
+    static bool deserialize(IErrorHandler* err, JsonReader* reader, float& value_out, uint32_t) {
+        return reader->readFloat(err, value_out);
+    }
+};
+
+template <>
+class JsonSerializer<double> {
+public:
+    static bool serialize(IErrorHandler* err, JsonWriter* writer, const double& value, uint32_t) {
+        return writer->writeDouble(err, value);
+    }
+
+    static bool deserialize(IErrorHandler* err, JsonReader* reader, double& value_out, uint32_t) {
+        return reader->readFloat(err, value_out);
+    }
+};
+
+#ifndef REFLECTOR_AVOID_STL
+template <>
+class JsonSerializer<std::string> {
+public:
+    static bool serialize(IErrorHandler* err, JsonWriter* writer, const std::string& value, uint32_t) {
+        return writer->writeString(err, value.c_str(), value.length());
+    }
+
+    static bool deserialize(IErrorHandler* err, JsonReader* reader, std::string& value_out, uint32_t) {
+        struct Appender {
+            Appender(std::string& str) : str(str) {}
+            bool append(const char* s, size_t sLen) { str.append(s, sLen); return true; }
+            std::string& str;
+        } appender(value_out);
+
+        value_out.clear();
+        return reader->readString(err, appender);
+    }
+};
+
+template <typename T>
+class JsonSerializer<std::vector<T>> {
+public:
+    static bool serialize(IErrorHandler* err, JsonWriter* writer, const std::vector<T>& value, uint32_t fieldMask) {
+        if (!writer->beginArray(err))
+            return false;
+
+        for (size_t i = 0; i < value.size(); i++)
+            if (!JsonSerializer<T>::serialize(err, writer, value[i], fieldMask))
+                return false;
+
+        return writer->endArray(err);
+    }
+
+    static bool deserialize(IErrorHandler* err, JsonReader* reader, std::vector<T>& value_out, uint32_t fieldMask) {
+        if (!reader->beginArray(err))
+            return false;
+
+        value_out.clear();
+
+        for (;;) {
+            bool done;
+
+            if (!reader->nextElement(err, value_out.empty(), done))
+                return false;
+
+            if (done)
+                return true;
+
+            value_out.emplace_back();
+
+            if (!JsonSerializer<T>::deserialize(err, reader, value_out.back(), fieldMask))
+                return false;
+        }
+    }
+};
+#endif
+
+class JsonInstanceSerializer {
+public:
+    template <typename Fields>
+    static bool serializeInstance(IErrorHandler* err, JsonWriter* writer, const Fields& fields, uint32_t fieldMask) {
+        if (!writer->beginObject(err))
+            return false;
+
+        for (const auto& field : fields) {
+            if (!(field.systemFlags & fieldMask))
+                continue;
+
+            if (!writer->key(err, field.name)
+                    || !field.refl->toJson(err, writer, fieldMask, field.ptr()))
+                return false;
+        }
+
+        return writer->endObject(err);
+    }
+
+    // Members are bound to fields through the per-class name index. Unknown keys are skipped.
+    template <typename Fields>
+    static bool deserializeInstance(IErrorHandler* err, JsonReader* reader, Fields& fields, uint32_t fieldMask) {
+        if (!reader->beginObject(err))
+            return false;
+
+        for (bool first = true;; first = false) {
+            bool done;
+            const char* key = nullptr;
+            size_t keyLen = 0;
+
+            if (!reader->nextKey(err, first, done, key, keyLen))
+                return false;
+
+            if (done)
+                return true;
+
+            int i = fields.indexOf(key, keyLen);
+
+            if (i < 0 || !(fields[i].systemFlags & fieldMask)) {
+                if (!reader->skipValue(err))
+                    return false;
+
+                continue;
+            }
+
+            auto field = fields[i];
+
+            if (!field.refl->setFromJson(err, reader, fieldMask, field.ptr()))
+                return false;
+        }
+    }
+
+};
+}
+
+#endif
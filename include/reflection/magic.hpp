@@ -27,34 +27,52 @@
 #pragma once
 
 #include "base.hpp"
+#include "binary_program.hpp"
+#include "field_index.hpp"
 #include "generated_magic.hpp"
+#include "registry.hpp"
+#include "schema_blob.hpp"
+
+#include <type_traits>
+
+#ifndef REFLECTOR_AVOID_STL
+#include <string>
+#include <vector>
+#endif
+
+#if __cplusplus >= 201402L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201402L)
+#define REFL_CONSTEXPR constexpr
+#define REFL_VISITOR_RESULT(Visitor) decltype(auto)
+
+#ifndef REFLECTOR_AVOID_STL
+#include <tuple>
+#define REFLECTOR_HAVE_STATIC_FIELD_TUPLE
+#endif
+#else
+#define REFL_CONSTEXPR
+#define REFL_VISITOR_RESULT(Visitor) typename std::decay<Visitor>::type::result_type
+#endif
+
+// Each of these expands to a compile-time field descriptor (StaticField), which also converts to the runtime Field_t
 
 #define REFL_FIELD(field_, ...) \
-            ::reflection::makeField(#field_, &::reflection::fieldGetter<ThisClass, decltype(field_), &ThisClass::field_>,\
-            ::reflection::reflectionForType2<decltype(field_)>(),\
+            ::reflection::StaticField<ThisClass, decltype(field_), &ThisClass::field_>(#field_,\
             ::reflection::FIELD_STATE, ##__VA_ARGS__),\
 
 #define REFL_DEPENDENCY(field_, ...) \
-            ::reflection::makeDependency(#field_, &::reflection::fieldGetter<ThisClass, decltype(field_), &ThisClass::field_>,\
-            &::reflection::remove_all_pointers<decltype(field_)>::type::reflection_s_uuid(REFL_MATCH),\
+            ::reflection::StaticDependency<ThisClass, decltype(field_), &ThisClass::field_>(#field_,\
             ::reflection::FIELD_DEPENDENCY, ##__VA_ARGS__),\
 
 #define REFL_CONFIG(field_, ...) \
-            ::reflection::makeConfig(#field_, &::reflection::fieldGetter<ThisClass, decltype(field_), &ThisClass::field_>,\
-            ::reflection::reflectionForType2<decltype(field_)>(),\
+            ::reflection::StaticField<ThisClass, decltype(field_), &ThisClass::field_>(#field_,\
             ::reflection::FIELD_CONFIG, ##__VA_ARGS__),\
 
 #define REFL_MUST_CONFIG(field_, ...) \
-            ::reflection::makeConfig(#field_, &::reflection::fieldGetter<ThisClass, decltype(field_), &ThisClass::field_>,\
-            ::reflection::reflectionForType2<decltype(field_)>(),\
+            ::reflection::StaticField<ThisClass, decltype(field_), &ThisClass::field_>(#field_,\
             ::reflection::FIELD_CONFIG | ::reflection::FIELD_MANDATORY, ##__VA_ARGS__),\
 
 #define REFL_END \
-            ::reflection::makeField()\
-        };\
-\
-        static ::reflection::FieldSet_t const fieldSet = { thisClassName, fields, sizeof(fields) / sizeof(::reflection::Field_t) - 1, baseClassFields, derivedPtrToBasePtr };\
-        return &fieldSet;\
+            ::reflection::StaticFieldEnd());\
     }\
 
 #define REFL_CLASS_NAME(className_, version_)\
@@ -85,28 +103,114 @@ public:
     typedef typename remove_all_pointers<T>::type type;
 };
 
+template <typename T>
+struct VoidType {
+    typedef void type;
+};
+
+// true if the bytes of a T are exactly its value (no padding, one representation per value): non-floating-point
+// scalars, and from C++17 on anything std::has_unique_object_representations accepts
+template <typename T>
+struct HasUniqueBytes : std::integral_constant<bool, (std::is_scalar<T>::value && !std::is_floating_point<T>::value)
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+        || std::has_unique_object_representations<T>::value
+#endif
+        > {};
+
+template <typename T, typename Enable = void>
+struct TypeKind {
+    enum { value = KIND_OTHER };
+};
+
+template <>
+struct TypeKind<bool> {
+    enum { value = KIND_BOOL };
+};
+
+template <typename T>
+struct TypeKind<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type> {
+    enum { value = (std::is_signed<T>::value ? KIND_INT8 : KIND_UINT8)
+            + (sizeof(T) == 1 ? 0 : sizeof(T) == 2 ? 1 : sizeof(T) == 4 ? 2 : 3) };
+};
+
+template <typename T>
+struct TypeKind<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+    enum { value = sizeof(T) == sizeof(float) ? KIND_FLOAT : sizeof(T) == sizeof(double) ? KIND_DOUBLE : KIND_OTHER };
+};
+
+template <typename T>
+struct TypeKind<T, typename VoidType<decltype(&T::reflection_s_className)>::type> {
+    enum { value = KIND_CLASS };
+};
+
+#ifndef REFLECTOR_AVOID_STL
+template <>
+struct TypeKind<std::string> {
+    enum { value = KIND_STRING };
+};
+
+template <typename T>
+struct TypeKind<std::vector<T>> {
+    enum { value = KIND_VECTOR };
+};
+#endif
+
+template <typename T>
+struct ElementKind {
+    enum { value = KIND_OTHER };
+};
+
+#ifndef REFLECTOR_AVOID_STL
+template <typename T>
+struct ElementKind<std::vector<T>> {
+    enum { value = TypeKind<T>::value };
+};
+#endif
+
+typedef FieldSet_t const* (*FieldSetGetter_t)();
+
+template <typename T>
+FieldSetGetter_t classFieldsGetter(std::true_type isClass) {
+    return &fieldSetOfClass<T>;
+}
+
+template <typename T>
+FieldSetGetter_t classFieldsGetter(std::false_type isClass) {
+    return nullptr;
+}
+
 inline Field_t makeField() {
-    Field_t field = {nullptr, nullptr, 0, 0, nullptr};
+    Field_t field = {nullptr, nullptr, 0, 0, nullptr, KIND_OTHER, -1};
     return field;
 }
 
-inline Field_t makeField(const char* name, void* (*fieldGetter)(const void*),
+template <typename T>
+Field_t makeField(const char* name, void* (*fieldGetter)(const void*), ptrdiff_t offset,
         ITypeReflection* refl, uint32_t systemFlags, uint32_t flags = 0, const char* params = nullptr) {
-    Field_t field = {name, fieldGetter, systemFlags, flags, params};
+    Field_t field = {name, fieldGetter, systemFlags | (offset >= 0 ? FIELD_HAS_OFFSET : 0), flags, params,
+            TypeKind<typename std::remove_cv<T>::type>::value, offset};
+    field.classFields = classFieldsGetter<typename std::remove_cv<T>::type>(
+            std::integral_constant<bool, (int) TypeKind<typename std::remove_cv<T>::type>::value == (int) KIND_CLASS>());
+    field.elementKind = ElementKind<typename std::remove_cv<T>::type>::value;
     field.refl = refl;
     return field;
 }
 
-inline Field_t makeDependency(const char* name, void* (*fieldGetter)(const void*),
+inline Field_t makeDependency(const char* name, void* (*fieldGetter)(const void*), ptrdiff_t offset,
         const UUID_t* uuid, uint32_t systemFlags, uint32_t flags = 0, const char* params = nullptr) {
-    Field_t field = {name, fieldGetter, systemFlags, flags, params};
+    Field_t field = {name, fieldGetter, systemFlags | (offset >= 0 ? FIELD_HAS_OFFSET : 0), flags, params, KIND_OTHER, offset};
     field.uuid = uuid;
     return field;
 }
 
-inline Field_t makeConfig(const char* name, void* (*fieldGetter)(const void*),
+template <typename T>
+Field_t makeConfig(const char* name, void* (*fieldGetter)(const void*), ptrdiff_t offset,
         ITypeReflection* refl, uint32_t systemFlags, uint32_t flags = 0, const char* params = nullptr) {
-    Field_t field = {name, fieldGetter, systemFlags, flags, params};
+    Field_t field = {name, fieldGetter, systemFlags | (offset >= 0 ? FIELD_HAS_OFFSET : 0), flags, params,
+            TypeKind<typename std::remove_cv<T>::type>::value, offset};
+    field.classFields = classFieldsGetter<typename std::remove_cv<T>::type>(
+            std::integral_constant<bool, (int) TypeKind<typename std::remove_cv<T>::type>::value == (int) KIND_CLASS>());
+    field.elementKind = ElementKind<typename std::remove_cv<T>::type>::value;
     field.refl = refl;
     return field;
 }
@@ -116,8 +220,255 @@ static void* fieldGetter(const void* instance) {
     return (void*) &(reinterpret_cast<const C*>(instance)->*field);
 }
 
+// Byte offset of a member in a standard-layout class (the only case where offsetof is guaranteed to mean anything),
+// -1 otherwise. Measured against a dummy address, the same way offsetof is commonly implemented.
+template <class C, typename T, T C::*field>
+ptrdiff_t fieldOffset(std::true_type isStandardLayout) {
+    const C* probe = reinterpret_cast<const C*>((uintptr_t) alignof(C) * 64);
+    return reinterpret_cast<const char*>(&(probe->*field)) - reinterpret_cast<const char*>(probe);
+}
+
+template <class C, typename T, T C::*field>
+ptrdiff_t fieldOffset(std::false_type isStandardLayout) {
+    return -1;
+}
+
+template <class C, typename T, T C::*field>
+ptrdiff_t fieldOffset() {
+    return fieldOffset<C, T, field>(std::is_standard_layout<C>());
+}
+
+// a virtual base can't be reached by static_cast from the base side
+template <class Derived, class Base, typename = void>
+struct IsNonVirtualBase : std::false_type {};
+
+template <class Derived, class Base>
+struct IsNonVirtualBase<Derived, Base, decltype((void) static_cast<Derived*>(std::declval<Base*>()))> : std::true_type {};
+
+// base classes must be non-virtual: the adjustment is measured once per class and reused for every instance
 template <class Derived, class Base>
 static void* derivedPtrToBasePtr(void* derived) {
+    static_assert(IsNonVirtualBase<Derived, Base>::value, "reflected base classes can't be virtual (or ambiguous)");
+
     return (void*) static_cast<const Base*>(reinterpret_cast<Derived*>(derived));
 }
+
+// nullptr if the table couldn't be allocated (already reported)
+template <class C>
+FlatFieldTable_t const* flattenFields() {
+    // base offsets are measured against a suitably aligned dummy address; no object is ever accessed through it
+    static const FlatFieldTable_t table(C::template reflection_s_getFields<C>(REFL_MATCH),
+            reinterpret_cast<void*>((uintptr_t) alignof(C) * 64));
+    return table.available() ? &table : nullptr;
+}
+
+// Compile-time descriptor of a reflected member, as emitted by REFL_FIELD / REFL_CONFIG / REFL_MUST_CONFIG.
+// The member pointer is a template argument, so code visiting these (see forEachField) compiles down to plain member access.
+template <class C, typename T, T C::*member>
+struct StaticField {
+    typedef C Class;
+    typedef T Type;
+
+    const char* name;
+    uint32_t systemFlags;
+    uint32_t flags;
+    const char* params;
+
+    constexpr StaticField(const char* name, uint32_t systemFlags, uint32_t flags = 0, const char* params = nullptr)
+            : name(name), systemFlags(systemFlags), flags(flags), params(params) {}
+
+    static constexpr T C::* memberPointer() { return member; }
+
+    static T& get(C& inst) { return inst.*member; }
+    static const T& get(const C& inst) { return inst.*member; }
+
+    operator Field_t() const {
+        return makeField<T>(name, &fieldGetter<C, T, member>, fieldOffset<C, T, member>(), reflectionForType2<T>(),
+                systemFlags, flags, params);
+    }
+};
+
+// REFL_DEPENDENCY
+template <class C, typename T, T C::*member>
+struct StaticDependency : StaticField<C, T, member> {
+    constexpr StaticDependency(const char* name, uint32_t systemFlags, uint32_t flags = 0, const char* params = nullptr)
+            : StaticField<C, T, member>(name, systemFlags, flags, params) {}
+
+    operator Field_t() const {
+        return makeDependency(this->name, &fieldGetter<C, T, member>, fieldOffset<C, T, member>(),
+                &remove_all_pointers<T>::type::reflection_s_uuid(REFL_MATCH), this->systemFlags, this->flags, this->params);
+    }
+};
+
+// terminates the list (REFL_END)
+struct StaticFieldEnd {
+    operator Field_t() const { return makeField(); }
+};
+
+// Visitor used by reflection_s_getFields: turns the static field list into the runtime FieldSet_t (once per class)
+template <class C>
+class FieldSetBuilder {
+public:
+    typedef FieldSet_t const* result_type;
+
+    FieldSetBuilder(const char* className, FieldSet_t const* baseClassFields, void* (*derivedPtrToBasePtr)(void*))
+            : className(className), baseClassFields(baseClassFields), derivedPtrToBasePtr(derivedPtrToBasePtr) {}
+
+    template <typename... Fields>
+    FieldSet_t const* operator ()(const Fields&... staticFields) const {
+        (void) &TypeRegistrar<C>::registered;
+
+        static Field_t const fields[] = { staticFields... };
+        static FieldSet_t const fieldSet = { className, fields, sizeof...(Fields) - 1, baseClassFields, derivedPtrToBasePtr,
+                &flattenFields<C>, &fieldNameIndex<C>, &serialization::binaryProgramOf<C>,
+                &schemaBlobOf<C> };
+        return &fieldSet;
+    }
+
+private:
+    const char* className;
+    FieldSet_t const* baseClassFields;
+    void* (*derivedPtrToBasePtr)(void*);
+};
+
+template <class Inst, typename Func>
+class ForEachFieldVisitor {
+public:
+    typedef void result_type;
+
+    ForEachFieldVisitor(Inst& inst, Func& func) : inst(inst), func(func) {}
+
+    template <typename... Fields>
+    void operator ()(const Fields&... staticFields) const {
+        int expand[] = { (visit(staticFields), 0)... };
+        (void) expand;
+    }
+
+private:
+    template <class C, typename T, T C::*member>
+    void visit(const StaticField<C, T, member>& field) const { func(field, inst.*member); }
+
+    void visit(const StaticFieldEnd&) const {}
+
+    Inst& inst;
+    Func& func;
+};
+
+template <class C, typename Func>
+void forEachField(C& inst, Func&& func);
+
+template <class C, typename Func>
+void forEachFieldInBase(C& inst, Func& func, std::true_type baseIsVoid) {}
+
+template <class C, typename Func>
+void forEachFieldInBase(C& inst, Func& func, std::false_type baseIsVoid) {
+    typedef typename std::remove_const<C>::type::reflection_BaseClass Base;
+    typedef typename std::conditional<std::is_const<C>::value, const Base, Base>::type BaseRef;
+
+    forEachField(static_cast<BaseRef&>(inst), func);
+}
+
+// Calls func(field, value) for every reflected member of `inst` -- its own class first, then base classes, the same
+// order as reflectFields(). `field` is the StaticField descriptor (name, systemFlags, flags, params, memberPointer())
+// and `value` a reference to the member. Everything is resolved at compile time: no Field_t, no virtual calls.
+template <class C, typename Func>
+void forEachField(C& inst, Func&& func) {
+    typedef typename std::remove_const<C>::type Class;
+
+    Class::template reflection_s_staticFields<Class>(ForEachFieldVisitor<C, Func>(inst, func));
+    forEachFieldInBase(inst, func, std::is_void<typename Class::reflection_BaseClass>());
+}
+
+template <typename Func>
+class StaticFieldVisitor {
+public:
+    typedef void result_type;
+
+    explicit StaticFieldVisitor(Func& func) : func(func) {}
+
+    template <typename... Fields>
+    void operator ()(const Fields&... staticFields) const {
+        int expand[] = { (visit(staticFields), 0)... };
+        (void) expand;
+    }
+
+private:
+    template <class C, typename T, T C::*member>
+    void visit(const StaticField<C, T, member>& field) const { func(field); }
+
+    void visit(const StaticFieldEnd&) const {}
+
+    Func& func;
+};
+
+template <class C, typename Func>
+void forEachStaticField(Func&& func);
+
+template <class C, typename Func>
+void forEachStaticFieldInBase(Func& func, std::true_type baseIsVoid) {}
+
+template <class C, typename Func>
+void forEachStaticFieldInBase(Func& func, std::false_type baseIsVoid) {
+    forEachStaticField<typename C::reflection_BaseClass>(func);
+}
+
+// Like forEachField, but without an instance: calls func(field) for every StaticField of C and its base classes
+template <class C, typename Func>
+void forEachStaticField(Func&& func) {
+    C::template reflection_s_staticFields<C>(StaticFieldVisitor<Func>(func));
+    forEachStaticFieldInBase<C>(func, std::is_void<typename C::reflection_BaseClass>());
+}
+
+// finds a member pointer (including members of base classes) among the fields that are not dependencies
+template <class MemberOwner, typename MemberType>
+class DataFieldFinder {
+public:
+    explicit DataFieldFinder(MemberType MemberOwner::*memberPointer) : memberPointer(memberPointer), index(0), found(-1) {}
+
+    template <class Owner, typename T, T Owner::*member>
+    void operator ()(const StaticField<Owner, T, member>& field) {
+        if (field.systemFlags & FIELD_DEPENDENCY)
+            return;
+
+        if (found < 0 && matches(member, std::integral_constant<bool, std::is_same<Owner, MemberOwner>::value
+                && std::is_same<T, MemberType>::value>()))
+            found = (int) index;
+
+        index++;
+    }
+
+    MemberType MemberOwner::*memberPointer;
+    size_t index;
+    int found;
+
+private:
+    template <typename M>
+    bool matches(M member, std::true_type sameType) const { return member == memberPointer; }
+
+    template <typename M>
+    bool matches(M member, std::false_type sameType) const { return false; }
+};
+
+// position of a member among the non-dependency fields of C, in forEachStaticField order (-1 if not reflected)
+template <class C, class Owner, typename T>
+int dataFieldIndexOf(T Owner::*member) {
+    DataFieldFinder<Owner, T> finder(member);
+    forEachStaticField<C>(finder);
+    return finder.found;
+}
+
+#ifdef REFLECTOR_HAVE_STATIC_FIELD_TUPLE
+struct StaticFieldTupleVisitor {
+    template <typename... Fields>
+    constexpr auto operator ()(const Fields&... staticFields) const {
+        return std::make_tuple(staticFields...);
+    }
+};
+
+// The field descriptors of C as a constexpr std::tuple (C++14), ending with a StaticFieldEnd
+template <class C>
+constexpr auto staticFields() {
+    return C::template reflection_s_staticFields<C>(StaticFieldTupleVisitor());
+}
+#endif
 }
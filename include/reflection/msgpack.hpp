@@ -0,0 +1,870 @@
+/*
+    Boost Software License - Version 1.0 - August 17, 2003
+
+    Permission is hereby granted, free of charge, to any person or organization
+    obtaining a copy of the software and accompanying documentation covered by
+    this license (the "Software") to use, reproduce, display, distribute,
+    execute, and transmit the Software, and to prepare derivative works of the
+    Software, and to permit third-parties to whom the Software is furnished to
+    do so, all subject to the following:
+
+    The copyright notices in the Software and this entire statement, including
+    the above license grant, this restriction and the following disclaimer,
+    must be included in all copies of the Software, in whole or in part, and
+    all derivative works of the Software, unless such copies or derivative
+    works are solely in the form of machine-executable object code generated by
+    a source language processor.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+    SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+    FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef REFLECTOR_HAVE_MSGPACK
+#define REFLECTOR_HAVE_MSGPACK
+
+#include "base.hpp"
+#include "bufstring.hpp"
+#include "field_index.hpp"
+
+#include <limits>
+#include <type_traits>
+
+#ifndef REFLECTOR_AVOID_STL
+#include <string>
+#include <vector>
+#endif
+
+namespace serialization {
+
+// MessagePack (https://msgpack.org) encoder. Reflected classes become maps keyed by field name,
+// so the output can be consumed without .class_schema files.
+class MsgPackWriter {
+public:
+    MsgPackWriter() : buf(nullptr), length(0), capacity(0) {}
+    ~MsgPackWriter() { free(buf); }
+
+    MsgPackWriter(const MsgPackWriter& other) = delete;
+    MsgPackWriter& operator =(const MsgPackWriter& other) = delete;
+
+    bool writeNil(IErrorHandler* err) { return put1(err, 0xc0); }
+    bool writeBool(IErrorHandler* err, bool value) { return put1(err, value ? 0xc3 : 0xc2); }
+
+    bool writeInt(IErrorHandler* err, int64_t value) {
+        if (!reserve(err, 9))
+            return false;
+
+        encodeInt(value);
+        return true;
+    }
+
+    bool writeUInt(IErrorHandler* err, uint64_t value) {
+        if (!reserve(err, 9))
+            return false;
+
+        encodeUInt(value);
+        return true;
+    }
+
+    bool writeFloat(IErrorHandler* err, float value) {
+        if (!reserve(err, 5))
+            return false;
+
+        encodeFloat(value);
+        return true;
+    }
+
+    bool writeDouble(IErrorHandler* err, double value) {
+        if (!reserve(err, 9))
+            return false;
+
+        encodeDouble(value);
+        return true;
+    }
+
+    bool writeString(IErrorHandler* err, const char* str, size_t strLen) {
+        if (!reserve(err, 5 + strLen))
+            return false;
+
+        if (strLen < 32)
+            buf[length++] = (char)(0xa0 | strLen);
+        else if (strLen < 0x100)
+            putHeader8(0xd9, strLen);
+        else if (strLen < 0x10000)
+            putHeader16(0xda, strLen);
+        else
+            putHeader32(0xdb, strLen);
+
+        memcpy(buf + length, str, strLen);
+        length += strLen;
+        return true;
+    }
+
+    bool writeBinary(IErrorHandler* err, const void* data, size_t size) {
+        if (!reserve(err, 5 + size))
+            return false;
+
+        if (size < 0x100)
+            putHeader8(0xc4, size);
+        else if (size < 0x10000)
+            putHeader16(0xc5, size);
+        else
+            putHeader32(0xc6, size);
+
+        memcpy(buf + length, data, size);
+        length += size;
+        return true;
+    }
+
+    bool beginArray(IErrorHandler* err, size_t count) { return writeContainerHeader(err, 0x90, 0xdc, count); }
+    bool beginMap(IErrorHandler* err, size_t count) { return writeContainerHeader(err, 0x80, 0xde, count); }
+
+    // Bulk path for arrays of arithmetic values: one reservation for the whole array, then a tight encode loop
+    template <typename T>
+    bool writeArray(IErrorHandler* err, const T* values, size_t count) {
+        static_assert(std::is_arithmetic<T>::value, "writeArray expects arithmetic elements");
+
+        if (!beginArray(err, count) || !reserve(err, count * 9))
+            return false;
+
+        for (size_t i = 0; i < count; i++)
+            encode(values[i]);
+
+        return true;
+    }
+
+    const char* data() const { return buf; }
+    size_t size() const { return length; }
+    void clear() { length = 0; }
+
+private:
+    bool reserve(IErrorHandler* err, size_t count) {
+        if (length + count <= capacity)
+            return true;
+
+        size_t newCapacity = capacity * 2;
+
+        if (newCapacity < length + count)
+            newCapacity = length + count;
+
+        return reflection::ensureSize(err, buf, capacity, newCapacity);
+    }
+
+    bool put1(IErrorHandler* err, uint8_t byte) {
+        if (!reserve(err, 1))
+            return false;
+
+        buf[length++] = (char) byte;
+        return true;
+    }
+
+    void putBE(uint64_t value, int bytes) {
+        for (int i = bytes - 1; i >= 0; i--)
+            buf[length++] = (char)(value >> (i * 8));
+    }
+
+    void putHeader8(uint8_t type, size_t n) { buf[length++] = (char) type; putBE(n, 1); }
+    void putHeader16(uint8_t type, size_t n) { buf[length++] = (char) type; putBE(n, 2); }
+    void putHeader32(uint8_t type, size_t n) { buf[length++] = (char) type; putBE(n, 4); }
+
+    bool writeContainerHeader(IErrorHandler* err, uint8_t fixType, uint8_t type16, size_t count) {
+        if (!reserve(err, 5))
+            return false;
+
+        if (count < 16)
+            buf[length++] = (char)(fixType | count);
+        else if (count < 0x10000)
+            putHeader16(type16, count);
+        else
+            putHeader32(type16 + 1, count);
+
+        return true;
+    }
+
+    void encodeUInt(uint64_t value) {
+        if (value < 0x80)
+            buf[length++] = (char) value;
+        else if (value < 0x100)
+            putHeader8(0xcc, (size_t) value);
+        else if (value < 0x10000)
+            putHeader16(0xcd, (size_t) value);
+        else if (value < 0x100000000ull) {
+            buf[length++] = (char) 0xce;
+            putBE(value, 4);
+        }
+        else {
+            buf[length++] = (char) 0xcf;
+            putBE(value, 8);
+        }
+    }
+
+    void encodeInt(int64_t value) {
+        if (value >= 0)
+            encodeUInt((uint64_t) value);
+        else if (value >= -32)
+            buf[length++] = (char)(0xe0 | (value & 0x1f));
+        else if (value >= INT8_MIN) {
+            buf[length++] = (char) 0xd0;
+            putBE((uint64_t) value, 1);
+        }
+        else if (value >= INT16_MIN) {
+            buf[length++] = (char) 0xd1;
+            putBE((uint64_t) value, 2);
+        }
+        else if (value >= INT32_MIN) {
+            buf[length++] = (char) 0xd2;
+            putBE((uint64_t) value, 4);
+        }
+        else {
+            buf[length++] = (char) 0xd3;
+            putBE((uint64_t) value, 8);
+        }
+    }
+
+    void encodeFloat(float value) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        buf[length++] = (char) 0xca;
+        putBE(bits, 4);
+    }
+
+    void encodeDouble(double value) {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        buf[length++] = (char) 0xcb;
+        putBE(bits, 8);
+    }
+
+    template <typename T>
+    void encode(T value, typename std::enable_if<std::is_integral<T>::value>::type* = nullptr) {
+        if (std::numeric_limits<T>::is_signed)
+            encodeInt((int64_t) value);
+        else
+            encodeUInt((uint64_t) value);
+    }
+
+    void encode(bool value) { buf[length++] = (char)(value ? 0xc3 : 0xc2); }
+    void encode(float value) { encodeFloat(value); }
+    void encode(double value) { encodeDouble(value); }
+
+    char* buf;
+    size_t length;
+    size_t capacity;
+};
+
+// MessagePack decoder over a block of memory
+class MsgPackReader {
+public:
+    MsgPackReader(const void* data, size_t size)
+            : begin(reinterpret_cast<const uint8_t*>(data)), pos(begin), end(begin + size) {}
+
+    MsgPackReader(const MsgPackReader& other) = delete;
+    MsgPackReader& operator =(const MsgPackReader& other) = delete;
+
+    bool tryNil() {
+        if (pos < end && *pos == 0xc0) {
+            pos++;
+            return true;
+        }
+
+        return false;
+    }
+
+    bool readBool(IErrorHandler* err, bool& value_out) {
+        if (pos < end && (*pos == 0xc2 || *pos == 0xc3)) {
+            value_out = (*pos++ == 0xc3);
+            return true;
+        }
+
+        return typeError(err, "bool");
+    }
+
+    // any MessagePack integer encoding is accepted as long as the value fits Int_t
+    template <typename Int_t>
+    bool readInteger(IErrorHandler* err, Int_t& value_out) {
+        typedef std::numeric_limits<Int_t> Limits;
+
+        uint64_t magnitude;
+        bool negative;
+
+        if (!readAnyInteger(err, magnitude, negative))
+            return false;
+
+        if (!negative) {
+            if (magnitude > (uint64_t) Limits::max())
+                return rangeError(err);
+
+            value_out = (Int_t) magnitude;
+        }
+        else {
+            // `magnitude` holds the two's complement bits of a negative int64
+            int64_t value = (int64_t) magnitude;
+
+            if (!Limits::is_signed || value < (int64_t) Limits::min())
+                return rangeError(err);
+
+            value_out = (Int_t) value;
+        }
+
+        return true;
+    }
+
+    // floats of either width, integers, or nil (NaN)
+    template <typename Float_t>
+    bool readFloat(IErrorHandler* err, Float_t& value_out) {
+        if (pos == end)
+            return err->unexpectedEndOfInput(":msgpack"), false;
+
+        if (*pos == 0xca && end - pos >= 5) {
+            uint32_t bits = (uint32_t) getBE(pos + 1, 4);
+            float value;
+            memcpy(&value, &bits, sizeof(value));
+            value_out = (Float_t) value;
+            pos += 5;
+            return true;
+        }
+        else if (*pos == 0xcb && end - pos >= 9) {
+            uint64_t bits = getBE(pos + 1, 8);
+            double value;
+            memcpy(&value, &bits, sizeof(value));
+            value_out = (Float_t) value;
+            pos += 9;
+            return true;
+        }
+        else if (tryNil()) {
+            value_out = std::numeric_limits<Float_t>::quiet_NaN();
+            return true;
+        }
+
+        uint64_t magnitude;
+        bool negative;
+
+        if (!readAnyInteger(err, magnitude, negative))
+            return false;
+
+        value_out = negative ? (Float_t)(int64_t) magnitude : (Float_t) magnitude;
+        return true;
+    }
+
+    // str or bin; the span points into the input
+    bool readString(IErrorHandler* err, const char*& str_out, size_t& strLen_out) {
+        if (pos == end)
+            return err->unexpectedEndOfInput(":msgpack"), false;
+
+        uint8_t type = *pos;
+        size_t headerSize, strLen;
+
+        if ((type & 0xe0) == 0xa0) {
+            headerSize = 1;
+            strLen = type & 0x1f;
+        }
+        else if (type == 0xd9 || type == 0xc4)
+            headerSize = 2;
+        else if (type == 0xda || type == 0xc5)
+            headerSize = 3;
+        else if (type == 0xdb || type == 0xc6)
+            headerSize = 5;
+        else
+            return typeError(err, "string");
+
+        if ((size_t)(end - pos) < headerSize)
+            return err->unexpectedEndOfInput(":msgpack"), false;
+
+        if (headerSize > 1)
+            strLen = (size_t) getBE(pos + 1, (int) headerSize - 1);
+
+        if ((size_t)(end - pos) - headerSize < strLen)
+            return err->unexpectedEndOfInput(":msgpack"), false;
+
+        str_out = reinterpret_cast<const char*>(pos + headerSize);
+        strLen_out = strLen;
+        pos += headerSize + strLen;
+        return true;
+    }
+
+    bool readArrayHeader(IErrorHandler* err, size_t& count_out) {
+        return readContainerHeader(err, 0x90, 0xdc, count_out, "array");
+    }
+
+    bool readMapHeader(IErrorHandler* err, size_t& count_out) {
+        return readContainerHeader(err, 0x80, 0xde, count_out, "map");
+    }
+
+    bool nextIsArray() const { return pos < end && ((*pos & 0xf0) == 0x90 || *pos == 0xdc || *pos == 0xdd); }
+
+    // every element takes at least one byte; lets callers reject absurd counts before allocating
+    size_t remaining() const { return end - pos; }
+
+    // Skips one complete value, however deeply nested (iteratively)
+    bool skipValue(IErrorHandler* err) {
+        uint64_t pending = 1;
+
+        while (pending > 0) {
+            pending--;
+
+            if (pos == end)
+                return err->unexpectedEndOfInput(":msgpack"), false;
+
+            uint8_t type = *pos;
+            size_t count;
+
+            if (type <= 0x7f || type >= 0xe0 || type == 0xc0 || type == 0xc2 || type == 0xc3) {
+                pos++;
+                continue;
+            }
+
+            if ((type & 0xf0) == 0x90 || type == 0xdc || type == 0xdd) {
+                if (!readArrayHeader(err, count))
+                    return false;
+
+                pending += count;
+                continue;
+            }
+
+            if ((type & 0xf0) == 0x80 || type == 0xde || type == 0xdf) {
+                if (!readMapHeader(err, count))
+                    return false;
+
+                pending += 2 * (uint64_t) count;
+                continue;
+            }
+
+            const char* str;
+            size_t strLen;
+
+            switch (type) {
+                case 0xcc: case 0xd0: count = 2; break;
+                case 0xcd: case 0xd1: count = 3; break;
+                case 0xca: case 0xce: case 0xd2: count = 5; break;
+                case 0xcb: case 0xcf: case 0xd3: count = 9; break;
+                case 0xd4: count = 3; break;        // fixext 1..16
+                case 0xd5: count = 4; break;
+                case 0xd6: count = 6; break;
+                case 0xd7: count = 10; break;
+                case 0xd8: count = 18; break;
+
+                case 0xc7: case 0xc8: case 0xc9: {  // ext 8/16/32
+                    int lenSize = 1 << (type - 0xc7);
+
+                    if (end - pos < 2 + lenSize)
+                        return err->unexpectedEndOfInput(":msgpack"), false;
+
+                    count = 2 + lenSize + (size_t) getBE(pos + 1, lenSize);
+                    break;
+                }
+
+                default:
+                    if (!readString(err, str, strLen))
+                        return false;
+
+                    continue;
+            }
+
+            if ((size_t)(end - pos) < count)
+                return err->unexpectedEndOfInput(":msgpack"), false;
+
+            pos += count;
+        }
+
+        return true;
+    }
+
+    bool atEnd() const { return pos == end; }
+    size_t offset() const { return pos - begin; }
+
+private:
+    static uint64_t getBE(const uint8_t* p, int bytes) {
+        uint64_t value = 0;
+
+        for (int i = 0; i < bytes; i++)
+            value = (value << 8) | p[i];
+
+        return value;
+    }
+
+    bool typeError(IErrorHandler* err, const char* expected) {
+        if (pos == end)
+            return err->unexpectedEndOfInput(":msgpack"), false;
+
+        return err->errorf("IncorrectType", "Expected %s at offset %u, found type byte 0x%02X.", expected,
+                (unsigned int)(pos - begin), *pos), false;
+    }
+
+    bool rangeError(IErrorHandler* err) {
+        return err->errorf("IntegerOverflow", "Value before offset %u is outside the limit for this type.",
+                (unsigned int)(pos - begin)), false;
+    }
+
+    // negative values are returned as the two's complement bits of an int64
+    bool readAnyInteger(IErrorHandler* err, uint64_t& value_out, bool& negative_out) {
+        if (pos == end)
+            return err->unexpectedEndOfInput(":msgpack"), false;
+
+        uint8_t type = *pos;
+
+        if (type <= 0x7f) {
+            value_out = type;
+            negative_out = false;
+            pos++;
+            return true;
+        }
+        else if (type >= 0xe0) {
+            value_out = (uint64_t)(int64_t)(int8_t) type;
+            negative_out = true;
+            pos++;
+            return true;
+        }
+
+        int bytes;
+        bool isSigned;
+
+        switch (type) {
+            case 0xcc: bytes = 1; isSigned = false; break;
+            case 0xcd: bytes = 2; isSigned = false; break;
+            case 0xce: bytes = 4; isSigned = false; break;
+            case 0xcf: bytes = 8; isSigned = false; break;
+            case 0xd0: bytes = 1; isSigned = true; break;
+            case 0xd1: bytes = 2; isSigned = true; break;
+            case 0xd2: bytes = 4; isSigned = true; break;
+            case 0xd3: bytes = 8; isSigned = true; break;
+            default: return typeError(err, "integer");
+        }
+
+        if (end - pos < 1 + bytes)
+            return err->unexpectedEndOfInput(":msgpack"), false;
+
+        uint64_t raw = getBE(pos + 1, bytes);
+        pos += 1 + bytes;
+
+        if (isSigned && bytes < 8 && (raw >> (bytes * 8 - 1)))
+            raw |= ~(uint64_t) 0 << (bytes * 8);     // sign-extend
+
+        value_out = raw;
+        negative_out = isSigned && (int64_t) raw < 0;
+        return true;
+    }
+
+    bool readContainerHeader(IErrorHandler* err, uint8_t fixType, uint8_t type16, size_t& count_out, const char* what) {
+        if (pos == end)
+            return err->unexpectedEndOfInput(":msgpack"), false;
+
+        uint8_t type = *pos;
+
+        if ((type & 0xf0) == fixType) {
+            count_out = type & 0x0f;
+            pos++;
+        }
+        else if (type == type16 || type == type16 + 1) {
+            int bytes = (type == type16) ? 2 : 4;
+
+            if (end - pos < 1 + bytes)
+                return err->unexpectedEndOfInput(":msgpack"), false;
+
+            count_out = (size_t) getBE(pos + 1, bytes);
+            pos += 1 + bytes;
+        }
+        else
+            return typeError(err, what);
+
+        return true;
+    }
+
+    const uint8_t* begin;
+    const uint8_t* pos;
+    const uint8_t* end;
+};
+
+// Fallback for types without a dedicated specialization (mostly reflected classes): dispatch through their reflection
+template <typename T>
+class MsgPackSerializer {
+public:
+    static bool serialize(IErrorHandler* err, MsgPackWriter* writer, const T& value, uint32_t fieldMask) {
+        return reflection::reflectionForType2<T>()->toMsgPack(err, writer, fieldMask, reinterpret_cast<const void*>(&value));
+    }
+
+    static bool deserialize(IErrorHandler* err, MsgPackReader* reader, T& value_out, uint32_t fieldMask) {
+        return reflection::reflectionForType2<T>()->setFromMsgPack(err, reader, fieldMask, reinterpret_cast<void*>(&value_out));
+    }
+};
+
+template <>
+class MsgPackSerializer<bool> {
+public:
+    static bool serialize(IErrorHandler* err, MsgPackWriter* writer, const bool& value, uint32_t) {
+        return writer->writeBool(err, value);
+    }
+
+    static bool deserialize(IErrorHandler* err, MsgPackReader* reader, bool& value_out, uint32_t) {
+        return reader->readBool(err, value_out);
+    }
+};
+
+template <typename T>
+class MsgPackIntSerializer {
+public:
+    static bool serialize(IErrorHandler* err, MsgPackWriter* writer, const T& value, uint32_t) {
+        if (std::numeric_limits<T>::is_signed)
+            return writer->writeInt(err, (int64_t) value);
+        else
+            return writer->writeUInt(err, (uint64_t) value);
+    }
+
+    static bool deserialize(IErrorHandler* err, MsgPackReader* reader, T& value_out, uint32_t) {
+        return reader->readInteger(err, value_out);
+    }
+};
+
+template <typename T>
+class MsgPackFloatSerializer {
+public:
+    static bool serialize(IErrorHandler* err, MsgPackWriter* writer, const T& value, uint32_t) {
+        if (sizeof(T) == sizeof(float))
+            return writer->writeFloat(err, (float) value);
+        else
+            return writer->writeDouble(err, (double) value);
+    }
+
+    static bool deserialize(IErrorHandler* err, MsgPackReader* reader, T& value_out, uint32_t) {
+        return reader->readFloat(err, value_out);
+    }
+};
+
+template <> class MsgPackSerializer<char> :                 public MsgPackIntSerializer<char> {};
+template <> class MsgPackSerializer<unsigned char> :        public MsgPackIntSerializer<unsigned char> {};
+template <> class MsgPackSerializer<short> :                public MsgPackIntSerializer<short> {};
+template <> class MsgPackSerializer<int> :                  public MsgPackIntSerializer<int> {};
+template <> class MsgPackSerializer<long> :                 public MsgPackIntSerializer<long> {};
+template <> class MsgPackSerializer<long long> :            public MsgPackIntSerializer<long long> {};
+template <> class MsgPackSerializer<unsigned short> :       public MsgPackIntSerializer<unsigned short> {};
+template <> class MsgPackSerializer<unsigned int> :         public MsgPackIntSerializer<unsigned int> {};
+template <> class MsgPackSerializer<unsigned long> :        public MsgPackIntSerializer<unsigned long> {};
+template <> class MsgPackSerializer<unsigned long long> :   public MsgPackIntSerializer<unsigned long long> {};
+
+template <> class MsgPackSerializer<float> :                public MsgPackFloatSerializer<float> {};
+template <> class MsgPackSerializer<double> :               public MsgPackFloatSerializer<double> {};
+
+#ifndef REFLECTOR_AVOID_STL
+template <>
+class MsgPackSerializer<std::string> {
+public:
+    static bool serialize(IErrorHandler* err, MsgPackWriter* writer, const std::string& value, uint32_t) {
+        return writer->writeString(err, value.c_str(), value.length());
+    }
+
+    static bool deserialize(IErrorHandler* err, MsgPackReader* reader, std::string& value_out, uint32_t) {
+        const char* str;
+        size_t strLen;
+
+        if (!reader->readString(err, str, strLen))
+            return false;
+
+        value_out.assign(str, strLen);
+        return true;
+    }
+};
+
+template <typename T>
+class MsgPackSerializer<std::vector<T>> {
+public:
+    static bool serialize(IErrorHandler* err, MsgPackWriter* writer, const std::vector<T>& value, uint32_t fieldMask) {
+        return serialize(err, writer, value, fieldMask, std::is_arithmetic<T>());
+    }
+
+    static bool deserialize(IErrorHandler* err, MsgPackReader* reader, std::vector<T>& value_out, uint32_t fieldMask) {
+        size_t count;
+
+        if (!reader->readArrayHeader(err, count))
+            return false;
+
+        if (count > reader->remaining())
+            return err->unexpectedEndOfInput(":msgpack"), false;
+
+        value_out.resize(count);
+
+        for (size_t i = 0; i < count; i++)
+            if (!MsgPackSerializer<T>::deserialize(err, reader, value_out[i], fieldMask))
+                return false;
+
+        return true;
+    }
+
+private:
+    static bool serialize(IErrorHandler* err, MsgPackWriter* writer, const std::vector<T>& value, uint32_t,
+            std::true_type) {
+        return writer->writeArray(err, value.data(), value.size());
+    }
+
+    static bool serialize(IErrorHandler* err, MsgPackWriter* writer, const std::vector<T>& value, uint32_t fieldMask,
+            std::false_type) {
+        if (!writer->beginArray(err, value.size()))
+            return false;
+
+        for (size_t i = 0; i < value.size(); i++)
+            if (!MsgPackSerializer<T>::serialize(err, writer, value[i], fieldMask))
+                return false;
+
+        return true;
+    }
+};
+
+// byte vectors travel as a single bin blob; arrays of small integers are accepted as well
+template <>
+class MsgPackSerializer<std::vector<unsigned char>> {
+public:
+    static bool serialize(IErrorHandler* err, MsgPackWriter* writer, const std::vector<unsigned char>& value, uint32_t) {
+        return writer->writeBinary(err, value.data(), value.size());
+    }
+
+    static bool deserialize(IErrorHandler* err, MsgPackReader* reader, std::vector<unsigned char>& value_out, uint32_t) {
+        const char* data;
+        size_t size;
+        size_t count;
+
+        if (!reader->nextIsArray()) {
+            if (!reader->readString(err, data, size))
+                return false;
+
+            value_out.assign(data, data + size);
+            return true;
+        }
+
+        if (!reader->readArrayHeader(err, count))
+            return false;
+
+        if (count > reader->remaining())
+            return err->unexpectedEndOfInput(":msgpack"), false;
+
+        value_out.resize(count);
+
+        for (size_t i = 0; i < count; i++)
+            if (!reader->readInteger(err, value_out[i]))
+                return false;
+
+        return true;
+    }
+};
+#endif
+
+// Reflected class <-> map of field name -> value. Scalar and string fields are encoded inline based on Field_t::kind;
+// only nested classes, vectors and other types dispatch through ITypeReflection.
+class MsgPackInstanceSerializer {
+public:
+    template <typename Fields>
+    static bool serializeInstance(IErrorHandler* err, MsgPackWriter* writer, const Fields& fields, uint32_t fieldMask) {
+        size_t count = 0;
+
+        for (const auto& field : fields)
+            if (field.systemFlags & fieldMask)
+                count++;
+
+        if (!writer->beginMap(err, count))
+            return false;
+
+        for (const auto& field : fields) {
+            if (!(field.systemFlags & fieldMask))
+                continue;
+
+            if (!writer->writeString(err, field.name, strlen(field.name))
+                    || !serializeField(err, writer, field, field.ptr(), fieldMask))
+                return false;
+        }
+
+        return true;
+    }
+
+    template <typename Fields>
+    static bool deserializeInstance(IErrorHandler* err, MsgPackReader* reader, Fields& fields, uint32_t fieldMask) {
+        size_t count;
+
+        if (!reader->readMapHeader(err, count))
+            return false;
+
+        for (size_t n = 0; n < count; n++) {
+            const char* key;
+            size_t keyLen;
+
+            if (!reader->readString(err, key, keyLen))
+                return false;
+
+            int i = fields.indexOf(key, keyLen);
+
+            if (i < 0 || !(fields[i].systemFlags & fieldMask)) {
+                if (!reader->skipValue(err))
+                    return false;
+
+                continue;
+            }
+
+            auto field = fields[i];
+
+            if (!deserializeField(err, reader, field, field.ptr(), fieldMask))
+                return false;
+        }
+
+        return true;
+    }
+
+private:
+    static bool serializeField(IErrorHandler* err, MsgPackWriter* writer, const reflection::Field_t& field,
+            const void* p, uint32_t fieldMask) {
+        switch (field.kind) {
+            case reflection::KIND_BOOL:     return writer->writeBool(err, *reinterpret_cast<const bool*>(p));
+            case reflection::KIND_INT8:     return writer->writeInt(err, *reinterpret_cast<const int8_t*>(p));
+            case reflection::KIND_INT16:    return writer->writeInt(err, *reinterpret_cast<const int16_t*>(p));
+            case reflection::KIND_INT32:    return writer->writeInt(err, *reinterpret_cast<const int32_t*>(p));
+            case reflection::KIND_INT64:    return writer->writeInt(err, *reinterpret_cast<const int64_t*>(p));
+            case reflection::KIND_UINT8:    return writer->writeUInt(err, *reinterpret_cast<const uint8_t*>(p));
+            case reflection::KIND_UINT16:   return writer->writeUInt(err, *reinterpret_cast<const uint16_t*>(p));
+            case reflection::KIND_UINT32:   return writer->writeUInt(err, *reinterpret_cast<const uint32_t*>(p));
+            case reflection::KIND_UINT64:   return writer->writeUInt(err, *reinterpret_cast<const uint64_t*>(p));
+            case reflection::KIND_FLOAT:    return writer->writeFloat(err, *reinterpret_cast<const float*>(p));
+            case reflection::KIND_DOUBLE:   return writer->writeDouble(err, *reinterpret_cast<const double*>(p));
+#ifndef REFLECTOR_AVOID_STL
+            case reflection::KIND_STRING: {
+                const std::string& str = *reinterpret_cast<const std::string*>(p);
+                return writer->writeString(err, str.c_str(), str.length());
+            }
+#endif
+            default:
+                return field.refl->toMsgPack(err, writer, fieldMask, p);
+        }
+    }
+
+    static bool deserializeField(IErrorHandler* err, MsgPackReader* reader, const reflection::Field_t& field,
+            void* p, uint32_t fieldMask) {
+        switch (field.kind) {
+            case reflection::KIND_BOOL:     return reader->readBool(err, *reinterpret_cast<bool*>(p));
+            case reflection::KIND_INT8:     return reader->readInteger(err, *reinterpret_cast<int8_t*>(p));
+            case reflection::KIND_INT16:    return reader->readInteger(err, *reinterpret_cast<int16_t*>(p));
+            case reflection::KIND_INT32:    return reader->readInteger(err, *reinterpret_cast<int32_t*>(p));
+            case reflection::KIND_INT64:    return reader->readInteger(err, *reinterpret_cast<int64_t*>(p));
+            case reflection::KIND_UINT8:    return reader->readInteger(err, *reinterpret_cast<uint8_t*>(p));
+            case reflection::KIND_UINT16:   return reader->readInteger(err, *reinterpret_cast<uint16_t*>(p));
+            case reflection::KIND_UINT32:   return reader->readInteger(err, *reinterpret_cast<uint32_t*>(p));
+            case reflection::KIND_UINT64:   return reader->readInteger(err, *reinterpret_cast<uint64_t*>(p));
+            case reflection::KIND_FLOAT:    return reader->readFloat(err, *reinterpret_cast<float*>(p));
+            case reflection::KIND_DOUBLE:   return reader->readFloat(err, *reinterpret_cast<double*>(p));
+#ifndef REFLECTOR_AVOID_STL
+            case reflection::KIND_STRING: {
+                const char* str;
+                size_t strLen;
+
+                if (!reader->readString(err, str, strLen))
+                    return false;
+
+                reinterpret_cast<std::string*>(p)->assign(str, strLen);
+                return true;
+            }
+#endif
+            default:
+                return field.refl->setFromMsgPack(err, reader, fieldMask, p);
+        }
+    }
+};
+}
+
+#endif
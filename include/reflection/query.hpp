@@ -0,0 +1,381 @@
+/*
+    Boost Software License - Version 1.0 - August 17, 2003
+
+    Permission is hereby granted, free of charge, to any person or organization
+    obtaining a copy of the software and accompanying documentation covered by
+    this license (the "Software") to use, reproduce, display, distribute,
+    execute, and transmit the Software, and to prepare derivative works of the
+    Software, and to permit third-parties to whom the Software is furnished to
+    do so, all subject to the following:
+
+    The copyright notices in the Software and this entire statement, including
+    the above license grant, this restriction and the following disclaimer,
+    must be included in all copies of the Software, in whole or in part, and
+    all derivative works of the Software, unless such copies or derivative
+    works are solely in the form of machine-executable object code generated by
+    a source language processor.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+    SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+    FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "base.hpp"
+#include "field_index.hpp"
+#include "magic.hpp"
+#include "soa_vector.hpp"
+
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+#ifndef REFLECTOR_AVOID_STL
+#include <string>
+#include <vector>
+
+namespace reflection {  // UUID('c3549467-1615-4087-9829-176a2dc44b76')
+
+enum {
+    QUERY_EQ,
+    QUERY_NE,
+    QUERY_LT,
+    QUERY_LE,
+    QUERY_GT,
+    QUERY_GE,
+};
+
+// One field across all rows of a collection: the value of row i is at base + i * stride
+struct ColumnView_t {
+    const char* className;
+    const char* name;
+    uint32_t kind;                  // KIND_*
+    const char* base;
+    size_t stride;
+    size_t count;
+};
+
+// result of Query::aggregate; min and max are NaN when no row is selected
+struct QueryAggregate_t {
+    size_t count;
+    double sum;
+    double min;
+    double max;
+};
+
+// rows of a std::vector<C>: the field sits at the same offset in every element
+template <class C>
+bool columnView(IErrorHandler* err, const std::vector<C>& rows, const char* name, ColumnView_t* view_out) {
+    FieldSet_t const* fieldSet = fieldSetOfClass<C>();
+    FlatField_t const* entry = findField(fieldSet, name);
+
+    if (entry == nullptr || (entry->field->systemFlags & FIELD_DEPENDENCY))
+        return err->errorf("FieldNotFound", "Class `%s` has no field `%s`.", fieldSet->className, name), false;
+
+    ptrdiff_t offset = entry->offset;
+
+    if (!(entry->field->systemFlags & FIELD_HAS_OFFSET) && !rows.empty()) {
+        const char* row = reinterpret_cast<const char*>(&rows[0]);
+        offset = reinterpret_cast<const char*>(entry->field->fieldGetter(row + entry->baseOffset)) - row;
+    }
+
+    const char* base = rows.empty() ? nullptr : reinterpret_cast<const char*>(rows.data()) + offset;
+    *view_out = ColumnView_t { fieldSet->className, entry->field->name, entry->field->kind, base, sizeof(C), rows.size() };
+    return true;
+}
+
+// rows of a SoAVector<C>: the column itself, contiguous
+template <class C>
+bool columnView(IErrorHandler* err, const SoAVector<C>& rows, const char* name, ColumnView_t* view_out) {
+    for (size_t i = 0; i < rows.numColumns(); i++) {
+        const SoAColumnOps_t& column = rows.columnInfo(i);
+
+        if (strcmp(column.name, name) == 0) {
+            *view_out = ColumnView_t { fieldSetOfClass<C>()->className, column.name, column.kind,
+                    reinterpret_cast<const char*>(rows.columnData(i)), column.size, rows.size() };
+            return true;
+        }
+    }
+
+    return err->errorf("FieldNotFound", "Class `%s` has no field `%s`.", fieldSetOfClass<C>()->className, name), false;
+}
+
+struct QueryEq { template <typename T> static bool apply(const T& a, const T& b) { return a == b; } };
+struct QueryNe { template <typename T> static bool apply(const T& a, const T& b) { return a != b; } };
+struct QueryLt { template <typename T> static bool apply(const T& a, const T& b) { return a < b; } };
+struct QueryLe { template <typename T> static bool apply(const T& a, const T& b) { return a <= b; } };
+struct QueryGt { template <typename T> static bool apply(const T& a, const T& b) { return a > b; } };
+struct QueryGe { template <typename T> static bool apply(const T& a, const T& b) { return a >= b; } };
+
+// The kernels below are plain branchless loops; over a contiguous column (SoAVector, or stride == sizeof(T))
+// the compiler turns them into SIMD code, strided rows of a std::vector<C> are read one by one.
+template <typename T, bool contiguous>
+T columnValue(const ColumnView_t& view, size_t index) {
+    if (contiguous)
+        return reinterpret_cast<const T*>(view.base)[index];
+
+    T value;
+    memcpy(&value, view.base + index * view.stride, sizeof(T));
+    return value;
+}
+
+template <class Op, typename T, typename V, bool contiguous>
+void filterKernel(const ColumnView_t& view, V value, uint8_t* selected) {
+    for (size_t i = 0; i < view.count; i++)
+        selected[i] &= (uint8_t) Op::apply((V) columnValue<T, contiguous>(view, i), value);
+}
+
+template <typename T, typename V, bool contiguous>
+void filterColumn(const ColumnView_t& view, int op, V value, uint8_t* selected) {
+    switch (op) {
+        case QUERY_EQ: filterKernel<QueryEq, T, V, contiguous>(view, value, selected); break;
+        case QUERY_NE: filterKernel<QueryNe, T, V, contiguous>(view, value, selected); break;
+        case QUERY_LT: filterKernel<QueryLt, T, V, contiguous>(view, value, selected); break;
+        case QUERY_LE: filterKernel<QueryLe, T, V, contiguous>(view, value, selected); break;
+        case QUERY_GT: filterKernel<QueryGt, T, V, contiguous>(view, value, selected); break;
+        case QUERY_GE: filterKernel<QueryGe, T, V, contiguous>(view, value, selected); break;
+    }
+}
+
+// compares the field, converted to V, against `value`
+template <typename T, typename V>
+void filterColumn(const ColumnView_t& view, int op, V value, uint8_t* selected) {
+    if (view.stride == sizeof(T))
+        filterColumn<T, V, true>(view, op, value, selected);
+    else
+        filterColumn<T, V, false>(view, op, value, selected);
+}
+
+// Integer fields are compared in int64_t (uint64_t for uint64 fields) against an integer constant, and in double
+// against a floating point one. Floating point fields are always compared in double, so that an integer constant
+// never truncates them.
+template <typename V>
+bool filterNumeric(const ColumnView_t& view, int op, V value, uint8_t* selected) {
+    switch (view.kind) {
+        case KIND_BOOL:     filterColumn<bool, V>(view, op, value, selected); return true;
+        case KIND_INT8:     filterColumn<int8_t, V>(view, op, value, selected); return true;
+        case KIND_INT16:    filterColumn<int16_t, V>(view, op, value, selected); return true;
+        case KIND_INT32:    filterColumn<int32_t, V>(view, op, value, selected); return true;
+        case KIND_INT64:    filterColumn<int64_t, V>(view, op, value, selected); return true;
+        case KIND_UINT8:    filterColumn<uint8_t, V>(view, op, value, selected); return true;
+        case KIND_UINT16:   filterColumn<uint16_t, V>(view, op, value, selected); return true;
+        case KIND_UINT32:   filterColumn<uint32_t, V>(view, op, value, selected); return true;
+        case KIND_FLOAT:    filterColumn<float, double>(view, op, (double) value, selected); return true;
+        case KIND_DOUBLE:   filterColumn<double, double>(view, op, (double) value, selected); return true;
+
+        case KIND_UINT64:
+            if (std::is_integral<V>::value && value < 0) {
+                // below every value of the field
+                if (op == QUERY_EQ || op == QUERY_LT || op == QUERY_LE)
+                    memset(selected, 0, view.count);
+            }
+            else if (std::is_integral<V>::value)
+                filterColumn<uint64_t, uint64_t>(view, op, (uint64_t) value, selected);
+            else
+                filterColumn<uint64_t, V>(view, op, value, selected);
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+// strings take the scalar path, and are only looked at for rows still selected
+template <class Op>
+void filterStrings(const ColumnView_t& view, const char* value, size_t valueLen, uint8_t* selected) {
+    for (size_t i = 0; i < view.count; i++) {
+        if (selected[i]) {
+            const std::string& str = *reinterpret_cast<const std::string*>(view.base + i * view.stride);
+            selected[i] = (uint8_t) Op::apply(str.compare(0, std::string::npos, value, valueLen), 0);
+        }
+    }
+}
+
+template <typename T, bool contiguous>
+void aggregateKernel(const ColumnView_t& view, const uint8_t* selected, QueryAggregate_t* aggregate_out) {
+    typedef typename std::conditional<std::is_floating_point<T>::value, double,
+            typename std::conditional<std::is_signed<T>::value, int64_t, uint64_t>::type>::type Sum;
+
+    size_t count = 0;
+    Sum sum = 0;
+    T min = std::numeric_limits<T>::max();
+    T max = std::numeric_limits<T>::lowest();
+
+    for (size_t i = 0; i < view.count; i++) {
+        T value = columnValue<T, contiguous>(view, i);
+        bool isSelected = (selected[i] != 0);
+
+        count += isSelected;
+        sum += isSelected ? (Sum) value : (Sum) 0;
+        min = (isSelected && value < min) ? value : min;
+        max = (isSelected && max < value) ? value : max;
+    }
+
+    aggregate_out->count = count;
+    aggregate_out->sum = (double) sum;
+    aggregate_out->min = count ? (double) min : std::numeric_limits<double>::quiet_NaN();
+    aggregate_out->max = count ? (double) max : std::numeric_limits<double>::quiet_NaN();
+}
+
+template <typename T>
+void aggregateColumn(const ColumnView_t& view, const uint8_t* selected, QueryAggregate_t* aggregate_out) {
+    if (view.stride == sizeof(T))
+        aggregateKernel<T, true>(view, selected, aggregate_out);
+    else
+        aggregateKernel<T, false>(view, selected, aggregate_out);
+}
+
+// Filters, projections and aggregates over a std::vector<C> or SoAVector<C>, with fields named at run time.
+// Each where() narrows the selection (conditions are ANDed); the rest read the rows currently selected:
+//
+//     Query<std::vector<Sample>> query(samples);
+//
+//     if (!query.where(err, "count", QUERY_GT, 100) || !query.where(err, "name", QUERY_NE, "")
+//             || !query.aggregate(err, "value", &stats))
+//         ...
+template <class Collection>
+class Query {
+public:
+    typedef typename Collection::value_type Class;
+
+    explicit Query(const Collection& rows) : rows(rows), selected(rows.size(), 1) {}
+
+    // numeric fields (bool included) against a numeric constant
+    template <typename V>
+    bool where(IErrorHandler* err, const char* field, int op, V value) {
+        static_assert(std::is_arithmetic<V>::value, "Query::where: the constant must be a number or a string");
+
+        ColumnView_t view;
+
+        if (!columnView(err, rows, field, &view))
+            return false;
+
+        typedef typename std::conditional<std::is_integral<V>::value, int64_t, double>::type Constant;
+
+        if (!filterNumeric<Constant>(view, op, (Constant) value, selected.data()))
+            return err->errorf("IncorrectType", "Field `%s::%s` is not numeric.", view.className, view.name), false;
+
+        return true;
+    }
+
+    // std::string fields against a string constant, compared bytewise
+    bool where(IErrorHandler* err, const char* field, int op, const char* value) {
+        return whereString(err, field, op, value, strlen(value));
+    }
+
+    bool where(IErrorHandler* err, const char* field, int op, const std::string& value) {
+        return whereString(err, field, op, value.c_str(), value.size());
+    }
+
+    void reset() { selected.assign(rows.size(), 1); }
+
+    size_t count() const {
+        size_t count = 0;
+
+        for (size_t i = 0; i < selected.size(); i++)
+            count += selected[i];
+
+        return count;
+    }
+
+    // count, sum, min and max of a numeric field over the selected rows
+    bool aggregate(IErrorHandler* err, const char* field, QueryAggregate_t* aggregate_out) const {
+        ColumnView_t view;
+
+        if (!columnView(err, rows, field, &view))
+            return false;
+
+        switch (view.kind) {
+            case KIND_BOOL:     aggregateColumn<bool>(view, selected.data(), aggregate_out); return true;
+            case KIND_INT8:     aggregateColumn<int8_t>(view, selected.data(), aggregate_out); return true;
+            case KIND_INT16:    aggregateColumn<int16_t>(view, selected.data(), aggregate_out); return true;
+            case KIND_INT32:    aggregateColumn<int32_t>(view, selected.data(), aggregate_out); return true;
+            case KIND_INT64:    aggregateColumn<int64_t>(view, selected.data(), aggregate_out); return true;
+            case KIND_UINT8:    aggregateColumn<uint8_t>(view, selected.data(), aggregate_out); return true;
+            case KIND_UINT16:   aggregateColumn<uint16_t>(view, selected.data(), aggregate_out); return true;
+            case KIND_UINT32:   aggregateColumn<uint32_t>(view, selected.data(), aggregate_out); return true;
+            case KIND_UINT64:   aggregateColumn<uint64_t>(view, selected.data(), aggregate_out); return true;
+            case KIND_FLOAT:    aggregateColumn<float>(view, selected.data(), aggregate_out); return true;
+            case KIND_DOUBLE:   aggregateColumn<double>(view, selected.data(), aggregate_out); return true;
+            default:
+                return err->errorf("IncorrectType", "Field `%s::%s` is not numeric.", view.className, view.name), false;
+        }
+    }
+
+    // values of one field of the selected rows; T must be the field's type (numeric, bool or std::string)
+    template <typename T>
+    bool project(IErrorHandler* err, const char* field, std::vector<T>* values_out) const {
+        ColumnView_t view;
+
+        if (!columnView(err, rows, field, &view))
+            return false;
+
+        if (view.kind != (uint32_t) TypeKind<T>::value || view.kind == KIND_OTHER || view.kind == KIND_VECTOR
+                || view.kind == KIND_CLASS)
+            return err->errorf("IncorrectType", "Field `%s::%s` cannot be projected to the requested type.",
+                    view.className, view.name), false;
+
+        values_out->clear();
+
+        for (size_t i = 0; i < view.count; i++) {
+            if (selected[i])
+                values_out->push_back(*reinterpret_cast<const T*>(view.base + i * view.stride));
+        }
+
+        return true;
+    }
+
+    // positions of the selected rows
+    std::vector<size_t> rowIndices() const {
+        std::vector<size_t> indices;
+
+        for (size_t i = 0; i < selected.size(); i++) {
+            if (selected[i])
+                indices.push_back(i);
+        }
+
+        return indices;
+    }
+
+    // copies of the selected rows
+    void select(std::vector<Class>* rows_out) const {
+        rows_out->clear();
+
+        for (size_t i = 0; i < selected.size(); i++) {
+            if (selected[i])
+                rows_out->push_back(rows[i]);
+        }
+    }
+
+private:
+    bool whereString(IErrorHandler* err, const char* field, int op, const char* value, size_t valueLen) {
+        ColumnView_t view;
+
+        if (!columnView(err, rows, field, &view))
+            return false;
+
+        if (view.kind != KIND_STRING)
+            return err->errorf("IncorrectType", "Field `%s::%s` is not a string.", view.className, view.name), false;
+
+        switch (op) {
+            case QUERY_EQ: filterStrings<QueryEq>(view, value, valueLen, selected.data()); break;
+            case QUERY_NE: filterStrings<QueryNe>(view, value, valueLen, selected.data()); break;
+            case QUERY_LT: filterStrings<QueryLt>(view, value, valueLen, selected.data()); break;
+            case QUERY_LE: filterStrings<QueryLe>(view, value, valueLen, selected.data()); break;
+            case QUERY_GT: filterStrings<QueryGt>(view, value, valueLen, selected.data()); break;
+            case QUERY_GE: filterStrings<QueryGe>(view, value, valueLen, selected.data()); break;
+        }
+
+        return true;
+    }
+
+    const Collection& rows;
+    std::vector<uint8_t> selected;        // 1 per selected row
+};
+}
+#endif
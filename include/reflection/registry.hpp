@@ -0,0 +1,302 @@
+/*
+    Boost Software License - Version 1.0 - August 17, 2003
+
+    Permission is hereby granted, free of charge, to any person or organization
+    obtaining a copy of the software and accompanying documentation covered by
+    this license (the "Software") to use, reproduce, display, distribute,
+    execute, and transmit the Software, and to prepare derivative works of the
+    Software, and to permit third-parties to whom the Software is furnished to
+    do so, all subject to the following:
+
+    The copyright notices in the Software and this entire statement, including
+    the above license grant, this restriction and the following disclaimer,
+    must be included in all copies of the Software, in whole or in part, and
+    all derivative works of the Software, unless such copies or derivative
+    works are solely in the form of machine-executable object code generated by
+    a source language processor.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+    SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+    FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "base.hpp"
+#include "field_index.hpp"
+
+namespace reflection {  // UUID('c3549467-1615-4087-9829-176a2dc44b76')
+
+// One reflected class. Instances are constant-initialized (see TypeRegistrar) and linked into the registry during
+// static initialization, for every class whose fields are reflected anywhere in the program.
+struct RegisteredType_t {
+    const char* (*classId)(REFL_MATCH_0);       // "ClassName,version"
+    const char* (*className)(REFL_MATCH_0);
+    FieldSet_t const* (*fieldSet)();
+    const UUID_t* (*uuidOrNull)();              // nullptr unless the class itself declares REFL_UUID
+    ITypeReflection* (*reflection)();           // set when ClassReflection<C> is instantiated (see class.hpp)
+
+    // filled in by TypeRegistry
+    RegisteredType_t* next;
+    uint32_t classIdHash;
+    uint64_t schemaHash;
+
+    ITypeReflection* reflectionOrNull() const { return (reflection != nullptr) ? reflection() : nullptr; }
+};
+
+// Hashed lookup of registered classes by classId, UUID and schema hash. The index is built on first use, after which
+// lookups only read it and need no locking. Types registered later (e.g. by a shared library loaded at run time) are
+// added to the index as well, which must not race with lookups.
+class TypeRegistry {
+public:
+    static bool add(RegisteredType_t* type) {
+        type->next = head();
+        head() = type;
+
+        if (built() != nullptr)
+            built()->insert(type);
+
+        return true;
+    }
+
+    static const TypeRegistry& instance() {
+        static TypeRegistry registry;
+        return registry;
+    }
+
+    RegisteredType_t const* findByClassId(const char* classId, size_t classIdLen) const {
+        uint32_t hash = hashFieldName(classId, classIdLen);
+
+        if (slots == nullptr)
+            return nullptr;
+
+        for (size_t slot = hash & mask; slots[slot].byClassId != nullptr; slot = (slot + 1) & mask) {
+            RegisteredType_t const* type = slots[slot].byClassId;
+
+            if (type->classIdHash == hash) {
+                const char* id = type->classId(REFL_MATCH);
+
+                if (strncmp(id, classId, classIdLen) == 0 && id[classIdLen] == 0)
+                    return type;
+            }
+        }
+
+        return nullptr;
+    }
+
+    RegisteredType_t const* findByClassId(const char* classId) const {
+        return findByClassId(classId, strlen(classId));
+    }
+
+    RegisteredType_t const* findByUuid(const UUID_t& uuid) const {
+        if (slots == nullptr)
+            return nullptr;
+
+        for (size_t slot = hashUuid(uuid) & mask; slots[slot].byUuid != nullptr; slot = (slot + 1) & mask) {
+            if (*slots[slot].byUuid->uuidOrNull() == uuid)
+                return slots[slot].byUuid;
+        }
+
+        return nullptr;
+    }
+
+    RegisteredType_t const* findBySchemaHash(uint64_t schemaHash) const {
+        if (slots == nullptr)
+            return nullptr;
+
+        for (size_t slot = (size_t) schemaHash & mask; slots[slot].bySchemaHash != nullptr; slot = (slot + 1) & mask) {
+            if (slots[slot].bySchemaHash->schemaHash == schemaHash)
+                return slots[slot].bySchemaHash;
+        }
+
+        return nullptr;
+    }
+
+    // all registered types, most recently registered first
+    RegisteredType_t const* first() const { return head(); }
+    size_t count() const { return numTypes; }
+
+    // FNV-1a over the class name and the name, type and flags of every field including base classes;
+    // the version is left out, so that it only changes when the layout does. 0 if the field table is unavailable.
+    static uint64_t schemaHash(FieldSet_t const* fieldSet) {
+        uint64_t hash = 14695981039346656037ull;
+        FlatFieldTable_t const* table = fieldSet->flattened();
+
+        if (table == nullptr)
+            return 0;
+
+        hash = hashBytes(hash, fieldSet->className, strlen(fieldSet->className) + 1);
+
+        for (size_t i = 0; i < table->count; i++) {
+            const Field_t& field = *table->entries[i].field;
+            uint32_t flags = field.systemFlags & ~FIELD_HAS_OFFSET;
+
+            hash = hashBytes(hash, table->entries[i].className, strlen(table->entries[i].className) + 1);
+            hash = hashBytes(hash, field.name, strlen(field.name) + 1);
+            hash = hashBytes(hash, &flags, sizeof(flags));
+
+            if (field.systemFlags & FIELD_DEPENDENCY)
+                hash = hashBytes(hash, field.uuid->uuid, sizeof(field.uuid->uuid));
+            else {
+                const char* typeName = field.refl->staticTypeName();
+                hash = hashBytes(hash, typeName, strlen(typeName) + 1);
+            }
+        }
+
+        return hash;
+    }
+
+private:
+    struct Slot_t {
+        RegisteredType_t* byClassId;
+        RegisteredType_t* byUuid;
+        RegisteredType_t* bySchemaHash;
+    };
+
+    TypeRegistry() : slots(nullptr), mask(0), numTypes(0) {
+        for (RegisteredType_t* type = head(); type != nullptr; type = type->next)
+            insert(type);
+
+        if (slots == nullptr)
+            grow();
+
+        built() = this;
+    }
+
+    ~TypeRegistry() {
+        built() = nullptr;
+        free(slots);
+    }
+
+    TypeRegistry(const TypeRegistry& other) = delete;
+    TypeRegistry& operator =(const TypeRegistry& other) = delete;
+
+    static RegisteredType_t*& head() {
+        static RegisteredType_t* list = nullptr;
+        return list;
+    }
+
+    static TypeRegistry*& built() {
+        static TypeRegistry* registry = nullptr;
+        return registry;
+    }
+
+    static uint64_t hashBytes(uint64_t hash, const void* data, size_t length) {
+        for (size_t i = 0; i < length; i++) {
+            hash ^= reinterpret_cast<const uint8_t*>(data)[i];
+            hash *= 1099511628211ull;
+        }
+
+        return hash;
+    }
+
+    static uint32_t hashUuid(const UUID_t& uuid) {
+        return uuid.uuid[0] ^ (uuid.uuid[1] * 0x9e3779b1u) ^ uuid.uuid[2] ^ (uuid.uuid[3] * 0x85ebca6bu);
+    }
+
+    void insert(RegisteredType_t* type) {
+        const char* classId = type->classId(REFL_MATCH);
+        size_t classIdLen = strlen(classId);
+
+        type->classIdHash = hashFieldName(classId, classIdLen);
+        type->schemaHash = schemaHash(type->fieldSet());
+
+        // if the index can't grow, it keeps working at a higher load until it's full; later types then can't be found
+        if (((numTypes + 1) * 2 > mask + 1 || slots == nullptr) && !grow() && (slots == nullptr || numTypes + 1 > mask))
+            return;
+
+        // the first registration of a class wins (several copies may be linked in from different shared libraries)
+        if (findByClassId(classId, classIdLen) != nullptr)
+            return;
+
+        numTypes++;
+        place(type);
+    }
+
+    void place(RegisteredType_t* type) {
+        size_t slot;
+
+        for (slot = type->classIdHash & mask; slots[slot].byClassId != nullptr; slot = (slot + 1) & mask) {}
+        slots[slot].byClassId = type;
+
+        const UUID_t* uuid = type->uuidOrNull();
+
+        if (uuid != nullptr && findByUuid(*uuid) == nullptr) {
+            for (slot = hashUuid(*uuid) & mask; slots[slot].byUuid != nullptr; slot = (slot + 1) & mask) {}
+            slots[slot].byUuid = type;
+        }
+
+        if (type->schemaHash != 0 && findBySchemaHash(type->schemaHash) == nullptr) {
+            for (slot = (size_t) type->schemaHash & mask; slots[slot].bySchemaHash != nullptr; slot = (slot + 1) & mask) {}
+            slots[slot].bySchemaHash = type;
+        }
+    }
+
+    bool grow() {
+        Slot_t* oldSlots = slots;
+        size_t oldNumSlots = (oldSlots != nullptr) ? mask + 1 : 0;
+        size_t numSlots = (oldNumSlots != 0) ? oldNumSlots * 2 : 16;
+
+        Slot_t* newSlots = (Slot_t*) calloc(numSlots, sizeof(Slot_t));
+
+        if (newSlots == nullptr)
+            return err->allocationError("reflection::TypeRegistry::grow"), false;
+
+        slots = newSlots;
+        mask = numSlots - 1;
+
+        for (size_t i = 0; i < oldNumSlots; i++) {
+            if (oldSlots[i].byClassId != nullptr)
+                place(oldSlots[i].byClassId);
+        }
+
+        free(oldSlots);
+        return true;
+    }
+
+    Slot_t* slots;
+    size_t mask;
+    size_t numTypes;
+};
+
+template <class C>
+FieldSet_t const* fieldSetOfClass() {
+    return C::template reflection_s_getFields<C>(REFL_MATCH);
+}
+
+// UUID declared by C itself (REFL_UUID), not inherited from its reflected base class
+template <class C, typename Enable = void>
+struct ClassUuid {
+    static const UUID_t* get() { return nullptr; }
+};
+
+template <class C>
+struct ClassUuid<C, decltype(&C::reflection_s_uuid, void())> {
+    static const UUID_t* get() {
+        const UUID_t* uuid = &C::reflection_s_uuid(REFL_MATCH);
+        return (uuid != ClassUuid<typename C::reflection_BaseClass>::get()) ? uuid : nullptr;
+    }
+};
+
+// Instantiated (and so registered) by FieldSetBuilder<C>, i.e. for every class whose fields are used
+template <class C>
+struct TypeRegistrar {
+    static RegisteredType_t type;
+    static const bool registered;
+};
+
+template <class C>
+RegisteredType_t TypeRegistrar<C>::type = { &C::reflection_s_classId, &C::reflection_s_className,
+        &fieldSetOfClass<C>, &ClassUuid<C>::get, nullptr, nullptr, 0, 0 };
+
+template <class C>
+const bool TypeRegistrar<C>::registered = TypeRegistry::add(&TypeRegistrar<C>::type);
+
+inline const TypeRegistry& typeRegistry() {
+    return TypeRegistry::instance();
+}
+}
@@ -0,0 +1,98 @@
+/*
+    Boost Software License - Version 1.0 - August 17, 2003
+
+    Permission is hereby granted, free of charge, to any person or organization
+    obtaining a copy of the software and accompanying documentation covered by
+    this license (the "Software") to use, reproduce, display, distribute,
+    execute, and transmit the Software, and to prepare derivative works of the
+    Software, and to permit third-parties to whom the Software is furnished to
+    do so, all subject to the following:
+
+    The copyright notices in the Software and this entire statement, including
+    the above license grant, this restriction and the following disclaimer,
+    must be included in all copies of the Software, in whole or in part, and
+    all derivative works of the Software, unless such copies or derivative
+    works are solely in the form of machine-executable object code generated by
+    a source language processor.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+    SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+    FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "base.hpp"
+#include "buffer_io.hpp"
+#include "bufstring.hpp"
+#include "serializer.hpp"
+
+namespace reflection {  // UUID('c3549467-1615-4087-9829-176a2dc44b76')
+
+// A .class_schema: the number of fields, then the declaring class name, name and type information of each one,
+// from the runtime field tables (dependencies left out)
+inline bool serializeSchema(IErrorHandler* err, serialization::IWriter* writer, FieldSet_t const* fieldSet) {
+    FlatFieldTable_t const* table = fieldSet->flattened();
+    BufString_t cn, str;
+
+    if (table == nullptr)
+        return false;
+
+    size_t numFields = 0;
+
+    for (size_t i = 0; i < table->count; i++)
+        numFields += !(table->entries[i].field->systemFlags & FIELD_DEPENDENCY);
+
+    if (!serialization::Serializer<size_t>::serialize(err, writer, numFields))
+        return false;
+
+    for (size_t i = 0; i < table->count; i++) {
+        const FlatField_t& entry = table->entries[i];
+
+        if (entry.field->systemFlags & FIELD_DEPENDENCY)
+            continue;
+
+        if (!bufStringSet(err, cn.buf, cn.bufSize, entry.className, strlen(entry.className))
+                || !bufStringSet(err, str.buf, str.bufSize, entry.field->name, strlen(entry.field->name))
+                || !serialization::Serializer<BufString_t>::serialize(err, writer, cn)
+                || !serialization::Serializer<BufString_t>::serialize(err, writer, str)
+                || !entry.field->refl->serializeTypeInformation(err, writer, nullptr))
+            return false;
+    }
+
+    return true;
+}
+
+// The .class_schema of a class, serialized once and kept for the lifetime of the program
+// (see FieldSet_t::schemaBlob), so that writing schemas out costs no more than copying these bytes.
+class SchemaBlob {
+public:
+    SchemaBlob(IErrorHandler* err, FieldSet_t const* fieldSet) : ok(serializeSchema(err, &writer, fieldSet)) {}
+
+    SchemaBlob(const SchemaBlob& other) = delete;
+    SchemaBlob& operator =(const SchemaBlob& other) = delete;
+
+    const uint8_t* data() const { return reinterpret_cast<const uint8_t*>(writer.data()); }
+    size_t size() const { return writer.size(); }
+
+    bool write(IErrorHandler* err, serialization::IWriter* out) const { return out->write(err, writer.data(), writer.size()); }
+
+private:
+    serialization::BufferWriter writer;
+    bool ok;
+
+    template <class C>
+    friend SchemaBlob const* schemaBlobOf(IErrorHandler* err);
+};
+
+// nullptr if the schema could not be serialized; that is reported (through `err`) on the first call only
+template <class C>
+SchemaBlob const* schemaBlobOf(IErrorHandler* err) {
+    static const SchemaBlob blob(err, C::template reflection_s_getFields<C>(REFL_MATCH));
+    return blob.ok ? &blob : nullptr;
+}
+}
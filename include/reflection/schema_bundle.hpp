@@ -0,0 +1,379 @@
+/*
+    Boost Software License - Version 1.0 - August 17, 2003
+
+    Permission is hereby granted, free of charge, to any person or organization
+    obtaining a copy of the software and accompanying documentation covered by
+    this license (the "Software") to use, reproduce, display, distribute,
+    execute, and transmit the Software, and to prepare derivative works of the
+    Software, and to permit third-parties to whom the Software is furnished to
+    do so, all subject to the following:
+
+    The copyright notices in the Software and this entire statement, including
+    the above license grant, this restriction and the following disclaimer,
+    must be included in all copies of the Software, in whole or in part, and
+    all derivative works of the Software, unless such copies or derivative
+    works are solely in the form of machine-executable object code generated by
+    a source language processor.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+    SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+    FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "buffer_io.hpp"
+#include "registry.hpp"
+#include "schema_blob.hpp"
+#include "schema_provider.hpp"
+
+#ifdef _WIN32
+#include <cstdio>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace reflection {  // UUID('c3549467-1615-4087-9829-176a2dc44b76')
+
+// Schemas of many classes in one file, instead of a .class_schema file each:
+//   char     magic[8]              "RFLSCHB1"
+//   uint32   numClasses
+//   uint32   numSlots              power of two
+//   uint32   totalSize
+//   uint32   reserved
+//   slot     slots[numSlots]       {uint32 classIdHash, uint32 entry + 1 (0 = empty)}, open addressing
+//   entry    entries[numClasses]   {uint32 classIdOffset, uint32 classIdLength, uint32 schemaOffset, uint32 schemaSize}
+//   data                           NUL-terminated classIds and schemas (as written by serializeSchema)
+// All integers are little-endian and offsets are relative to the start of the bundle, so it can be used in place.
+struct SchemaBundleLayout {
+    enum { HEADER_SIZE = 24, SLOT_SIZE = 8, ENTRY_SIZE = 16 };
+
+    static const char* magic() { return "RFLSCHB1"; }
+};
+
+// Writes the schemas of every registered class as one bundle
+inline bool writeSchemaBundle(IErrorHandler* err, serialization::IWriter* writer,
+        const TypeRegistry& registry = TypeRegistry::instance()) {
+    typedef SchemaBundleLayout Layout;
+
+    const size_t numClasses = registry.count();
+    size_t numSlots = 1;
+
+    while (numSlots < numClasses * 2)
+        numSlots *= 2;
+
+    const size_t dataOffset = Layout::HEADER_SIZE + numSlots * Layout::SLOT_SIZE + numClasses * Layout::ENTRY_SIZE;
+
+    uint8_t* index = (uint8_t*) calloc(dataOffset, 1);
+    AllocGuard guard(index);
+
+    if (index == nullptr)
+        return err->allocationError("reflection::writeSchemaBundle"), false;
+
+    serialization::BufferWriter data;
+    size_t entry = 0;
+
+    for (RegisteredType_t const* type = registry.first(); type != nullptr; type = type->next, entry++) {
+        const char* classId = type->classId(REFL_MATCH);
+        const size_t classIdLength = strlen(classId);
+        const size_t classIdOffset = dataOffset + data.size();
+
+        if (!data.write(err, classId, classIdLength + 1))
+            return false;
+
+        const size_t schemaOffset = dataOffset + data.size();
+
+        SchemaBlob const* blob = type->fieldSet()->schemaBlob(err);
+
+        if (blob == nullptr || !blob->write(err, &data))
+            return false;
+
+        uint8_t* p = index + Layout::HEADER_SIZE + numSlots * Layout::SLOT_SIZE + entry * Layout::ENTRY_SIZE;
+        serialization::storeU32LE(p, (uint32_t) classIdOffset);
+        serialization::storeU32LE(p + 4, (uint32_t) classIdLength);
+        serialization::storeU32LE(p + 8, (uint32_t) schemaOffset);
+        serialization::storeU32LE(p + 12, (uint32_t) (dataOffset + data.size() - schemaOffset));
+
+        uint32_t hash = hashFieldName(classId, classIdLength);
+        size_t slot = hash & (numSlots - 1);
+
+        while (serialization::loadU32LE(index + Layout::HEADER_SIZE + slot * Layout::SLOT_SIZE + 4) != 0)
+            slot = (slot + 1) & (numSlots - 1);
+
+        serialization::storeU32LE(index + Layout::HEADER_SIZE + slot * Layout::SLOT_SIZE, hash);
+        serialization::storeU32LE(index + Layout::HEADER_SIZE + slot * Layout::SLOT_SIZE + 4, (uint32_t) entry + 1);
+    }
+
+    if (dataOffset + data.size() > UINT32_MAX)
+        return err->errorf("InstanceTooLarge", "Schema bundle would be %zu bytes.", dataOffset + data.size()), false;
+
+    memcpy(index, Layout::magic(), 8);
+    serialization::storeU32LE(index + 8, (uint32_t) numClasses);
+    serialization::storeU32LE(index + 12, (uint32_t) numSlots);
+    serialization::storeU32LE(index + 16, (uint32_t) (dataOffset + data.size()));
+
+    return writer->write(err, index, dataOffset) && writer->write(err, data.data(), data.size());
+}
+
+// Read-only view of a schema bundle: mapped from a file (or borrowed from memory) and validated once,
+// after which lookups hash the classId and return a pointer into the bundle without copying anything.
+class SchemaBundle {
+public:
+    SchemaBundle() : data(nullptr), size(0), mapped(false), numClasses(0), numSlots(0) {}
+    ~SchemaBundle() { close(); }
+
+    SchemaBundle(const SchemaBundle& other) = delete;
+    SchemaBundle& operator =(const SchemaBundle& other) = delete;
+
+    bool open(IErrorHandler* err, const char* path) {
+        close();
+
+#ifdef _WIN32
+        FILE* file = fopen(path, "rb");
+
+        if (file == nullptr)
+            return err->errorf("IOError", "Failed to open `%s`.", path), false;
+
+        fseek(file, 0, SEEK_END);
+        long length = ftell(file);
+        fseek(file, 0, SEEK_SET);
+
+        uint8_t* buffer = (length > 0) ? (uint8_t*) malloc(length) : nullptr;
+        bool ok = (buffer != nullptr && fread(buffer, 1, length, file) == (size_t) length);
+        fclose(file);
+
+        if (!ok) {
+            free(buffer);
+            return err->errorf("IOError", "Failed to read `%s`.", path), false;
+        }
+
+        data = buffer;
+        size = (size_t) length;
+#else
+        int fd = ::open(path, O_RDONLY);
+
+        if (fd < 0)
+            return err->errorf("IOError", "Failed to open `%s`.", path), false;
+
+        struct stat st;
+        void* p = MAP_FAILED;
+
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+            p = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        ::close(fd);
+
+        if (p == MAP_FAILED)
+            return err->errorf("IOError", "Failed to map `%s`.", path), false;
+
+        data = reinterpret_cast<const uint8_t*>(p);
+        size = (size_t) st.st_size;
+#endif
+
+        mapped = true;
+
+        if (!validate(err)) {
+            close();
+            return false;
+        }
+
+        return true;
+    }
+
+    // uses a bundle already in memory, which must outlive the SchemaBundle
+    bool openMemory(IErrorHandler* err, const void* bundle, size_t bundleSize) {
+        close();
+
+        data = reinterpret_cast<const uint8_t*>(bundle);
+        size = bundleSize;
+
+        if (!validate(err)) {
+            close();
+            return false;
+        }
+
+        return true;
+    }
+
+    void close() {
+        if (mapped) {
+#ifdef _WIN32
+            free(const_cast<uint8_t*>(data));
+#else
+            munmap(const_cast<uint8_t*>(data), size);
+#endif
+        }
+
+        data = nullptr;
+        size = 0;
+        mapped = false;
+        numClasses = 0;
+        numSlots = 0;
+    }
+
+    bool find(const char* classId, const uint8_t*& schema_out, size_t& size_out) const {
+        if (numSlots == 0)
+            return false;
+
+        const size_t classIdLength = strlen(classId);
+        const uint32_t hash = hashFieldName(classId, classIdLength);
+
+        size_t slot = hash & (numSlots - 1);
+
+        for (size_t probe = 0; probe < numSlots; probe++, slot = (slot + 1) & (numSlots - 1)) {
+            const uint8_t* p = data + Layout::HEADER_SIZE + slot * Layout::SLOT_SIZE;
+            const uint32_t entryPlusOne = serialization::loadU32LE(p + 4);
+
+            if (entryPlusOne == 0)
+                return false;
+
+            if (serialization::loadU32LE(p) != hash)
+                continue;
+
+            const uint8_t* e = entry(entryPlusOne - 1);
+
+            if (serialization::loadU32LE(e + 4) == classIdLength
+                    && memcmp(data + serialization::loadU32LE(e), classId, classIdLength) == 0) {
+                schema_out = data + serialization::loadU32LE(e + 8);
+                size_out = serialization::loadU32LE(e + 12);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    size_t count() const { return numClasses; }
+
+    // classId of the n-th class in the bundle
+    const char* classIdAt(size_t index) const {
+        return reinterpret_cast<const char*>(data + serialization::loadU32LE(entry(index)));
+    }
+
+private:
+    typedef SchemaBundleLayout Layout;
+
+    const uint8_t* entry(size_t index) const {
+        return data + Layout::HEADER_SIZE + numSlots * Layout::SLOT_SIZE + index * Layout::ENTRY_SIZE;
+    }
+
+    // checks every offset once, so that lookups need not
+    bool validate(IErrorHandler* err) {
+        if (size < Layout::HEADER_SIZE || memcmp(data, Layout::magic(), 8) != 0)
+            return err->error("CorruptSchemaBundle", "Not a schema bundle."), false;
+
+        numClasses = serialization::loadU32LE(data + 8);
+        numSlots = serialization::loadU32LE(data + 12);
+
+        const uint64_t dataOffset = Layout::HEADER_SIZE + (uint64_t) numSlots * Layout::SLOT_SIZE
+                + (uint64_t) numClasses * Layout::ENTRY_SIZE;
+
+        if (serialization::loadU32LE(data + 16) != size || dataOffset > size || numSlots < numClasses
+                || (numSlots & (numSlots - 1)) != 0)
+            return err->error("CorruptSchemaBundle", "Schema bundle header is inconsistent."), false;
+
+        for (size_t i = 0; i < numSlots; i++) {
+            if (serialization::loadU32LE(data + Layout::HEADER_SIZE + i * Layout::SLOT_SIZE + 4) > numClasses)
+                return err->error("CorruptSchemaBundle", "Schema bundle index is out of range."), false;
+        }
+
+        for (size_t i = 0; i < numClasses; i++) {
+            const uint8_t* e = entry(i);
+            const uint64_t classIdEnd = (uint64_t) serialization::loadU32LE(e) + serialization::loadU32LE(e + 4);
+            const uint64_t schemaEnd = (uint64_t) serialization::loadU32LE(e + 8) + serialization::loadU32LE(e + 12);
+
+            if (classIdEnd >= size || data[classIdEnd] != 0 || schemaEnd > size)
+                return err->error("CorruptSchemaBundle", "Schema bundle entry is out of range."), false;
+        }
+
+        return true;
+    }
+
+    const uint8_t* data;
+    size_t size;
+    bool mapped;
+    size_t numClasses;
+    size_t numSlots;
+};
+
+// ISchemaProvider over a SchemaBundle: schemas are read straight from the mapped bundle
+class SchemaBundleProvider : public ISchemaProvider {
+public:
+    explicit SchemaBundleProvider(const SchemaBundle& bundle) : bundle(bundle) {}
+
+    serialization::IReader* openClassSchemaOrNull(const char* className) override {
+        const uint8_t* schema;
+        size_t schemaSize;
+
+        if (!bundle.find(className, schema, schemaSize))
+            return nullptr;
+
+        return new Reader(schema, schemaSize);
+    }
+
+    void closeClassSchema(serialization::IReader* reader) override {
+        delete static_cast<Reader*>(reader);
+    }
+
+private:
+    struct Reader final : serialization::BufferReader {
+        Reader(const void* data, size_t size) : serialization::BufferReader(data, size) {}
+    };
+
+    const SchemaBundle& bundle;
+};
+
+// Schemas of the classes linked into this program, straight from their cached SchemaBlob: no files, and nothing
+// serialized more than once per class
+class LinkedSchemaProvider : public ISchemaProvider {
+public:
+    explicit LinkedSchemaProvider(const TypeRegistry& registry = TypeRegistry::instance()) : registry(registry) {}
+
+    serialization::IReader* openClassSchemaOrNull(const char* className) override {
+        RegisteredType_t const* type = registry.findByClassId(className);
+        SchemaBlob const* blob = (type != nullptr) ? type->fieldSet()->schemaBlob(err) : nullptr;
+
+        if (blob == nullptr)
+            return nullptr;
+
+        return new Reader(blob->data(), blob->size());
+    }
+
+    void closeClassSchema(serialization::IReader* reader) override {
+        delete static_cast<Reader*>(reader);
+    }
+
+private:
+    struct Reader final : serialization::BufferReader {
+        Reader(const void* data, size_t size) : serialization::BufferReader(data, size) {}
+    };
+
+    const TypeRegistry& registry;
+};
+}
+
+// Links a schema bundle file into the executable, in its own `.refl_schemas` section, as the bytes between the symbols
+// <symbol>_begin and <symbol>_end. Use at namespace scope, once per program; GCC/Clang on ELF targets only.
+// The file must exist at compile time (write it with writeSchemaBundle from a previous build or a generator) and is
+// looked up by the assembler relative to the working directory and -I paths. The schemas then need no file I/O:
+//     bundle.openMemory(err, schemas_begin, schemas_end - schemas_begin);
+// and tools can pull them out of the binary without running it:
+//     objcopy -O binary --only-section=.refl_schemas program schemas.bundle
+#define REFL_EMBED_SCHEMA_BUNDLE(symbol_, path_)\
+    __asm__(".pushsection .refl_schemas, \"a\"\n"\
+            ".balign 8\n"\
+            ".global " #symbol_ "_begin\n"\
+            #symbol_ "_begin:\n"\
+            ".incbin \"" path_ "\"\n"\
+            ".global " #symbol_ "_end\n"\
+            #symbol_ "_end:\n"\
+            ".popsection\n");\
+    extern "C" const uint8_t symbol_##_begin[];\
+    extern "C" const uint8_t symbol_##_end[]
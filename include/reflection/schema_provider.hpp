@@ -0,0 +1,155 @@
+/*
+    Boost Software License - Version 1.0 - August 17, 2003
+
+    Permission is hereby granted, free of charge, to any person or organization
+    obtaining a copy of the software and accompanying documentation covered by
+    this license (the "Software") to use, reproduce, display, distribute,
+    execute, and transmit the Software, and to prepare derivative works of the
+    Software, and to permit third-parties to whom the Software is furnished to
+    do so, all subject to the following:
+
+    The copyright notices in the Software and this entire statement, including
+    the above license grant, this restriction and the following disclaimer,
+    must be included in all copies of the Software, in whole or in part, and
+    all derivative works of the Software, unless such copies or derivative
+    works are solely in the form of machine-executable object code generated by
+    a source language processor.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+    SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+    FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "api.hpp"
+#include "serializer.hpp"
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace reflection {  // UUID('c3549467-1615-4087-9829-176a2dc44b76')
+
+// one field of a .class_schema, as written by serializeSchema (schema_blob.hpp)
+struct SchemaField_t {
+    std::string className;              // class which declares the field
+    std::string name;
+    serialization::Tag_t tag;
+    std::string fieldClassName;         // if tag == TAG_CLASS
+};
+
+struct ParsedSchema_t {
+    std::vector<SchemaField_t> fields;
+};
+
+class ISchemaProvider {
+public:
+    virtual serialization::IReader* openClassSchemaOrNull(const char* className) = 0;
+    virtual void closeClassSchema(serialization::IReader* reader) = 0;
+
+    // Providers that keep parsed schemas around return true and set schema_out (nullptr if there is no schema
+    // for the class); the default makes the dump functions open and parse the schema every time.
+    virtual bool getParsedSchema(const char* className, const ParsedSchema_t*& schema_out) { return false; }
+};
+
+inline bool parseClassSchema(serialization::IReader* reader, ParsedSchema_t* schema_out) {
+    BufString_t className, name;
+    uint32_t numFields;
+
+    if (!serialization::Serializer<uint32_t>::deserialize(err, reader, numFields))
+        return false;
+
+    schema_out->fields.clear();
+
+    for (uint32_t i = 0; i < numFields; i++) {
+        SchemaField_t field;
+
+        if (!serialization::Serializer<BufString_t>::deserialize(err, reader, className)
+                || !serialization::Serializer<BufString_t>::deserialize(err, reader, name)
+                || !reader->read(err, &field.tag, sizeof(field.tag)))
+            return false;
+
+        field.className = className.buf;
+        field.name = name.buf;
+
+        if (field.tag == serialization::TAG_CLASS) {
+            if (!serialization::Serializer<BufString_t>::deserialize(err, reader, className))
+                return false;
+
+            field.fieldClassName = className.buf;
+        }
+
+        schema_out->fields.push_back(std::move(field));
+    }
+
+    return true;
+}
+
+// Schema of a class for the dump functions: from the provider's cache if it has one, otherwise parsed into `storage`.
+// schema_out is nullptr if the schema is not available; false means it could not be parsed.
+inline bool getClassSchema(ISchemaProvider* sp, const char* className, ParsedSchema_t& storage,
+        const ParsedSchema_t*& schema_out) {
+    schema_out = nullptr;
+
+    if (sp == nullptr || sp->getParsedSchema(className, schema_out))
+        return true;
+
+    serialization::IReader* schemaReader = sp->openClassSchemaOrNull(className);
+
+    if (schemaReader == nullptr)
+        return true;
+
+    bool ok = parseClassSchema(schemaReader, &storage);
+    sp->closeClassSchema(schemaReader);
+
+    if (ok)
+        schema_out = &storage;
+
+    return ok;
+}
+
+// Wraps another provider so that every schema is opened and parsed once, however many instances are dumped
+class SchemaCache : public ISchemaProvider {
+public:
+    explicit SchemaCache(ISchemaProvider* provider) : provider(provider), numParsed(0) {}
+
+    serialization::IReader* openClassSchemaOrNull(const char* className) override { return provider->openClassSchemaOrNull(className); }
+    void closeClassSchema(serialization::IReader* reader) override { provider->closeClassSchema(reader); }
+
+    bool getParsedSchema(const char* className, const ParsedSchema_t*& schema_out) override {
+        auto it = schemas.find(className);
+
+        if (it == schemas.end()) {
+            Entry_t& entry = schemas[className];
+            const ParsedSchema_t* schema;
+
+            // a schema which fails to parse is reported once, then treated as not available
+            entry.available = getClassSchema(provider, className, entry.schema, schema) && schema != nullptr;
+            numParsed += entry.available;
+            it = schemas.find(className);
+        }
+
+        schema_out = it->second.available ? &it->second.schema : nullptr;
+        return true;
+    }
+
+    // number of schemas parsed so far
+    size_t count() const { return numParsed; }
+
+private:
+    struct Entry_t {
+        bool available;
+        ParsedSchema_t schema;
+    };
+
+    ISchemaProvider* provider;
+    std::unordered_map<std::string, Entry_t> schemas;
+    size_t numParsed;
+};
+}
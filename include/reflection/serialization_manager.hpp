@@ -30,6 +30,11 @@
 #include "serializer.hpp"
 
 namespace serialization {
+// Reflected classes are (de)serialized field by field through SerializationManager, which calls the hooks below.
+// Defining REFLECTOR_COMPILED_SERIALIZATION switches them to a compiled BinaryProgram (same bytes, faster), which
+// skips the hooks for every field it compiles: built-in scalars, std::string and nested classes. Define it before any
+// reflection header and the same way in every translation unit, as ClassReflection<C> depends on it.
+
 // for hooks:
 // return -1 for unhandled (use default Serializer)
 // return 0 for failed to handle
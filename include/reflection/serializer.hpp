@@ -125,91 +125,146 @@ public:
     enum { TAG = tag };
 
     static bool serialize(IErrorHandler* err, IWriter* writer, const T& value) {
-        return writer->write(err, &value, 1);
+        return writer->write(err, &value, sizeof(value));
     }
 
     static bool deserialize(IErrorHandler* err, IReader* reader, T& value_out) {
-        return reader->read(err, &value_out, 1);
+        return reader->read(err, &value_out, sizeof(value_out));
     }
 };
 
-template <typename T>
-class SmvIntSerializer {
-public:
-    enum { TAG = TAG_SMVINT };
+enum { MAX_SMV_SIZE = 10 };
 
-    static bool serializeValue(IErrorHandler* err, IWriter* writer, const T& value) {
-        uint64_t sign, magnitude, signMask;
+enum SmvResult_t {
+    SMV_OK,
+    SMV_TRUNCATED,          // the input ends inside the value
+    SMV_TOO_LONG,           // the magnitude doesn't fit 64 bits
+};
 
-        if (value >= 0) {
-            magnitude = value;
-            sign = 0;
-        }
-        else {
-            // FIXME: check overflow
-            magnitude = 1 + ~value;
-            sign = 1;
-        }
+// Decodes one sign+magnitude varint (see SmvIntSerializer) from a byte source: `next(byte_out)` returns false at the
+// end of input. Never asks for more than MAX_SMV_SIZE bytes. This is the only decoder of the format, so that all
+// readers agree on what is malformed; use it through one of the readSmv overloads below.
+template <typename NextByte>
+SmvResult_t decodeSmv(NextByte& next, bool& negative_out, uint64_t& magnitude_out) {
+    uint8_t byte;
+
+    if (!next(byte))
+        return SMV_TRUNCATED;
+
+    // most integers and lengths fit a single byte
+    if (!(byte & 0x80)) {
+        negative_out = (byte & 0x40) != 0;
+        magnitude_out = byte & 0x3f;
+        return SMV_OK;
+    }
 
-        signMask = 0x40;
+    uint64_t magnitude = byte & 0x7f;
 
-        // glue magnitude onto the value so that it will always be
-        // the most significant encoded bit
-        while ((magnitude & (signMask - 1)) != magnitude)
-            // FIXME: check overflow
-            signMask = signMask << 7;
+    for (unsigned int shift = 7; shift < 64; shift += 7) {
+        if (!next(byte))
+            return SMV_TRUNCATED;
 
-        magnitude |= sign * signMask;
+        uint64_t payload = (byte & 0x80) ? (byte & 0x7f) : (byte & 0x3f);
 
-        // from now on, signMask is actually signMask|magnitudeMask
-        signMask |= (signMask - 1);
+        // the tenth byte may only carry bit 63
+        if (shift > 57 && (payload >> (64 - shift)) != 0)
+            return SMV_TOO_LONG;
 
-        uint8_t byte;
+        magnitude |= payload << shift;
 
-        while (signMask != 0) {
-            byte = magnitude & 0x7f;
-            magnitude = (magnitude >> 7);
-            signMask = (signMask >> 7);
+        if (!(byte & 0x80)) {
+            negative_out = (byte & 0x40) != 0;
+            magnitude_out = magnitude;
+            return SMV_OK;
+        }
+    }
 
-            if (signMask != 0)
-                byte |= 0x80;
+    return SMV_TOO_LONG;
+}
 
-            if (!writer->write(err, &byte, 1))
-                return false;
-        }
+// Encodes one sign+magnitude varint into `out` (at most MAX_SMV_SIZE bytes), returns the number of bytes used.
+// 7 bits per byte, least significant first; the last byte holds the remaining 6 bits and the sign (0x40).
+inline size_t encodeSmv(uint8_t* out, bool negative, uint64_t magnitude) {
+    size_t length = 0;
 
+    while (magnitude >= 0x40) {
+        out[length++] = (uint8_t)(0x80 | (magnitude & 0x7f));
+        magnitude >>= 7;
+    }
+
+    out[length++] = (uint8_t)(magnitude | (negative ? 0x40 : 0));
+    return length;
+}
+
+// From [pos, end); on success `pos` is moved past the value
+inline SmvResult_t readSmv(const uint8_t*& pos, const uint8_t* end, bool& negative_out, uint64_t& magnitude_out) {
+    const uint8_t* p = pos;
+
+    auto next = [&p, end](uint8_t& byte_out) -> bool {
+        if (p == end)
+            return false;
+
+        byte_out = *p++;
         return true;
+    };
+
+    SmvResult_t result = decodeSmv(next, negative_out, magnitude_out);
+
+    if (result == SMV_OK)
+        pos = p;
+
+    return result;
+}
+
+// Through an IReader, a byte at a time so that nothing past the value is consumed. The reader reports the end of input.
+inline bool readSmv(IErrorHandler* err, IReader* reader, bool& negative_out, uint64_t& magnitude_out) {
+    auto next = [err, reader](uint8_t& byte_out) -> bool {
+        return reader->read(err, &byte_out, 1);
+    };
+
+    switch (decodeSmv(next, negative_out, magnitude_out)) {
+        case SMV_OK:        return true;
+        case SMV_TRUNCATED: return false;
+        default:            return err->error("IntegerOverflow", "Encoded integer is too long."), false;
+    }
+}
+
+template <typename T>
+class SmvIntSerializer {
+public:
+    enum { TAG = TAG_SMVINT };
+
+    enum { MAX_ENCODED_SIZE = MAX_SMV_SIZE };
+
+    // encodes into `out` (at most MAX_ENCODED_SIZE bytes), returns the number of bytes used
+    static size_t encodeValue(uint8_t* out, const T& value) {
+        if (value >= 0)
+            return encodeSmv(out, false, (uint64_t) value);
+        else
+            return encodeSmv(out, true, 0 - (uint64_t) value);
+    }
+
+    static bool serializeValue(IErrorHandler* err, IWriter* writer, const T& value) {
+        uint8_t bytes[MAX_ENCODED_SIZE];
+        size_t length = encodeValue(bytes, value);
+
+        return writer->write(err, bytes, length);
     }
 
     static bool deserializeValue(IErrorHandler* err, IReader* reader, T& value_out) {
-        uint64_t magnitude = 0;
-        uint8_t byte;
+        bool negative;
+        uint64_t magnitude;
 
-        unsigned int shift = 0;
+        if (!readSmv(err, reader, negative, magnitude))
+            return false;
 
-        for (;;) {
-            // FIXME: check overflow + max length
-            if (!reader->read(err, &byte, 1))
-                return false;
+        // FIXME: check overflow
+        if (negative)
+            value_out = 1 + (T) ~magnitude;
+        else
+            value_out = (T) magnitude;
 
-            if (byte & 0x80) {
-                magnitude |= (byte & 0x7f) << shift;
-                shift += 7;
-            }
-            else {
-                magnitude |= (byte & 0x3f) << shift;
-
-                if (byte & 0x40) {
-                    // negative
-                    // FIXME: check overflow
-                    value_out = 1 + (T) ~magnitude;
-                }
-                else
-                    value_out = (T) magnitude;
-
-                return true;
-            }
-        }
+        return true;
     }
 
     static bool serialize(IErrorHandler* err, IWriter* writer, const T& value) {
@@ -355,9 +410,7 @@ public:
     template <typename Fields>
     static bool serializeInstance(IErrorHandler* err, IWriter* writer,
             const char* className, const Fields& fields) {
-        for (size_t i = 0; i < fields.count(); i++) {
-            const auto& field = fields[i];
-
+        for (const auto& field : fields) {
             if (!field.serialize(err, writer))
                 return false;
         }
@@ -368,43 +421,13 @@ public:
     template <typename Fields>
     static bool deserializeInstance(IErrorHandler* err, IReader* reader,
             const char* className, Fields& fields) {
-        for (size_t i = 0; i < fields.count(); i++) {
-            auto field = fields[i];
-
+        for (auto field : fields) {
             if (!field.deserialize(err, reader))
                 return false;
         }
 
         return true;
     }
-
-    template <typename Fields>
-    static bool serializeSchema(IErrorHandler* err, IWriter* writer,
-            const char* className, Fields& fields) {
-        BufString_t cn, str;
-
-        size_t numFields = fields.count();
-
-        if (!Serializer<size_t>::serialize(err, writer, numFields))
-            return false;
-
-        for (size_t i = 0; i < fields.count(); i++) {
-            const auto& field = fields[i];
-
-            const char* name = field.name;
-            className = field.className;
-
-            bufStringSet(err, cn.buf, cn.bufSize, className, strlen(className));
-            bufStringSet(err, str.buf, str.bufSize, name, strlen(name));
-
-            if (!Serializer<BufString_t>::serialize(err, writer, cn)
-                    || !Serializer<BufString_t>::serialize(err, writer, str)
-                    || !field.refl->serializeTypeInformation(err, writer, nullptr))
-                return false;
-        }
-
-        return true;
-    }
 };
 }
 
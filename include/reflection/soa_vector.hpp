@@ -0,0 +1,380 @@
+/*
+    Boost Software License - Version 1.0 - August 17, 2003
+
+    Permission is hereby granted, free of charge, to any person or organization
+    obtaining a copy of the software and accompanying documentation covered by
+    this license (the "Software") to use, reproduce, display, distribute,
+    execute, and transmit the Software, and to prepare derivative works of the
+    Software, and to permit third-parties to whom the Software is furnished to
+    do so, all subject to the following:
+
+    The copyright notices in the Software and this entire statement, including
+    the above license grant, this restriction and the following disclaimer,
+    must be included in all copies of the Software, in whole or in part, and
+    all derivative works of the Software, unless such copies or derivative
+    works are solely in the form of machine-executable object code generated by
+    a source language processor.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+    SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+    FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "base.hpp"
+#include "magic.hpp"
+
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#ifndef REFLECTOR_AVOID_STL
+#include <vector>
+
+namespace reflection {  // UUID('c3549467-1615-4087-9829-176a2dc44b76')
+// Contiguous view of one column
+template <typename T>
+struct Span {
+    T* data;
+    size_t size;
+
+    T* begin() const { return data; }
+    T* end() const { return data + size; }
+    T& operator [](size_t index) const { return data[index]; }
+    bool empty() const { return size == 0; }
+};
+
+// Storage of one column. Unlike std::vector it also hands out a bool*.
+template <typename T>
+class SoAColumn {
+public:
+    SoAColumn() : items(nullptr), count(0), capacity(0) {}
+
+    SoAColumn(const SoAColumn& other) : SoAColumn() {
+        reserve(other.count);
+
+        for (size_t i = 0; i < other.count; i++)
+            push_back(other.items[i]);
+    }
+
+    ~SoAColumn() {
+        clear();
+        ::operator delete(items);
+    }
+
+    SoAColumn& operator =(const SoAColumn& other) = delete;
+
+    void clear() {
+        for (size_t i = 0; i < count; i++)
+            items[i].~T();
+
+        count = 0;
+    }
+
+    void erase(size_t index) {
+        for (size_t i = index; i + 1 < count; i++)
+            items[i] = std::move(items[i + 1]);
+
+        items[--count].~T();
+    }
+
+    void push_back(const T& value) {
+        if (count == capacity)
+            reserve(capacity ? capacity * 2 : 16);
+
+        new (items + count) T(value);
+        count++;
+    }
+
+    void reserve(size_t newCapacity) {
+        if (newCapacity <= capacity)
+            return;
+
+        T* newItems = static_cast<T*>(::operator new(newCapacity * sizeof(T)));
+
+        for (size_t i = 0; i < count; i++) {
+            new (newItems + i) T(std::move(items[i]));
+            items[i].~T();
+        }
+
+        ::operator delete(items);
+        items = newItems;
+        capacity = newCapacity;
+    }
+
+    T* items;
+    size_t count;
+    size_t capacity;
+};
+
+// What SoAVector needs to know about one column; generated per field from its StaticField descriptor
+struct SoAColumnOps_t {
+    const char* name;
+    uint32_t systemFlags;
+    uint32_t kind;                  // KIND_*
+    size_t size;                    // sizeof one element
+    const void* typeTag;
+
+    void* (*create)(const void* copyFrom);
+    void (*destroy)(void* column);
+    void (*reserve)(void* column, size_t capacity);
+    void (*clear)(void* column);
+    void (*erase)(void* column, size_t index);
+    void (*pushBack)(void* column, const void* inst);
+    void (*load)(const void* column, size_t index, void* inst);
+    void (*store)(void* column, size_t index, const void* inst);
+    const void* (*data)(const void* column);
+};
+
+template <typename T>
+struct SoATypeTag {
+    static const char tag;
+};
+
+template <typename T>
+const char SoATypeTag<T>::tag = 0;
+
+template <class C, class Owner, typename T, T Owner::*member>
+struct SoAColumnOps {
+    typedef SoAColumn<T> Column;
+
+    static void* create(const void* copyFrom) {
+        return copyFrom ? new Column(*static_cast<const Column*>(copyFrom)) : new Column();
+    }
+
+    static void destroy(void* column) { delete static_cast<Column*>(column); }
+    static void reserve(void* column, size_t capacity) { static_cast<Column*>(column)->reserve(capacity); }
+    static void clear(void* column) { static_cast<Column*>(column)->clear(); }
+    static void erase(void* column, size_t index) { static_cast<Column*>(column)->erase(index); }
+
+    static void pushBack(void* column, const void* inst) {
+        static_cast<Column*>(column)->push_back(static_cast<const C*>(inst)->*member);
+    }
+
+    static void load(const void* column, size_t index, void* inst) {
+        static_cast<C*>(inst)->*member = static_cast<const Column*>(column)->items[index];
+    }
+
+    static void store(void* column, size_t index, const void* inst) {
+        static_cast<Column*>(column)->items[index] = static_cast<const C*>(inst)->*member;
+    }
+
+    static const void* data(const void* column) { return static_cast<const Column*>(column)->items; }
+
+    static SoAColumnOps_t ops(const char* name, uint32_t systemFlags) {
+        return SoAColumnOps_t { name, systemFlags, TypeKind<T>::value, sizeof(T), &SoATypeTag<T>::tag, &create, &destroy,
+                &reserve, &clear, &erase, &pushBack, &load, &store, &data };
+    }
+};
+
+template <class C>
+class SoAColumnTableBuilder {
+public:
+    explicit SoAColumnTableBuilder(std::vector<SoAColumnOps_t>& columns) : columns(columns) {}
+
+    template <class Owner, typename T, T Owner::*member>
+    void operator ()(const StaticField<Owner, T, member>& field) {
+        if (!(field.systemFlags & FIELD_DEPENDENCY))
+            columns.push_back(SoAColumnOps<C, Owner, T, member>::ops(field.name, field.systemFlags));
+    }
+
+    std::vector<SoAColumnOps_t>& columns;
+};
+
+// Struct-of-arrays container: each reflected field of C (dependencies excluded) lives in its own contiguous column,
+// so that a scan over one or two fields touches only their memory. Columns are always the same length;
+// push_back / erase / set scatter a C into them, get / operator[] gather it back.
+template <class C>
+class SoAVector {
+public:
+    typedef C value_type;
+
+    // proxy for one row
+    class Reference {
+    public:
+        Reference(SoAVector& vector, size_t index) : vector(vector), index(index) {}
+
+        template <class Owner, typename T>
+        T& get(T Owner::*member) const {
+            Span<T> column = vector.column(member);
+            assert(column.data != nullptr);
+            return column[index];
+        }
+
+        operator C() const { return vector.get(index); }
+        Reference& operator =(const C& value) { vector.set(index, value); return *this; }
+
+    private:
+        SoAVector& vector;
+        size_t index;
+    };
+
+    SoAVector() : count(0), capacity(0) {
+        const std::vector<SoAColumnOps_t>& table = columnTable();
+
+        for (size_t i = 0; i < table.size(); i++)
+            storage.push_back(table[i].create(nullptr));
+    }
+
+    SoAVector(const SoAVector& other) : count(other.count), capacity(other.count) {
+        const std::vector<SoAColumnOps_t>& table = columnTable();
+
+        for (size_t i = 0; i < table.size(); i++)
+            storage.push_back(table[i].create(other.storage[i]));
+    }
+
+    SoAVector(SoAVector&& other) : SoAVector() {
+        std::swap(storage, other.storage);
+        std::swap(count, other.count);
+        std::swap(capacity, other.capacity);
+    }
+
+    ~SoAVector() {
+        const std::vector<SoAColumnOps_t>& table = columnTable();
+
+        for (size_t i = 0; i < storage.size(); i++)
+            table[i].destroy(storage[i]);
+    }
+
+    SoAVector& operator =(SoAVector other) {
+        std::swap(storage, other.storage);
+        std::swap(count, other.count);
+        std::swap(capacity, other.capacity);
+        return *this;
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    void clear() {
+        for (size_t i = 0; i < storage.size(); i++)
+            columnTable()[i].clear(storage[i]);
+
+        count = 0;
+    }
+
+    void reserve(size_t newCapacity) {
+        if (newCapacity <= capacity)
+            return;
+
+        for (size_t i = 0; i < storage.size(); i++)
+            columnTable()[i].reserve(storage[i], newCapacity);
+
+        capacity = newCapacity;
+    }
+
+    void push_back(const C& value) {
+        const std::vector<SoAColumnOps_t>& table = columnTable();
+
+        // grow every column up front, so that a failed allocation cannot leave them with different lengths
+        if (count == capacity)
+            reserve(capacity ? capacity * 2 : 16);
+
+        for (size_t i = 0; i < storage.size(); i++)
+            table[i].pushBack(storage[i], &value);
+
+        count++;
+    }
+
+    void pop_back() { erase(count - 1); }
+
+    // removes a row, keeping the order of the remaining ones
+    void erase(size_t index) {
+        assert(index < count);
+
+        for (size_t i = 0; i < storage.size(); i++)
+            columnTable()[i].erase(storage[i], index);
+
+        count--;
+    }
+
+    C get(size_t index) const {
+        assert(index < count);
+
+        C value;
+
+        for (size_t i = 0; i < storage.size(); i++)
+            columnTable()[i].load(storage[i], index, &value);
+
+        return value;
+    }
+
+    void set(size_t index, const C& value) {
+        assert(index < count);
+
+        for (size_t i = 0; i < storage.size(); i++)
+            columnTable()[i].store(storage[i], index, &value);
+    }
+
+    Reference operator [](size_t index) { return Reference(*this, index); }
+    C operator [](size_t index) const { return get(index); }
+
+    // column of a member, e.g. column(&Sample::count)
+    template <class Owner, typename T>
+    Span<T> column(T Owner::*member) {
+        return columnAt<T>(columnIndexOf(member));
+    }
+
+    template <class Owner, typename T>
+    Span<const T> column(T Owner::*member) const {
+        Span<T> span = const_cast<SoAVector*>(this)->column(member);
+        return Span<const T> { span.data, span.size };
+    }
+
+    // column by field name; T must be the field type exactly (an empty span otherwise)
+    template <typename T>
+    Span<T> column(const char* name) {
+        const std::vector<SoAColumnOps_t>& table = columnTable();
+
+        for (size_t i = 0; i < table.size(); i++) {
+            if (strcmp(table[i].name, name) == 0)
+                return columnAt<T>((int) i);
+        }
+
+        return Span<T> { nullptr, 0 };
+    }
+
+    // untyped column storage, for code that dispatches on columnInfo(index).kind
+    const void* columnData(size_t index) const { return columnTable()[index].data(storage[index]); }
+
+    static size_t numColumns() { return columnTable().size(); }
+    static const SoAColumnOps_t& columnInfo(size_t index) { return columnTable()[index]; }
+
+    template <class Owner, typename T>
+    static int columnIndexOf(T Owner::*member) {
+        return dataFieldIndexOf<C>(member);
+    }
+
+private:
+    static const std::vector<SoAColumnOps_t>& columnTable() {
+        static const std::vector<SoAColumnOps_t> table = buildColumnTable();
+        return table;
+    }
+
+    static std::vector<SoAColumnOps_t> buildColumnTable() {
+        std::vector<SoAColumnOps_t> table;
+        SoAColumnTableBuilder<C> builder(table);
+        forEachStaticField<C>(builder);
+        return table;
+    }
+
+    template <typename T>
+    Span<T> columnAt(int index) {
+        if (index < 0 || columnTable()[index].typeTag != &SoATypeTag<T>::tag)
+            return Span<T> { nullptr, 0 };
+
+        return Span<T> { static_cast<SoAColumn<T>*>(storage[index])->items, count };
+    }
+
+    std::vector<void*> storage;
+    size_t count;
+    size_t capacity;
+};
+}
+#endif
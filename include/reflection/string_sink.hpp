@@ -0,0 +1,142 @@
+/*
+    Boost Software License - Version 1.0 - August 17, 2003
+
+    Permission is hereby granted, free of charge, to any person or organization
+    obtaining a copy of the software and accompanying documentation covered by
+    this license (the "Software") to use, reproduce, display, distribute,
+    execute, and transmit the Software, and to prepare derivative works of the
+    Software, and to permit third-parties to whom the Software is furnished to
+    do so, all subject to the following:
+
+    The copyright notices in the Software and this entire statement, including
+    the above license grant, this restriction and the following disclaimer,
+    must be included in all copies of the Software, in whole or in part, and
+    all derivative works of the Software, unless such copies or derivative
+    works are solely in the form of machine-executable object code generated by
+    a source language processor.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+    SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+    FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "base.hpp"
+
+#include <cstdio>
+
+namespace reflection {  // UUID('c3549467-1615-4087-9829-176a2dc44b76')
+
+// Appends to a malloc'd, NUL-terminated buffer (same representation as bufStringSet & co.), growing it geometrically
+class BufStringSink : public IStringSink {
+public:
+    // output starts at `offset`; anything before it is kept
+    BufStringSink(char*& buf, size_t& bufSize, size_t offset = 0) : buf(buf), bufSize(bufSize) {
+        setWindow(offset);
+    }
+
+    BufStringSink(BufString_t& str, size_t offset = 0) : buf(str.buf), bufSize(str.bufSize) {
+        setWindow(offset);
+    }
+
+    BufStringSink(const BufStringSink& other) = delete;
+    BufStringSink& operator =(const BufStringSink& other) = delete;
+
+    // NUL-terminates the output; the buffer is valid until the next append
+    bool terminate(IErrorHandler* err) {
+        if (buf == nullptr) {
+            if (!ensureSize(err, buf, bufSize, 1))
+                return false;
+
+            setWindow(0);
+        }
+
+        *pos = 0;
+        return true;
+    }
+
+    const char* data() const { return buf; }
+    size_t length() const { return buf != nullptr ? pos - buf : 0; }
+
+protected:
+    virtual bool overflow(IErrorHandler* err, const char* str, size_t strLen) override {
+        const size_t used = length();
+        size_t newBufSize = bufSize * 2;
+
+        if (newBufSize < used + strLen + 1)
+            newBufSize = used + strLen + 1;
+
+        if (!ensureSize(err, buf, bufSize, newBufSize))
+            return false;
+
+        memcpy(buf + used, str, strLen);
+        setWindow(used + strLen);
+        return true;
+    }
+
+private:
+    // one byte is always kept in reserve for the terminator
+    void setWindow(size_t offset) {
+        if (buf != nullptr) {
+            pos = buf + offset;
+            limit = buf + bufSize - 1;
+        }
+    }
+
+    char*& buf;
+    size_t& bufSize;
+};
+
+// Buffers output in a fixed inline block and writes it to a stdio stream whenever it fills up
+class FileStringSink : public IStringSink {
+public:
+    FileStringSink(FILE* file) : file(file) {
+        pos = buffer;
+        limit = buffer + sizeof(buffer);
+    }
+
+    FileStringSink(const FileStringSink& other) = delete;
+    FileStringSink& operator =(const FileStringSink& other) = delete;
+
+    ~FileStringSink() {
+        fwrite(buffer, 1, pos - buffer, file);
+    }
+
+    bool flush(IErrorHandler* err) {
+        if (!write(err, buffer, pos - buffer))
+            return false;
+
+        pos = buffer;
+        return true;
+    }
+
+protected:
+    virtual bool overflow(IErrorHandler* err, const char* str, size_t strLen) override {
+        if (!flush(err))
+            return false;
+
+        if (strLen >= sizeof(buffer))
+            return write(err, str, strLen);
+
+        memcpy(pos, str, strLen);
+        pos += strLen;
+        return true;
+    }
+
+private:
+    bool write(IErrorHandler* err, const char* str, size_t strLen) {
+        if (strLen > 0 && fwrite(str, 1, strLen, file) != strLen)
+            return err->error("IOError", "Failed to write to output stream."), false;
+
+        return true;
+    }
+
+    FILE* file;
+    char buffer[4096];
+};
+}
@@ -26,7 +26,10 @@
 
 #pragma once
 
+#include "charconv.hpp"
+#include "json.hpp"
 #include "magic.hpp"
+#include "msgpack.hpp"
 #include "serialization_manager.hpp"
 #include "serializer.hpp"
 
@@ -68,10 +71,30 @@ public:\
         type_& value = *reinterpret_cast<type_*>(p_value);\
         return template_::fromString(err, str, strLen, value);\
     }\
-    virtual bool toString(IErrorHandler* err, char*& buf, size_t& bufSize, uint32_t fieldMask,\
+    virtual bool toString(IErrorHandler* err, IStringSink* sink, uint32_t fieldMask,\
             const void* p_value) override {\
         type_ const& value = *reinterpret_cast<type_ const*>(p_value);\
-        return template_::toString(err, buf, bufSize, value);\
+        return template_::toString(err, sink, value);\
+    }\
+    virtual bool setFromJson(IErrorHandler* err, serialization::JsonReader* reader, uint32_t fieldMask,\
+            void* p_value) override {\
+        type_& value = *reinterpret_cast<type_*>(p_value);\
+        return serialization::JsonSerializer<type_>::deserialize(err, reader, value, fieldMask);\
+    }\
+    virtual bool toJson(IErrorHandler* err, serialization::JsonWriter* writer, uint32_t fieldMask,\
+            const void* p_value) override {\
+        type_ const& value = *reinterpret_cast<type_ const*>(p_value);\
+        return serialization::JsonSerializer<type_>::serialize(err, writer, value, fieldMask);\
+    }\
+    virtual bool setFromMsgPack(IErrorHandler* err, serialization::MsgPackReader* reader, uint32_t fieldMask,\
+            void* p_value) override {\
+        type_& value = *reinterpret_cast<type_*>(p_value);\
+        return serialization::MsgPackSerializer<type_>::deserialize(err, reader, value, fieldMask);\
+    }\
+    virtual bool toMsgPack(IErrorHandler* err, serialization::MsgPackWriter* writer, uint32_t fieldMask,\
+            const void* p_value) override {\
+        type_ const& value = *reinterpret_cast<type_ const*>(p_value);\
+        return serialization::MsgPackSerializer<type_>::serialize(err, writer, value, fieldMask);\
     }\
 };\
 
@@ -112,42 +135,36 @@ namespace reflection {  // UUID('c3549467-1615-4087-9829-176a2dc44b76')
 template <typename Bool_t>
 class BoolReflectionTemplate {
 public:
-    static int strcasecmp(const char* a, const char* b) {
-        int diff = tolower(*a) - tolower(*b);
+    static bool equalsIgnoreCase(const char* str, size_t strLen, const char* literal) {
+        for (size_t i = 0; i < strLen; i++, literal++)
+            if (*literal == 0 || tolower((unsigned char) str[i]) != *literal)
+                return false;
 
-        while (*a && *b && diff == 0) {
-            diff = tolower(*a) - tolower(*b);
-            a++;
-            b++;
-        }
-
-        return diff;
+        return *literal == 0;
     }
 
     static bool fromString(IErrorHandler* err, const char* str, size_t strLen, Bool_t& value_out) {
-        char* end;
-
-        if (strcasecmp(str, "true") == 0) {
+        if (equalsIgnoreCase(str, strLen, "true")) {
             value_out = true;
             return true;
         }
-        else if (strcasecmp(str, "false") == 0) {
+        else if (equalsIgnoreCase(str, strLen, "false")) {
             value_out = false;
             return true;
         }
 
-        long asLong = strtol(str, &end, 0);
+        long long asInt;
 
-        if (*end != 0)
+        if (parseIntegerLiteral(str, strLen, asInt) != PARSE_OK)
             return err->error("BooleanFormatError", "Specified value is not a valid boolean."), false;
 
-        value_out = (asLong != 0);
+        value_out = (asInt != 0);
         return true;
     }
 
-    static bool toString(IErrorHandler* err, char*& buf, size_t& bufSize, const Bool_t& value) {
-        return value ? bufStringSet(err, buf, bufSize, "true", 4)
-                : bufStringSet(err, buf, bufSize, "false", 5);
+    static bool toString(IErrorHandler* err, IStringSink* sink, const Bool_t& value) {
+        return value ? sink->append(err, "true", 4)
+                : sink->append(err, "false", 5);
     }
 };
 
@@ -157,46 +174,28 @@ public:
     typedef typename std::numeric_limits<Int_t> Limits;
 
     static bool fromString(IErrorHandler* err, const char* str, size_t strLen, Int_t& value_out) {
-        if (Limits::is_signed) {
-            char* end;
-            long asLong = strtol(str, &end, 0); // FIXME: actually check for overflow
+        switch (parseIntegerLiteral(str, strLen, value_out)) {
+            case PARSE_OK:
+                return true;
 
-            if (*end != 0)
-                return err->error("IntegerFormatError", "Specified value is not a valid integer."), false;
-
-            if (asLong < (long) Limits::min() || asLong > (long) Limits::max())
+            case PARSE_OUT_OF_RANGE:
                 return err->error("IntegerOverflow", "Value is outside the limit for this type."), false;
 
-            value_out = (Int_t) asLong;
-            return true;
-        }
-        else {
-            char* end;
-            unsigned long asULong = strtoul(str, &end, 0);  // FIXME: actually check for overflow
-
-            if (*end != 0)
+            default:
                 return err->error("IntegerFormatError", "Specified value is not a valid integer."), false;
-
-            if (asULong < (unsigned long) Limits::min() || asULong > (unsigned long) Limits::max())
-                return err->error("IntegerOverflow", "Value is outside the limit for this type."), false;
-
-            value_out = (Int_t) asULong;
-            return true;
         }
     }
 
-    static bool toString(IErrorHandler* err, char*& buf, size_t& bufSize, const Int_t& value) {
-#ifdef _MSC_VER
-        if (Limits::is_signed)
-            return bufStringPrintf(err, buf, bufSize, "%I64d", (int64_t) value);
-        else
-            return bufStringPrintf(err, buf, bufSize, "%I64u", (uint64_t) value);
-#else
+    static bool toString(IErrorHandler* err, IStringSink* sink, const Int_t& value) {
+        char buf[MAX_INT_CHARS];
+        size_t length;
+
         if (Limits::is_signed)
-            return bufStringPrintf(err, buf, bufSize, "%lld", (long long) value);
+            length = formatInt(buf, (int64_t) value);
         else
-            return bufStringPrintf(err, buf, bufSize, "%llu", (unsigned long long) value);
-#endif
+            length = formatUInt(buf, (uint64_t) value);
+
+        return sink->append(err, buf, length);
     }
 };
 
@@ -204,18 +203,30 @@ template <typename Float_t>
 class FloatReflectionTemplate {
 public:
     static bool fromString(IErrorHandler* err, const char* str, size_t strLen, Float_t& value_out) {
-        char* end;
-        double asDouble = strtod(str, &end);
+        switch (parseFloat(str, strLen, value_out)) {
+            case PARSE_OK:
+                return true;
 
-        if (*end != 0)
-            return err->error("FloatFormatError", "Specified value is not a valid decimal value."), false;
+            case PARSE_OUT_OF_RANGE:
+                return err->error("FloatOverflow", "Value is outside the limit for this type."), false;
 
-        value_out = (Float_t) asDouble;
-        return true;
+            default:
+                return err->error("FloatFormatError", "Specified value is not a valid decimal value."), false;
+        }
     }
 
-    static bool toString(IErrorHandler* err, char*& buf, size_t& bufSize, const Float_t& value) {
-        return bufStringPrintf(err, buf, bufSize, "%g", (double) value);
+    // shortest text that parses back to the same value
+    static bool toString(IErrorHandler* err, IStringSink* sink, const Float_t& value) {
+        if (value != value)
+            return sink->append(err, "nan", 3);
+        else if (value == std::numeric_limits<Float_t>::infinity())
+            return sink->append(err, "inf", 3);
+        else if (value == -std::numeric_limits<Float_t>::infinity())
+            return sink->append(err, "-inf", 4);
+
+        char buf[MAX_FLOAT_CHARS];
+        size_t length = (sizeof(Float_t) == sizeof(float)) ? formatFloat(buf, (float) value) : formatDouble(buf, (double) value);
+        return sink->append(err, buf, length);
     }
 };
 }
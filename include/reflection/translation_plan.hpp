@@ -0,0 +1,574 @@
+/*
+    Boost Software License - Version 1.0 - August 17, 2003
+
+    Permission is hereby granted, free of charge, to any person or organization
+    obtaining a copy of the software and accompanying documentation covered by
+    this license (the "Software") to use, reproduce, display, distribute,
+    execute, and transmit the Software, and to prepare derivative works of the
+    Software, and to permit third-parties to whom the Software is furnished to
+    do so, all subject to the following:
+
+    The copyright notices in the Software and this entire statement, including
+    the above license grant, this restriction and the following disclaimer,
+    must be included in all copies of the Software, in whole or in part, and
+    all derivative works of the Software, unless such copies or derivative
+    works are solely in the form of machine-executable object code generated by
+    a source language processor.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+    SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+    FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "buffer_io.hpp"
+#include "field_index.hpp"
+#include "registry.hpp"
+#include "schema_provider.hpp"
+
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace reflection {  // UUID('c3549467-1615-4087-9829-176a2dc44b76')
+
+enum {
+    XOP_SKIP_BYTES,         // removed fixed-size fields: skip `size` bytes
+    XOP_SKIP_SMV,
+    XOP_SKIP_UTF8,
+    XOP_SKIP_CLASS,         // removed nested class: runs `nested`, which only skips
+    XOP_BYTES,              // unchanged representation: read `size` bytes in place (chars, floats and runs of them)
+    XOP_BOOL,
+    XOP_CHAR_TO_INT,        // 8-bit integer into a wider one, extended according to the signedness of the new field
+    XOP_SMV_TO_INT,         // any integer into any other, range-checked
+    XOP_SMV_TO_REAL,
+    XOP_REAL32_TO_REAL64,
+    XOP_STRING,             // std::string
+    XOP_CLASS,              // nested class: runs `nested`
+    XOP_DYNAMIC,            // any other field whose type tag didn't change, through ITypeReflection
+};
+
+class TranslationPlan;
+
+struct TranslationOp_t {
+    uint32_t code;                          // XOP_*
+    uint32_t kind;                          // KIND_* of the new field
+    uint32_t size;                          // XOP_BYTES, XOP_SKIP_BYTES: number of bytes
+    ptrdiff_t offset;                       // field = instance + offset, unless `getter` is set
+    ptrdiff_t baseOffset;                   // field = getter(instance + baseOffset)
+    void* (*getter)(const void*);
+
+    union {
+        ITypeReflection* refl;              // XOP_DYNAMIC
+        TranslationPlan const* nested;      // XOP_CLASS, XOP_SKIP_CLASS
+    };
+};
+
+// Reads instances written with an older schema of a class into the current one. Fields are matched by name once,
+// when the plan is built: removed fields are skipped, added ones are left as they are (so read into a freshly
+// constructed instance to get their defaults) and fields whose type changed are converted where that is cheap and
+// exact enough (integer widths, float -> double), or otherwise treated as removed + added.
+// If nothing changed and no integers are involved, the plan just runs the class's BinaryProgram.
+class TranslationPlan {
+public:
+    explicit TranslationPlan(FieldSet_t const* target)
+            : targetFields(target), program(nullptr), numSkippedFields(0), numDefaultedFields(0) {}
+
+    TranslationPlan(const TranslationPlan& other) = delete;
+    TranslationPlan& operator =(const TranslationPlan& other) = delete;
+
+    bool deserialize(IErrorHandler* err, serialization::IReader* reader, void* inst) const {
+        if (program != nullptr)
+            return program->deserialize(err, reader, inst);
+
+        for (const TranslationOp_t& op : ops) {
+            void* p = (inst != nullptr) ? address(op, reinterpret_cast<const uint8_t*>(inst)) : nullptr;
+
+            switch (op.code) {
+                case XOP_SKIP_BYTES:
+                    if (!skip(err, reader, op.size))
+                        return false;
+                    break;
+
+                case XOP_SKIP_SMV: {
+                    bool negative;
+                    uint64_t magnitude;
+
+                    if (!serialization::readSmv(err, reader, negative, magnitude))
+                        return false;
+                    break;
+                }
+
+                case XOP_SKIP_UTF8: {
+                    uint64_t length;
+
+                    if (!serialization::SmvIntSerializer<uint64_t>::deserializeValue(err, reader, length)
+                            || !skip(err, reader, length))
+                        return false;
+                    break;
+                }
+
+                case XOP_SKIP_CLASS:
+                    if (!op.nested->deserialize(err, reader, nullptr))
+                        return false;
+                    break;
+
+                case XOP_BYTES:
+                    if (!reader->read(err, p, op.size))
+                        return false;
+                    break;
+
+                case XOP_BOOL:
+                    if (!serialization::Serializer<bool>::deserialize(err, reader, *reinterpret_cast<bool*>(p)))
+                        return false;
+                    break;
+
+                case XOP_CHAR_TO_INT: {
+                    uint8_t byte;
+
+                    if (!reader->read(err, &byte, 1))
+                        return false;
+
+                    bool negative = isSigned(op.kind) && (byte & 0x80);
+
+                    if (!storeInteger(err, op.kind, p, negative, negative ? (uint64_t)(256 - byte) : byte))
+                        return false;
+                    break;
+                }
+
+                case XOP_SMV_TO_INT:
+                case XOP_SMV_TO_REAL: {
+                    bool negative;
+                    uint64_t magnitude;
+
+                    if (!serialization::readSmv(err, reader, negative, magnitude))
+                        return false;
+
+                    if (op.code == XOP_SMV_TO_INT) {
+                        if (!storeInteger(err, op.kind, p, negative, magnitude))
+                            return false;
+                    }
+                    else if (op.kind == KIND_FLOAT)
+                        store<float>(p, negative ? -(float) magnitude : (float) magnitude);
+                    else
+                        store<double>(p, negative ? -(double) magnitude : (double) magnitude);
+                    break;
+                }
+
+                case XOP_REAL32_TO_REAL64: {
+                    float value;
+
+                    if (!reader->read(err, &value, sizeof(value)))
+                        return false;
+
+                    store<double>(p, value);
+                    break;
+                }
+
+                case XOP_STRING:
+                    if (!serialization::Serializer<std::string>::deserialize(err, reader, *reinterpret_cast<std::string*>(p)))
+                        return false;
+                    break;
+
+                case XOP_CLASS:
+                    if (!op.nested->deserialize(err, reader, p))
+                        return false;
+                    break;
+
+                default:
+                    if (!op.refl->deserialize(err, reader, p))
+                        return false;
+            }
+        }
+
+        return true;
+    }
+
+    FieldSet_t const* target() const { return targetFields; }
+
+    // true if the old schema is the current one, nested classes included, and has no integer fields
+    bool isIdentity() const { return program != nullptr; }
+
+    // fields of the old schema that are read and dropped, fields of the new class that aren't touched
+    size_t numSkipped() const { return numSkippedFields; }
+    size_t numDefaulted() const { return numDefaultedFields; }
+
+    size_t count() const { return ops.size(); }
+    const TranslationOp_t& operator [](size_t index) const { return ops[index]; }
+
+private:
+    friend class TranslationPlanCache;
+
+    static bool isSigned(uint32_t kind) {
+        return kind == KIND_INT8 || kind == KIND_INT16 || kind == KIND_INT32 || kind == KIND_INT64;
+    }
+
+    template <typename T>
+    static void store(void* p, T value) {
+        memcpy(p, &value, sizeof(value));
+    }
+
+    template <typename T>
+    static bool storeSigned(IErrorHandler* err, void* p, bool negative, uint64_t magnitude) {
+        const uint64_t limit = (uint64_t) std::numeric_limits<T>::max() + (negative ? 1 : 0);
+
+        if (magnitude > limit)
+            return err->error("IntegerOverflow", "Value is outside the limit for this type."), false;
+
+        // two's complement negation in uint64_t, so that the most negative value doesn't overflow
+        store<T>(p, (T)(negative ? 0 - magnitude : magnitude));
+        return true;
+    }
+
+    template <typename T>
+    static bool storeUnsigned(IErrorHandler* err, void* p, bool negative, uint64_t magnitude) {
+        if ((negative && magnitude != 0) || magnitude > (uint64_t) std::numeric_limits<T>::max())
+            return err->error("IntegerOverflow", "Value is outside the limit for this type."), false;
+
+        store<T>(p, (T) magnitude);
+        return true;
+    }
+
+    // fields are accessed by size and signedness only, as in BinaryProgram
+    static bool storeInteger(IErrorHandler* err, uint32_t kind, void* p, bool negative, uint64_t magnitude) {
+        switch (kind) {
+            case KIND_INT8:     return storeSigned<int8_t>(err, p, negative, magnitude);
+            case KIND_INT16:    return storeSigned<int16_t>(err, p, negative, magnitude);
+            case KIND_INT32:    return storeSigned<int32_t>(err, p, negative, magnitude);
+            case KIND_INT64:    return storeSigned<int64_t>(err, p, negative, magnitude);
+            case KIND_UINT8:    return storeUnsigned<uint8_t>(err, p, negative, magnitude);
+            case KIND_UINT16:   return storeUnsigned<uint16_t>(err, p, negative, magnitude);
+            case KIND_UINT32:   return storeUnsigned<uint32_t>(err, p, negative, magnitude);
+            default:            return storeUnsigned<uint64_t>(err, p, negative, magnitude);
+        }
+    }
+
+    static bool skip(IErrorHandler* err, serialization::IReader* reader, uint64_t count) {
+        uint8_t scratch[256];
+
+        while (count > 0) {
+            size_t chunk = (count < sizeof(scratch)) ? (size_t) count : sizeof(scratch);
+
+            if (!reader->read(err, scratch, chunk))
+                return false;
+
+            count -= chunk;
+        }
+
+        return true;
+    }
+
+    static void* address(const TranslationOp_t& op, const uint8_t* inst) {
+        if (op.getter != nullptr)
+            return op.getter(inst + op.baseOffset);
+
+        return const_cast<uint8_t*>(inst + op.offset);
+    }
+
+    void append(const TranslationOp_t& op) {
+        if (!ops.empty()) {
+            TranslationOp_t& last = ops.back();
+
+            // merge consecutive skips, and raw reads into fields that are adjacent in memory
+            if (op.code == XOP_SKIP_BYTES && last.code == XOP_SKIP_BYTES) {
+                last.size += op.size;
+                return;
+            }
+
+            if (op.code == XOP_BYTES && last.code == XOP_BYTES && op.getter == nullptr && last.getter == nullptr
+                    && last.offset + (ptrdiff_t) last.size == op.offset) {
+                last.size += op.size;
+                return;
+            }
+        }
+
+        ops.push_back(op);
+    }
+
+    FieldSet_t const* targetFields;         // nullptr for a plan that only skips
+    serialization::BinaryProgram const* program;
+    std::vector<TranslationOp_t> ops;
+    size_t numSkippedFields;
+    size_t numDefaultedFields;
+};
+
+// Builds and owns translation plans, one per (old class id, current class) pair; nested classes share plans too.
+// Old schemas come from the provider, which should be a SchemaCache (or otherwise cache parsed schemas) when
+// archives mix many versions.
+class TranslationPlanCache {
+public:
+    enum { MAX_DEPTH = 64 };
+
+    explicit TranslationPlanCache(ISchemaProvider* sp) : sp(sp) {}
+
+    // nullptr (with the error reported) if there is no schema for oldClassId or it can't be translated
+    const TranslationPlan* planFor(const char* oldClassId, FieldSet_t const* target) {
+        return planFor(oldClassId, target, 0);
+    }
+
+    template <class C>
+    const TranslationPlan* planFor(const char* oldClassId) {
+        return planFor(oldClassId, fieldSetOfClass<C>(), 0);
+    }
+
+    size_t count() const { return plans.size(); }
+
+private:
+    enum { PLAN_BUILDING, PLAN_READY, PLAN_FAILED };
+    enum { CONVERT_OK, CONVERT_INCOMPATIBLE, CONVERT_FAILED };
+
+    struct Entry_t {
+        int state;
+        std::unique_ptr<TranslationPlan> plan;
+    };
+
+    typedef std::pair<std::string, FieldSet_t const*> Key_t;
+
+    // the tag a field is written with, as in its .class_schema
+    static serialization::Tag_t tagOf(const Field_t& field) {
+        serialization::BufferWriter writer;
+
+        if (!field.refl->serializeTypeInformation(err, &writer, nullptr) || writer.size() == 0)
+            return serialization::TAG_NO_TYPE;
+
+        return *reinterpret_cast<const uint8_t*>(writer.data());
+    }
+
+    const TranslationPlan* planFor(const char* oldClassId, FieldSet_t const* target, int depth) {
+        Key_t key(oldClassId, target);
+        auto it = plans.find(key);
+
+        if (it != plans.end()) {
+            if (it->second.state == PLAN_BUILDING)
+                return err->errorf("SchemaMismatch", "Class `%s` contains itself.", oldClassId), nullptr;
+
+            return it->second.plan.get();
+        }
+
+        if (depth > MAX_DEPTH)
+            return err->errorf("SchemaMismatch", "Classes nested more than %d levels deep.", (int) MAX_DEPTH), nullptr;
+
+        ParsedSchema_t storage;
+        const ParsedSchema_t* schema;
+
+        if (!getClassSchema(sp, oldClassId, storage, schema))
+            return nullptr;
+
+        if (schema == nullptr)
+            return err->errorf("SchemaMismatch", "No schema for class `%s`.", oldClassId), nullptr;
+
+        Entry_t& entry = plans[key];
+        entry.state = PLAN_BUILDING;
+        entry.plan.reset(new TranslationPlan(target));
+
+        // `entry` stays valid: std::map never moves its elements
+        if (!build(*entry.plan, oldClassId, *schema, depth)) {
+            entry.state = PLAN_FAILED;
+            entry.plan.reset();
+            return nullptr;
+        }
+
+        entry.state = PLAN_READY;
+        return entry.plan.get();
+    }
+
+    bool build(TranslationPlan& plan, const char* oldClassId, const ParsedSchema_t& schema, int depth) {
+        using namespace serialization;
+
+        FieldSet_t const* target = plan.targetFields;
+        FlatFieldTable_t const* table = (target != nullptr) ? target->flattened() : nullptr;
+
+        if (target != nullptr && table == nullptr)
+            return false;
+
+        std::vector<bool> used(table != nullptr ? table->count : 0, false);
+
+        // identity: the old fields are exactly the serialized fields of the new class, in the same order and with
+        // the same tags. Integers never qualify: every width is written as TAG_SMVINT, so the old width is unknown
+        // and only XOP_SMV_TO_INT range-checks the value (BinaryProgram truncates it).
+        bool identical = (target != nullptr);
+        size_t position = 0;
+
+        for (const SchemaField_t& oldField : schema.fields) {
+            int index = (target != nullptr) ? target->nameIndex()->find(oldField.name.c_str(), oldField.name.size()) : -1;
+            const FlatField_t* entry = nullptr;
+
+            if (index >= 0 && !used[index] && !(table->entries[index].field->systemFlags & FIELD_DEPENDENCY))
+                entry = &table->entries[index];
+
+            while (table != nullptr && position < table->count && (table->entries[position].field->systemFlags & FIELD_DEPENDENCY))
+                position++;
+
+            TranslationOp_t op;
+            op.size = 0;
+            op.refl = nullptr;
+
+            int result = (entry != nullptr) ? convert(op, oldField, *entry, depth) : CONVERT_INCOMPATIBLE;
+
+            if (result == CONVERT_FAILED)
+                return false;
+
+            if (result == CONVERT_OK) {
+                used[index] = true;
+                identical = identical && (size_t) index == position && tagOf(*entry->field) == oldField.tag
+                        && op.code != XOP_SMV_TO_INT && (op.code != XOP_CLASS || op.nested->isIdentity());
+            }
+            else {
+                if (!skipOp(op, oldClassId, oldField, depth))
+                    return false;
+
+                plan.numSkippedFields++;
+                identical = false;
+            }
+
+            position++;
+            plan.append(op);
+        }
+
+        if (table != nullptr) {
+            for (size_t i = 0; i < table->count; i++) {
+                if (!used[i] && !(table->entries[i].field->systemFlags & FIELD_DEPENDENCY)) {
+                    plan.numDefaultedFields++;
+                    identical = false;
+                }
+            }
+        }
+
+        // the ops still work if the class's own program is unavailable
+        if (identical) {
+            plan.program = target->binaryProgram();
+
+            if (plan.program != nullptr)
+                plan.ops.clear();
+        }
+
+        return true;
+    }
+
+    // reads an old field into `entry`, if the types are compatible; CONVERT_FAILED means a nested plan failed
+    int convert(TranslationOp_t& op, const SchemaField_t& oldField, const FlatField_t& entry, int depth) {
+        using namespace serialization;
+
+        const Field_t& field = *entry.field;
+        const uint32_t kind = field.kind;
+        const bool isInteger = (kind >= KIND_INT8 && kind <= KIND_UINT64);
+        const bool isReal = (kind == KIND_FLOAT || kind == KIND_DOUBLE);
+
+        op.kind = kind;
+
+        if (field.systemFlags & FIELD_HAS_OFFSET) {
+            op.offset = entry.offset;
+            op.baseOffset = 0;
+            op.getter = nullptr;
+        }
+        else {
+            op.offset = 0;
+            op.baseOffset = entry.baseOffset;
+            op.getter = field.fieldGetter;
+        }
+
+        switch (oldField.tag) {
+            case TAG_BOOL:
+                if (kind == KIND_BOOL)
+                    return op.code = XOP_BOOL, CONVERT_OK;
+                break;
+
+            case TAG_CHAR:
+                if (kind == KIND_INT8 || kind == KIND_UINT8)
+                    return op.code = XOP_BYTES, op.size = 1, CONVERT_OK;
+                if (isInteger)
+                    return op.code = XOP_CHAR_TO_INT, CONVERT_OK;
+                break;
+
+            case TAG_SMVINT:
+                if (isInteger)
+                    return op.code = XOP_SMV_TO_INT, CONVERT_OK;
+                if (isReal)
+                    return op.code = XOP_SMV_TO_REAL, CONVERT_OK;
+                break;
+
+            case TAG_REAL32:
+                if (kind == KIND_FLOAT)
+                    return op.code = XOP_BYTES, op.size = sizeof(float), CONVERT_OK;
+                if (kind == KIND_DOUBLE)
+                    return op.code = XOP_REAL32_TO_REAL64, CONVERT_OK;
+                break;
+
+            case TAG_REAL64:
+                if (kind == KIND_DOUBLE)
+                    return op.code = XOP_BYTES, op.size = sizeof(double), CONVERT_OK;
+                break;
+
+            case TAG_UTF8:
+                if (kind == KIND_STRING)
+                    return op.code = XOP_STRING, CONVERT_OK;
+                break;
+
+            case TAG_CLASS:
+                if (kind == KIND_CLASS) {
+                    op.code = XOP_CLASS;
+                    op.nested = planFor(oldField.fieldClassName.c_str(), field.classFields(), depth + 1);
+                    return (op.nested != nullptr) ? CONVERT_OK : CONVERT_FAILED;
+                }
+                break;
+        }
+
+        // anything else (vectors, custom types) must keep its tag and is trusted to keep its encoding
+        if (oldField.tag != TAG_CLASS && tagOf(field) == oldField.tag) {
+            op.code = XOP_DYNAMIC;
+            op.refl = field.refl;
+            return CONVERT_OK;
+        }
+
+        return CONVERT_INCOMPATIBLE;
+    }
+
+    bool skipOp(TranslationOp_t& op, const char* oldClassId, const SchemaField_t& oldField, int depth) {
+        using namespace serialization;
+
+        op.kind = KIND_OTHER;
+        op.offset = 0;
+        op.baseOffset = 0;
+        op.getter = nullptr;
+
+        switch (oldField.tag) {
+            case TAG_BOOL:
+            case TAG_CHAR:      op.code = XOP_SKIP_BYTES; op.size = 1; return true;
+            case TAG_REAL32:    op.code = XOP_SKIP_BYTES; op.size = sizeof(float); return true;
+            case TAG_REAL64:    op.code = XOP_SKIP_BYTES; op.size = sizeof(double); return true;
+            case TAG_SMVINT:    op.code = XOP_SKIP_SMV; return true;
+            case TAG_UTF8:      op.code = XOP_SKIP_UTF8; return true;
+
+            case TAG_CLASS:
+                op.code = XOP_SKIP_CLASS;
+                op.nested = planFor(oldField.fieldClassName.c_str(), nullptr, depth + 1);
+                return op.nested != nullptr;
+
+            default:
+                // arrays are written without their element type, so their length in bytes is unknown
+                return err->errorf("SchemaMismatch", "Field `%s` of `%s` (tag %02X) was removed or changed type, "
+                        "but values of this type cannot be skipped.", oldField.name.c_str(), oldClassId, oldField.tag),
+                        false;
+        }
+    }
+
+    ISchemaProvider* sp;
+    std::map<Key_t, Entry_t> plans;
+};
+
+// Reads an instance written with the schema `plan` was built for (see TranslationPlanCache::planFor<T>)
+template <typename T>
+bool reflectDeserializeTranslated(T& value_out, serialization::IReader* reader, const TranslationPlan* plan) {
+    assert(plan->target() == fieldSetOfClass<T>());
+
+    return plan->deserialize(err, reader, reinterpret_cast<void*>(&value_out));
+}
+}
@@ -0,0 +1,290 @@
+/*
+    Boost Software License - Version 1.0 - August 17, 2003
+
+    Permission is hereby granted, free of charge, to any person or organization
+    obtaining a copy of the software and accompanying documentation covered by
+    this license (the "Software") to use, reproduce, display, distribute,
+    execute, and transmit the Software, and to prepare derivative works of the
+    Software, and to permit third-parties to whom the Software is furnished to
+    do so, all subject to the following:
+
+    The copyright notices in the Software and this entire statement, including
+    the above license grant, this restriction and the following disclaimer,
+    must be included in all copies of the Software, in whole or in part, and
+    all derivative works of the Software, unless such copies or derivative
+    works are solely in the form of machine-executable object code generated by
+    a source language processor.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+    SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+    FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "magic.hpp"
+#include "translation_plan.hpp"
+
+namespace reflection {  // UUID('c3549467-1615-4087-9829-176a2dc44b76')
+
+// Checks that a buffer holds a well-formed serialized instance (integers encoded within range of their fields,
+// string and array lengths within the buffer, booleans 0 or 1, nested classes complete) without creating any object
+// or allocating. Meant for untrusted input, ahead of reflectDeserialize.
+class StructuralValidator {
+public:
+    StructuralValidator(IErrorHandler* err, const uint8_t* pos, const uint8_t* end)
+            : err(err), begin(pos), pos(pos), end(end) {}
+
+    // the layout reflectSerialize writes for a class, as compiled into its BinaryProgram
+    bool validate(serialization::BinaryProgram const* program) {
+        using namespace serialization;
+
+        for (size_t i = 0; i < program->count(); i++) {
+            const BinaryOp_t& op = (*program)[i];
+
+            switch (op.code) {
+                case OP_BYTES:
+                    if (!skip(op.size))
+                        return false;
+                    break;
+
+                case OP_BOOL:
+                    if (!validateBool())
+                        return false;
+                    break;
+
+                case OP_SMV_INT16:
+                case OP_SMV_INT32:
+                case OP_SMV_INT64:
+                case OP_SMV_UINT16:
+                case OP_SMV_UINT32:
+                case OP_SMV_UINT64:
+                    if (!validateInteger(op.kind))
+                        return false;
+                    break;
+
+                case OP_STRING:
+                    if (!validateString())
+                        return false;
+                    break;
+
+                case OP_CLASS:
+                    if (!validate(op.program))
+                        return false;
+                    break;
+
+                default:
+                    if (op.kind != KIND_VECTOR)
+                        return unknownType(op.refl->staticTypeName());
+
+                    if (!validateVector(op.elementKind, op.refl))
+                        return false;
+            }
+        }
+
+        return true;
+    }
+
+    // the layout described by an old schema, as a plan that only skips (TranslationPlanCache::planFor(classId, nullptr));
+    // fixed-size values are only checked for presence, since the schema doesn't record integer widths
+    bool validate(const TranslationPlan* plan) {
+        for (size_t i = 0; i < plan->count(); i++) {
+            const TranslationOp_t& op = (*plan)[i];
+            bool negative = false;
+            uint64_t magnitude = 0;
+
+            switch (op.code) {
+                case XOP_SKIP_BYTES:
+                    if (!skip(op.size))
+                        return false;
+                    break;
+
+                case XOP_SKIP_SMV:
+                    if (!readSmv(negative, magnitude))
+                        return false;
+                    break;
+
+                case XOP_SKIP_UTF8:
+                    if (!validateString())
+                        return false;
+                    break;
+
+                case XOP_SKIP_CLASS:
+                    if (!validate(op.nested))
+                        return false;
+                    break;
+
+                default:
+                    return err->error("IncorrectType", "Validation needs a plan built without a target class."), false;
+            }
+        }
+
+        return true;
+    }
+
+    size_t offset() const { return pos - begin; }
+
+    IErrorHandler* err;
+    const uint8_t* begin;
+    const uint8_t* pos;
+    const uint8_t* end;
+
+private:
+    bool truncated() {
+        return err->unexpectedEndOfInput(":buffer"), false;
+    }
+
+    bool unknownType(const char* typeName) {
+        return err->errorf("UnknownType", "Values of type `%s` cannot be validated.", typeName), false;
+    }
+
+    bool overflow() {
+        return err->errorf("IntegerOverflow", "Value before offset %u is outside the limit for this type.",
+                (unsigned int) offset()), false;
+    }
+
+    bool skip(uint64_t count) {
+        if (count > (uint64_t)(end - pos))
+            return truncated();
+
+        pos += count;
+        return true;
+    }
+
+    bool validateBool() {
+        if (pos == end)
+            return truncated();
+
+        if (*pos > 1)
+            return err->errorf("IncorrectType", "Invalid boolean 0x%02X at offset %u.", *pos, (unsigned int) offset()),
+                    false;
+
+        pos++;
+        return true;
+    }
+
+    bool readSmv(bool& negative_out, uint64_t& magnitude_out) {
+        switch (serialization::readSmv(pos, end, negative_out, magnitude_out)) {
+            case serialization::SMV_OK:         return true;
+            case serialization::SMV_TRUNCATED:  return truncated();
+            default:                            return overflow();
+        }
+    }
+
+    bool validateInteger(uint32_t kind) {
+        bool negative = false;
+        uint64_t magnitude = 0, limit;
+
+        if (!readSmv(negative, magnitude))
+            return false;
+
+        switch (kind) {
+            case KIND_INT8:     limit = INT8_MAX + (uint64_t) negative; break;
+            case KIND_INT16:    limit = INT16_MAX + (uint64_t) negative; break;
+            case KIND_INT32:    limit = INT32_MAX + (uint64_t) negative; break;
+            case KIND_INT64:    limit = INT64_MAX + (uint64_t) negative; break;
+            case KIND_UINT8:    limit = negative ? 0 : UINT8_MAX; break;
+            case KIND_UINT16:   limit = negative ? 0 : UINT16_MAX; break;
+            case KIND_UINT32:   limit = negative ? 0 : UINT32_MAX; break;
+            default:            limit = negative ? 0 : UINT64_MAX; break;
+        }
+
+        return (magnitude <= limit) || overflow();
+    }
+
+    bool readLength(uint64_t& length_out) {
+        bool negative = false;
+
+        if (!readSmv(negative, length_out))
+            return false;
+
+        if (negative && length_out != 0)
+            return overflow();
+
+        return true;
+    }
+
+    bool validateString() {
+        uint64_t length = 0;
+        return readLength(length) && skip(length);
+    }
+
+    // std::vector<T>: SmvInt length + items, see Serializer<std::vector<T>>
+    bool validateVector(uint32_t elementKind, ITypeReflection* refl) {
+        uint64_t length = 0;
+        size_t elementSize;
+
+        switch (elementKind) {
+            case KIND_INT8:
+            case KIND_UINT8:    elementSize = 1; break;
+            case KIND_FLOAT:    elementSize = sizeof(float); break;
+            case KIND_DOUBLE:   elementSize = sizeof(double); break;
+            case KIND_BOOL:
+            case KIND_INT16: case KIND_INT32: case KIND_INT64:
+            case KIND_UINT16: case KIND_UINT32: case KIND_UINT64:
+            case KIND_STRING:   elementSize = 0; break;
+            default:            return unknownType(refl->staticTypeName());
+        }
+
+        if (!readLength(length))
+            return false;
+
+        // every element takes at least one byte, so a hostile length fails here rather than after a long loop
+        if (length > (uint64_t)(end - pos))
+            return truncated();
+
+        if (elementSize != 0)
+            return (length <= (uint64_t)(end - pos) / elementSize) ? skip(length * elementSize) : truncated();
+
+        for (uint64_t i = 0; i < length; i++) {
+            bool ok;
+
+            switch (elementKind) {
+                case KIND_BOOL:     ok = validateBool(); break;
+                case KIND_STRING:   ok = validateString(); break;
+                default:            ok = validateInteger(elementKind);
+            }
+
+            if (!ok)
+                return false;
+        }
+
+        return true;
+    }
+};
+
+// Checks that `reader` starts with a well-formed instance of the class, as written by reflectSerialize, and moves
+// past it; on failure the error is reported and the reader is left where it was. Whether anything follows the
+// instance is up to the caller (reader.remaining()).
+inline bool reflectValidate(serialization::BufferReader& reader, FieldSet_t const* fieldSet) {
+    StructuralValidator validator(err, reader.pos, reader.end);
+    serialization::BinaryProgram const* program = fieldSet->binaryProgram();
+
+    if (program == nullptr || !validator.validate(program))
+        return false;
+
+    reader.pos = validator.pos;
+    return true;
+}
+
+template <class C>
+bool reflectValidate(serialization::BufferReader& reader) {
+    return reflectValidate(reader, fieldSetOfClass<C>());
+}
+
+// The same against an old schema, for data that will be read with a TranslationPlan. Build the plan once:
+//     const TranslationPlan* plan = plans.planFor(classId, nullptr);
+inline bool reflectValidate(serialization::BufferReader& reader, const TranslationPlan* plan) {
+    StructuralValidator validator(err, reader.pos, reader.end);
+
+    if (!validator.validate(plan))
+        return false;
+
+    reader.pos = validator.pos;
+    return true;
+}
+}
@@ -0,0 +1,253 @@
+/*
+    Boost Software License - Version 1.0 - August 17, 2003
+
+    Permission is hereby granted, free of charge, to any person or organization
+    obtaining a copy of the software and accompanying documentation covered by
+    this license (the "Software") to use, reproduce, display, distribute,
+    execute, and transmit the Software, and to prepare derivative works of the
+    Software, and to permit third-parties to whom the Software is furnished to
+    do so, all subject to the following:
+
+    The copyright notices in the Software and this entire statement, including
+    the above license grant, this restriction and the following disclaimer,
+    must be included in all copies of the Software, in whole or in part, and
+    all derivative works of the Software, unless such copies or derivative
+    works are solely in the form of machine-executable object code generated by
+    a source language processor.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+    SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+    FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+*/
+
+#pragma once
+
+#include "api.hpp"
+#include "buffer_io.hpp"
+#include "field_index.hpp"
+
+namespace serialization {
+
+// Indexed instance layout (opt-in, see reflectSerializeIndexed):
+//   uint32 numFields
+//   uint32 fieldEnd[numFields]     end of each field's encoding, relative to the start of field data
+//   field data...                  each field encoded exactly as by InstanceSerializer
+// The table lets a reader jump straight to any field instead of decoding everything before it.
+template <class C>
+class IndexedInstanceSerializer {
+public:
+    enum { HEADER_SIZE = 4, ENTRY_SIZE = 4 };
+
+    // `scratch` holds the table and the field data until both are complete; reusing it across instances avoids
+    // allocating per instance
+    template <typename Fields>
+    static bool serializeInstance(IErrorHandler* err, IWriter* writer, const Fields& fields, BufferWriter& scratch) {
+        const size_t numFields = fields.count();
+        const size_t tableSize = HEADER_SIZE + numFields * ENTRY_SIZE;
+
+        scratch.clear();
+
+        if (!reflection::ensureSize(err, scratch.buf, scratch.bufSize, tableSize))
+            return false;
+
+        storeU32LE(reinterpret_cast<uint8_t*>(scratch.buf), (uint32_t) numFields);
+        scratch.length = tableSize;
+
+        for (size_t i = 0; i < numFields; i++) {
+            const auto& field = fields[i];
+
+            if (!field.serialize(err, &scratch))
+                return false;
+
+            const size_t end = scratch.size() - tableSize;
+
+            if (end > UINT32_MAX)
+                return err->errorf("InstanceTooLarge", "Instance of `%s` exceeds 4 GiB in indexed layout.", field.className), false;
+
+            // scratch.buf may have moved while the field was written
+            storeU32LE(reinterpret_cast<uint8_t*>(scratch.buf) + HEADER_SIZE + i * ENTRY_SIZE, (uint32_t) end);
+        }
+
+        return writer->write(err, scratch.data(), scratch.size());
+    }
+
+    template <typename Fields>
+    static bool serializeInstance(IErrorHandler* err, IWriter* writer, const Fields& fields) {
+        static thread_local BufferWriter scratch;
+
+        return serializeInstance(err, writer, fields, scratch);
+    }
+
+    template <typename Fields>
+    static bool deserializeInstance(IErrorHandler* err, IReader* reader, Fields& fields) {
+        uint8_t word[4];
+
+        if (!reader->read(err, word, sizeof(word)))
+            return false;
+
+        const size_t numFields = loadU32LE(word);
+
+        if (numFields != fields.count())
+            return err->errorf("SchemaMismatch", "Indexed instance has %u fields, expected %u.",
+                    (unsigned int) numFields, (unsigned int) fields.count()), false;
+
+        // the table is only needed for random access; a full decode just reads the fields in order
+        for (size_t i = 0; i < numFields; i++)
+            if (!reader->read(err, word, sizeof(word)))
+                return false;
+
+        for (size_t i = 0; i < numFields; i++) {
+            auto field = fields[i];
+
+            if (!field.deserialize(err, reader))
+                return false;
+        }
+
+        return true;
+    }
+};
+}
+
+namespace reflection {  // UUID('c3549467-1615-4087-9829-176a2dc44b76')
+
+template <typename T>
+bool reflectSerializeIndexed(const T& inst, serialization::IWriter* writer) {
+    const auto fields = reflectFields(inst);
+
+    return serialization::IndexedInstanceSerializer<T>::serializeInstance(err, writer, fields);
+}
+
+// the same with a caller-owned scratch buffer (the overload above keeps one per thread)
+template <typename T>
+bool reflectSerializeIndexed(const T& inst, serialization::IWriter* writer, serialization::BufferWriter& scratch) {
+    const auto fields = reflectFields(inst);
+
+    return serialization::IndexedInstanceSerializer<T>::serializeInstance(err, writer, fields, scratch);
+}
+
+template <typename T>
+bool reflectDeserializeIndexed(T& value_out, serialization::IReader* reader) {
+    auto fields = reflectFields(value_out);
+
+    return serialization::IndexedInstanceSerializer<T>::deserializeInstance(err, reader, fields);
+}
+
+// Read-only view of an instance serialized with reflectSerializeIndexed.
+// Fields are decoded on demand; the underlying buffer must outlive the view.
+template <class C>
+class ReflectedView {
+public:
+    typedef serialization::IndexedInstanceSerializer<C> Layout;
+
+    ReflectedView() : fields(reflectFieldsStatic<C>()), table(nullptr), data(nullptr), numFields(0) {}
+
+    bool open(const void* buffer, size_t size) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(buffer);
+
+        if (size < Layout::HEADER_SIZE)
+            return err->unexpectedEndOfInput(":view"), false;
+
+        size_t n = serialization::loadU32LE(p);
+
+        if (n != fields.count())
+            return err->errorf("SchemaMismatch", "Indexed instance has %u fields, expected %u for `%s`.",
+                    (unsigned int) n, (unsigned int) fields.count(), versionedNameOfClass<C>()), false;
+
+        if ((size - Layout::HEADER_SIZE) / Layout::ENTRY_SIZE < n)
+            return err->unexpectedEndOfInput(":view"), false;
+
+        const uint8_t* t = p + Layout::HEADER_SIZE;
+        const size_t dataSize = size - Layout::HEADER_SIZE - n * Layout::ENTRY_SIZE;
+        uint32_t prev = 0;
+
+        for (size_t i = 0; i < n; i++) {
+            uint32_t end = serialization::loadU32LE(t + i * Layout::ENTRY_SIZE);
+
+            if (end < prev || end > dataSize)
+                return err->error("CorruptOffsetTable", "Field offset table is not monotonic or points past the buffer."), false;
+
+            prev = end;
+        }
+
+        table = t;
+        data = t + n * Layout::ENTRY_SIZE;
+        numFields = n;
+        return true;
+    }
+
+    // number of bytes the instance occupies in the buffer passed to open()
+    size_t size() const {
+        return Layout::HEADER_SIZE + numFields * Layout::ENTRY_SIZE + (numFields ? fieldEnd(numFields - 1) : 0);
+    }
+
+    size_t count() const { return numFields; }
+
+    const char* fieldName(size_t index) const { return fields[index].name; }
+
+    // returns -1 if there is no such field; positions in the flattened table are the same as in the view
+    int indexOf(const char* name) const {
+        int index = -1;
+        findField<C>(name, &index);
+
+        return (index < (int) numFields) ? index : -1;
+    }
+
+    // encoded bytes of a single field
+    void raw(size_t index, const void*& data_out, size_t& size_out) const {
+        size_t begin = fieldBegin(index);
+
+        data_out = data + begin;
+        size_out = fieldEnd(index) - begin;
+    }
+
+    template <typename T>
+    bool get(size_t index, T& value_out) const {
+        assert(index < numFields);
+
+        const auto field = fields[index];
+
+        if (field.refl != reflectionForType2<T>())
+            return err->errorf("IncorrectType", "Field `%s::%s` is `%s`, requested `%s`.", field.className, field.name,
+                    field.staticTypeName(), reflectionForType2<T>()->staticTypeName()), false;
+
+        const void* fieldData;
+        size_t fieldSize;
+        raw(index, fieldData, fieldSize);
+
+        serialization::BufferReader reader(fieldData, fieldSize);
+
+        if (!field.refl->deserialize(err, &reader, reinterpret_cast<void*>(&value_out)))
+            return false;
+
+        // the offset table says where the field ends; a value that decodes from fewer bytes doesn't match it
+        if (reader.remaining() != 0)
+            return err->errorf("TrailingData", "%u unexpected bytes after field `%s::%s`.",
+                    (unsigned int) reader.remaining(), field.className, field.name), false;
+
+        return true;
+    }
+
+    template <typename T>
+    bool get(const char* name, T& value_out) const {
+        int index = indexOf(name);
+
+        if (index < 0)
+            return err->errorf("FieldNotFound", "Class `%s` has no field `%s`.", versionedNameOfClass<C>(), name), false;
+
+        return get(index, value_out);
+    }
+
+private:
+    size_t fieldBegin(size_t index) const { return index > 0 ? fieldEnd(index - 1) : 0; }
+    size_t fieldEnd(size_t index) const { return serialization::loadU32LE(table + index * Layout::ENTRY_SIZE); }
+
+    ReflectedFields<void*> fields;
+    const uint8_t* table;
+    const uint8_t* data;
+    size_t numFields;
+};
+}
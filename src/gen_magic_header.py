@@ -63,24 +63,29 @@ def generate_REFL_BEGIN(virtual, extends):
 
     # getFields: get all reflectable fields in this class
     s += '   %s ::reflection::FieldSet_t const* reflection_getFields(REFL_MATCH_0) const {\\\n' % virtualPrefix
-    s += '        typedef std::remove_reference<decltype(*this)>::type ThisClass;\\\n'
+    s += '        typedef std::remove_const<std::remove_reference<decltype(*this)>::type>::type ThisClass;\\\n'
     s += '        return reflection_s_getFields<ThisClass>(REFL_MATCH);\\\n'
     s += '   }\\\n'
 
-    # s_getFields: get all reflectable fields in this class
+    # s_getFields: get all reflectable fields in this class, built from the static field list below
     s += '    template <class ThisClass>\\\n'
     s += '    static ::reflection::FieldSet_t const* reflection_s_getFields(REFL_MATCH_0) {\\\n'
-    s += '        const char* thisClassName = className_;\\\n'
-    s += '        thisClassName = thisClassName;\\\n'   # warnings about variable being unused
 
     if not extends:
-        s += '        ::reflection::FieldSet_t const* baseClassFields = nullptr;\\\n'
-        s += '        void* (*derivedPtrToBasePtr)(void*) = nullptr;\\\n'
+        s += '        return reflection_s_staticFields<ThisClass>(::reflection::FieldSetBuilder<ThisClass>(className_, nullptr, nullptr));\\\n'
     else:
-        s += '        ::reflection::FieldSet_t const* baseClassFields = baseClass_::reflection_s_getFields<baseClass_>(REFL_MATCH);\\\n'
-        s += '        void* (*derivedPtrToBasePtr)(void*) = &::reflection::derivedPtrToBasePtr<ThisClass, baseClass_>;\\\n'
+        s += '        return reflection_s_staticFields<ThisClass>(::reflection::FieldSetBuilder<ThisClass>(className_,\\\n'
+        s += '                baseClass_::reflection_s_getFields<baseClass_>(REFL_MATCH), &::reflection::derivedPtrToBasePtr<ThisClass, baseClass_>));\\\n'
 
-    s += '        static ::reflection::Field_t const fields[] = {\\\n'
+    s += '    }\\\n'
+
+    # BaseClass: used by static (compile-time) field iteration to continue into the base class
+    s += '    typedef %s reflection_BaseClass;\\\n' % ('baseClass_' if extends else 'void')
+
+    # s_staticFields: passes all field descriptors (REFL_FIELD & co.) to a visitor; closed by REFL_END
+    s += '    template <class ThisClass, class Visitor>\\\n'
+    s += '    static REFL_CONSTEXPR REFL_VISITOR_RESULT(Visitor) reflection_s_staticFields(Visitor&& visitor) {\\\n'
+    s += '        return visitor(\\\n'
     s += '\n'
     '''
     simpleName = 'REFL_SIMPLE' + nameSuffix